@@ -15,6 +15,8 @@
 #include "src/execution/aggregation.h"
 #include "src/execution/expression.h"
 #include "src/execution/operator.h"
+#include "src/execution/spill.h"
+#include "src/execution/thread_pool.h"
 
 ABSL_FLAG(std::string, input, "", "Input columnar file (.clmnr)");
 ABSL_FLAG(std::string, schema, "", "Schema file (.schema)");
@@ -23,6 +25,12 @@ ABSL_FLAG(std::string, queries, "", "Comma-separated list of queries to run (e.g
 ABSL_FLAG(std::string, skip, "", "Comma-separated list of queries to skip (e.g., '0,5,10' or 'Q0,Q5,Q10')");
 ABSL_FLAG(int32_t, from, -1, "First query index to run (inclusive)");
 ABSL_FLAG(int32_t, to, -1, "Last query index to run (inclusive)");
+ABSL_FLAG(int32_t, threads, 0, "Number of threads to run each query with (0 = hardware concurrency)");
+ABSL_FLAG(int64_t, aggregation_memory_mb, 0,
+          "Memory budget of each aggregation in MiB; larger ones spill to --spill_dir (0 = unlimited)");
+ABSL_FLAG(int64_t, sort_memory_mb, 0,
+          "Memory budget of each sort in MiB; larger inputs spill sorted runs to --spill_dir (0 = unlimited)");
+ABSL_FLAG(std::string, spill_dir, "", "Directory for spill files (default: the system temporary directory)");
 
 namespace {
 
@@ -417,7 +425,8 @@ class QueryMaker {
     // SELECT COUNT(*) FROM hits WHERE URL LIKE '%google%';
 
     std::shared_ptr<Operator> plan = MakeAggregate(
-        MakeFilter(MakeScan(input_, S({"URL"})), MakeContains(MakeVariable("URL", Type::kString), "google")),
+        MakeFilter(MakeScan(input_, S({"URL"}), {ZoneMapPredicate::Contains("URL", "google")}),
+                   MakeContains(MakeVariable("URL", Type::kString), "google")),
         MakeAggregation({AggregationUnit{AggregationType::kCount, MakeConst(Value(static_cast<int64_t>(0))), "c"}},
                         {}));
 
@@ -430,7 +439,7 @@ class QueryMaker {
 
     std::shared_ptr<Operator> plan = MakeTopK(
         MakeAggregate(
-            MakeFilter(MakeScan(input_, S({"URL", "SearchPhrase"})),
+            MakeFilter(MakeScan(input_, S({"URL", "SearchPhrase"}), {ZoneMapPredicate::Contains("URL", "google")}),
                        MakeBinary(BinaryFunction::kAnd, MakeContains(MakeVariable("URL", Type::kString), "google"),
                                   MakeBinary(BinaryFunction::kNotEqual, MakeVariable("SearchPhrase", Type::kString),
                                              MakeConst(Value(std::string("")))))),
@@ -448,7 +457,8 @@ class QueryMaker {
 
     std::shared_ptr<Operator> plan = MakeTopK(
         MakeAggregate(
-            MakeFilter(MakeScan(input_, S({"Title", "URL", "SearchPhrase", "UserID"})),
+            MakeFilter(MakeScan(input_, S({"Title", "URL", "SearchPhrase", "UserID"}),
+                                {ZoneMapPredicate::Contains("Title", "Google")}),
                        MakeBinary(BinaryFunction::kAnd,
                                   MakeBinary(BinaryFunction::kAnd,
                                              MakeContains(MakeVariable("Title", Type::kString), "Google"),
@@ -471,7 +481,8 @@ class QueryMaker {
     // Note: projecting subset of columns for demonstration
 
     std::shared_ptr<Operator> plan =
-        MakeTopK(MakeProject(MakeFilter(MakeScan(input_, S({"WatchID", "EventTime", "URL", "Title"})),
+        MakeTopK(MakeProject(MakeFilter(MakeScan(input_, S({"WatchID", "EventTime", "URL", "Title"}),
+                                                 {ZoneMapPredicate::Contains("URL", "google")}),
                                         MakeContains(MakeVariable("URL", Type::kString), "google")),
                              {ProjectionUnit{MakeVariable("WatchID", Type::kInt64), "WatchID"},
                               ProjectionUnit{MakeVariable("EventTime", Type::kTimestamp), "EventTime"},
@@ -686,7 +697,7 @@ class QueryMaker {
 
     std::shared_ptr<Operator> plan = MakeTopK(
         MakeProject(
-            MakeAggregateCompact(
+            MakeAggregate(
                 MakeScan(input_, S({"WatchID", "ClientIP", "IsRefresh", "ResolutionWidth"})),
                 MakeAggregation(
                     {AggregationUnit{AggregationType::kCount, MakeConst(Value(static_cast<int64_t>(0))), "c"},
@@ -1111,6 +1122,19 @@ int main(int argc, char** argv) {
   }
   std::filesystem::create_directories(output_dir);
 
+  if (const int32_t threads = absl::GetFlag(FLAGS_threads); threads > 0) {
+    ngn::SetExecutionThreads(threads);
+  }
+  if (const int64_t megabytes = absl::GetFlag(FLAGS_aggregation_memory_mb); megabytes > 0) {
+    ngn::SetAggregationMemoryBudget(megabytes << 20);
+  }
+  if (const int64_t megabytes = absl::GetFlag(FLAGS_sort_memory_mb); megabytes > 0) {
+    ngn::SetSortMemoryBudget(megabytes << 20);
+  }
+  if (const std::string spill_dir = absl::GetFlag(FLAGS_spill_dir); !spill_dir.empty()) {
+    ngn::SetSpillDirectory(spill_dir);
+  }
+
   ngn::QueryMaker query_maker(input, ngn::Schema::FromFile(schema));
 
   std::vector<ngn::QueryInfo> queries = {
@@ -2,3 +2,4 @@ find_package(absl REQUIRED)
 find_package(GTest REQUIRED)
 find_package(benchmark REQUIRED)
 find_package(simde REQUIRED)
+find_package(Threads REQUIRED)
@@ -14,6 +14,10 @@ ABSL_FLAG(std::string, schema, "", "Schema file");
 
 ABSL_FLAG(int64_t, rows_per_log, std::numeric_limits<int64_t>::max(), "Rows to process for one log message");
 ABSL_FLAG(int64_t, row_group_size, 65536, "Rows per row group in output columnar file");
+ABSL_FLAG(std::vector<std::string>, bloom_filter_columns, {},
+          "Comma-separated columns to build per-row-group Bloom filters for (e.g. UserID)");
+ABSL_FLAG(std::vector<std::string>, ngram_filter_columns, {},
+          "Comma-separated string columns to build per-row-group n-gram filters for (e.g. URL,Title)");
 
 namespace {
 std::vector<ngn::Column> MakeEmptyColumns(const ngn::Schema& schema, int64_t reserve) {
@@ -103,7 +107,10 @@ int main(int argc, char** argv) {
   ASSERT(!schema.Fields().empty());
 
   ngn::CsvReader reader(input);
-  ngn::FileWriter writer(output, schema);
+  ngn::FileWriter::Options writer_options;
+  writer_options.bloom_filter_columns = absl::GetFlag(FLAGS_bloom_filter_columns);
+  writer_options.ngram_filter_columns = absl::GetFlag(FLAGS_ngram_filter_columns);
+  ngn::FileWriter writer(output, schema, writer_options);
 
   const int64_t row_group_size = absl::GetFlag(FLAGS_row_group_size);
   ASSERT(row_group_size > 0);
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "simde/x86/avx2.h"
+#include "src/util/assert.h"
+
+namespace ngn {
+
+// Frame-of-reference bit packing of unsigned 64-bit values.
+//
+// Values are packed in blocks of kBitPackBlockSize. Inside a block value i goes to lane i % kBitPackLanes, and
+// every lane is an independent little-endian bit stream of bit_width * 64 bits. Words of the lanes are interleaved,
+// so word w of all lanes forms one 256-bit vector and the whole block is unpacked with vector shifts, four values at
+// a time. The last block is zero padded.
+inline constexpr int64_t kBitPackLanes = 4;
+inline constexpr int64_t kBitPackBlockSize = kBitPackLanes * 64;
+
+inline int64_t BitPackedWordCount(int64_t size, int bit_width) {
+  const int64_t blocks = (size + kBitPackBlockSize - 1) / kBitPackBlockSize;
+  return blocks * bit_width * kBitPackLanes;
+}
+
+// Packs the low `bit_width` bits of each value.
+inline std::vector<uint64_t> BitPack(const uint64_t* values, int64_t size, int bit_width) {
+  ASSERT(bit_width >= 0 && bit_width <= 64);
+  std::vector<uint64_t> words(BitPackedWordCount(size, bit_width), 0);
+  if (bit_width == 0) {
+    return words;
+  }
+
+  for (int64_t i = 0; i < size; ++i) {
+    const int64_t block = i / kBitPackBlockSize;
+    const int64_t lane = i % kBitPackLanes;
+    const int64_t bit = (i % kBitPackBlockSize) / kBitPackLanes * bit_width;
+    uint64_t* lane_words = words.data() + block * bit_width * kBitPackLanes + lane;
+
+    const int64_t word = bit / 64;
+    const int shift = static_cast<int>(bit % 64);
+    lane_words[word * kBitPackLanes] |= values[i] << shift;
+    if (shift + bit_width > 64) {
+      lane_words[(word + 1) * kBitPackLanes] |= values[i] >> (64 - shift);
+    }
+  }
+  return words;
+}
+
+namespace internal {
+
+template <int kWidth, size_t kGroup>
+inline void UnpackGroup(const char* words, simde__m256i mask, simde__m256i reference, uint64_t* out) {
+  constexpr int kBit = static_cast<int>(kGroup) * kWidth;
+  constexpr int kWord = kBit / 64;
+  constexpr int kShift = kBit % 64;
+  constexpr size_t kVectorBytes = sizeof(simde__m256i);
+
+  simde__m256i v = simde_mm256_loadu_si256(reinterpret_cast<const simde__m256i*>(words + kWord * kVectorBytes));
+  v = simde_mm256_srli_epi64(v, kShift);
+  if constexpr (kShift + kWidth > 64) {
+    const simde__m256i next =
+        simde_mm256_loadu_si256(reinterpret_cast<const simde__m256i*>(words + (kWord + 1) * kVectorBytes));
+    v = simde_mm256_or_si256(v, simde_mm256_slli_epi64(next, 64 - kShift));
+  }
+  if constexpr (kWidth < 64) {
+    v = simde_mm256_and_si256(v, mask);
+  }
+  simde_mm256_storeu_si256(reinterpret_cast<simde__m256i*>(out + kGroup * kBitPackLanes),
+                           simde_mm256_add_epi64(v, reference));
+}
+
+template <int kWidth>
+void UnpackBlock(const char* words, uint64_t reference, uint64_t* out) {
+  if constexpr (kWidth == 0) {
+    std::fill_n(out, kBitPackBlockSize, reference);
+  } else {
+    constexpr uint64_t kMask = kWidth == 64 ? ~uint64_t{0} : (uint64_t{1} << kWidth) - 1;
+    const simde__m256i mask = simde_mm256_set1_epi64x(static_cast<int64_t>(kMask));
+    const simde__m256i ref = simde_mm256_set1_epi64x(static_cast<int64_t>(reference));
+    [&]<size_t... kGroups>(std::index_sequence<kGroups...>) {
+      (UnpackGroup<kWidth, kGroups>(words, mask, ref, out), ...);
+    }(std::make_index_sequence<kBitPackBlockSize / kBitPackLanes>{});
+  }
+}
+
+using UnpackBlockFunction = void (*)(const char*, uint64_t, uint64_t*);
+
+inline constexpr std::array<UnpackBlockFunction, 65> kUnpackBlockFunctions =
+    []<int... kWidths>(std::integer_sequence<int, kWidths...>) {
+      return std::array<UnpackBlockFunction, 65>{&UnpackBlock<kWidths>...};
+    }(std::make_integer_sequence<int, 65>{});
+
+}  // namespace internal
+
+// Unpacks values [begin, end) from `words` (possibly unaligned), adds `reference` to each of them (wrapping) and
+// passes them in pieces of at most one block to `consume(uint64_t* values, int64_t offset, int64_t count)`, where
+// `offset` is relative to `begin`. Only the blocks overlapping the range are unpacked. The buffer passed to the
+// consumer may be modified by it.
+template <typename Consumer>
+void BitUnpackRange(const char* words, int64_t begin, int64_t end, int bit_width, uint64_t reference,
+                    Consumer&& consume) {
+  ASSERT(bit_width >= 0 && bit_width <= 64);
+  ASSERT(0 <= begin && begin <= end);
+  const internal::UnpackBlockFunction unpack = internal::kUnpackBlockFunctions[bit_width];
+  const int64_t block_bytes = bit_width * kBitPackLanes * static_cast<int64_t>(sizeof(uint64_t));
+
+  alignas(32) uint64_t block[kBitPackBlockSize];
+  int64_t block_begin = begin / kBitPackBlockSize * kBitPackBlockSize;
+  words += begin / kBitPackBlockSize * block_bytes;
+  for (; block_begin < end; block_begin += kBitPackBlockSize) {
+    unpack(words, reference, block);
+    const int64_t from = std::max(begin, block_begin);
+    const int64_t to = std::min(end, block_begin + kBitPackBlockSize);
+    consume(static_cast<uint64_t*>(block) + (from - block_begin), from - begin, to - from);
+    words += block_bytes;
+  }
+}
+
+// Unpacks all `size` values, see BitUnpackRange.
+template <typename Consumer>
+void BitUnpack(const char* words, int64_t size, int bit_width, uint64_t reference, Consumer&& consume) {
+  BitUnpackRange(words, 0, size, bit_width, reference, std::forward<Consumer>(consume));
+}
+
+// Replaces values[i] with carry + values[0] + ... + values[i] (wrapping) and returns the last sum. Four values are
+// summed at a time with two shift-and-add steps inside a vector.
+inline uint64_t PrefixSum(uint64_t* values, int64_t count, uint64_t carry) {
+  const simde__m256i zero = simde_mm256_setzero_si256();
+  simde__m256i running = simde_mm256_set1_epi64x(static_cast<int64_t>(carry));
+
+  int64_t i = 0;
+  for (; i + kBitPackLanes <= count; i += kBitPackLanes) {
+    simde__m256i v = simde_mm256_loadu_si256(reinterpret_cast<const simde__m256i*>(values + i));
+    // [a, b, c, d] + [0, a, b, c]
+    v = simde_mm256_add_epi64(v, simde_mm256_blend_epi32(simde_mm256_permute4x64_epi64(v, 0x90), zero, 0x03));
+    // [a, a+b, b+c, c+d] + [0, 0, a, a+b]
+    v = simde_mm256_add_epi64(v, simde_mm256_blend_epi32(simde_mm256_permute4x64_epi64(v, 0x40), zero, 0x0F));
+    v = simde_mm256_add_epi64(v, running);
+    simde_mm256_storeu_si256(reinterpret_cast<simde__m256i*>(values + i), v);
+    running = simde_mm256_permute4x64_epi64(v, 0xFF);
+  }
+
+  carry = static_cast<uint64_t>(simde_mm256_extract_epi64(running, 0));
+  for (; i < count; ++i) {
+    carry += values[i];
+    values[i] = carry;
+  }
+  return carry;
+}
+
+}  // namespace ngn
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+#include "src/core/column.h"
+#include "src/core/type.h"
+#include "src/core/value.h"
+#include "src/util/assert.h"
+
+namespace ngn {
+
+namespace internal {
+
+// Final mixing step of MurmurHash3.
+inline uint64_t Mix64(uint64_t x) {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return x;
+}
+
+inline uint64_t HashBytes(std::string_view bytes) {
+  constexpr uint64_t kMultiplier = 0x9e3779b97f4a7c15ULL;
+  uint64_t hash = Mix64(bytes.size() ^ kMultiplier);
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= bytes.size(); i += sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, bytes.data() + i, sizeof(word));
+    hash = (hash ^ Mix64(word)) * kMultiplier;
+  }
+  uint64_t tail = 0;
+  std::memcpy(&tail, bytes.data() + i, bytes.size() - i);
+  return Mix64(hash ^ tail);
+}
+
+}  // namespace internal
+
+// Hash of a column value used by Bloom filters. The hashes are stored in files, so they must not depend on the
+// standard library implementation.
+template <typename T>
+uint64_t BloomHash(const T& value) {
+  if constexpr (std::is_same_v<T, Int128>) {
+    const auto u = static_cast<unsigned __int128>(value);
+    return internal::Mix64(static_cast<uint64_t>(u) ^ internal::Mix64(static_cast<uint64_t>(u >> 64)));
+  } else if constexpr (std::is_convertible_v<T, std::string_view>) {
+    return internal::HashBytes(value);
+  } else if constexpr (std::is_same_v<T, Date> || std::is_same_v<T, Timestamp> || std::is_same_v<T, Boolean>) {
+    return internal::Mix64(static_cast<uint64_t>(value.value));
+  } else if constexpr (std::is_integral_v<T>) {
+    return internal::Mix64(static_cast<uint64_t>(static_cast<int64_t>(value)));
+  } else {
+    static_assert(sizeof(T) == 0, "Unhandled type");
+  }
+}
+
+inline uint64_t BloomHash(const Value& value) {
+  return std::visit([](const auto& v) { return BloomHash(v); }, value.GetValue());
+}
+
+// Split-block Bloom filter, as in Parquet. The filter is an array of 256-bit blocks of eight 32-bit words. The high
+// half of a hash selects the block and the low half sets one bit in each of its words, so a lookup touches a single
+// block and can be answered without reading the rest of the filter.
+class BloomFilter {
+ public:
+  static constexpr int64_t kBlockWords = 8;
+  static constexpr int64_t kBlockBytes = kBlockWords * sizeof(uint32_t);
+
+  explicit BloomFilter(int64_t block_count) : words_(block_count * kBlockWords, 0) {
+    ASSERT(block_count > 0 && block_count <= std::numeric_limits<uint32_t>::max());
+  }
+
+  // Smallest filter that keeps the false positive probability for `distinct_values` values below `fpp`.
+  static int64_t OptimalBlockCount(int64_t distinct_values, double fpp) {
+    ASSERT(fpp > 0 && fpp < 1);
+    constexpr int64_t kMaxBytes = int64_t{128} << 20;
+    const double bytes = -8.0 * static_cast<double>(distinct_values) / std::log(1 - std::pow(fpp, 1.0 / 8));
+    return std::clamp<int64_t>(static_cast<int64_t>(std::ceil(bytes / kBlockBytes)), 1, kMaxBytes / kBlockBytes);
+  }
+
+  static int64_t BlockIndex(uint64_t hash, int64_t block_count) {
+    return static_cast<int64_t>(((hash >> 32) * static_cast<uint64_t>(block_count)) >> 32);
+  }
+
+  // Checks `hash` against the block BlockIndex(hash, ...) that starts at `block` (possibly unaligned).
+  static bool BlockMayContain(const char* block, uint64_t hash) {
+    const std::array<uint32_t, kBlockWords> mask = BlockMask(hash);
+    for (int64_t i = 0; i < kBlockWords; ++i) {
+      uint32_t word;
+      std::memcpy(&word, block + i * sizeof(uint32_t), sizeof(word));
+      if ((word & mask[i]) != mask[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void Insert(uint64_t hash) {
+    const std::array<uint32_t, kBlockWords> mask = BlockMask(hash);
+    uint32_t* block = words_.data() + BlockIndex(hash, BlockCount()) * kBlockWords;
+    for (int64_t i = 0; i < kBlockWords; ++i) {
+      block[i] |= mask[i];
+    }
+  }
+
+  bool MayContain(uint64_t hash) const {
+    const char* block = reinterpret_cast<const char*>(words_.data() + BlockIndex(hash, BlockCount()) * kBlockWords);
+    return BlockMayContain(block, hash);
+  }
+
+  int64_t BlockCount() const { return static_cast<int64_t>(words_.size()) / kBlockWords; }
+
+  // Layout:
+  //   block_count:int64
+  //   words[block_count * kBlockWords]:uint32
+  std::string Serialize() const {
+    std::string result(sizeof(int64_t) + words_.size() * sizeof(uint32_t), '\0');
+    const int64_t block_count = BlockCount();
+    std::memcpy(result.data(), &block_count, sizeof(block_count));
+    std::memcpy(result.data() + sizeof(int64_t), words_.data(), words_.size() * sizeof(uint32_t));
+    return result;
+  }
+
+  static BloomFilter Deserialize(std::string_view data) {
+    ASSERT(data.size() >= sizeof(int64_t));
+    int64_t block_count;
+    std::memcpy(&block_count, data.data(), sizeof(block_count));
+    BloomFilter filter(block_count);
+    ASSERT(data.size() == sizeof(int64_t) + filter.words_.size() * sizeof(uint32_t));
+    std::memcpy(filter.words_.data(), data.data() + sizeof(int64_t), filter.words_.size() * sizeof(uint32_t));
+    return filter;
+  }
+
+ private:
+  static std::array<uint32_t, kBlockWords> BlockMask(uint64_t hash) {
+    static constexpr std::array<uint32_t, kBlockWords> kSalt = {0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+                                                                0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+    const uint32_t key = static_cast<uint32_t>(hash);
+    std::array<uint32_t, kBlockWords> mask;
+    for (int64_t i = 0; i < kBlockWords; ++i) {
+      mask[i] = uint32_t{1} << ((key * kSalt[i]) >> 27);
+    }
+    return mask;
+  }
+
+  std::vector<uint32_t> words_;
+};
+
+namespace internal {
+
+inline BloomFilter BuildBloomFilter(std::vector<uint64_t> hashes, double fpp) {
+  std::sort(hashes.begin(), hashes.end());
+  hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+
+  BloomFilter filter(BloomFilter::OptimalBlockCount(static_cast<int64_t>(hashes.size()), fpp));
+  for (uint64_t hash : hashes) {
+    filter.Insert(hash);
+  }
+  return filter;
+}
+
+}  // namespace internal
+
+// Builds a filter holding every value of `column`. Dictionary encoded strings only hash their dictionary.
+inline BloomFilter ComputeBloomFilter(const Column& column, double fpp) {
+  std::vector<uint64_t> hashes;
+  std::visit(
+      [&hashes]<Type type>(const ArrayType<type>& values) {
+        if constexpr (type == Type::kString) {
+          if (values.IsDictionaryEncoded()) {
+            for (std::string_view value : *values.Dictionary()) {
+              hashes.push_back(BloomHash(value));
+            }
+            return;
+          }
+        }
+        hashes.reserve(values.size());
+        for (const auto& value : values) {
+          hashes.push_back(BloomHash(value));
+        }
+      },
+      column.Values());
+
+  return internal::BuildBloomFilter(std::move(hashes), fpp);
+}
+
+// An n-gram filter is a Bloom filter holding every substring of kNgramLength bytes of a string column. A value can
+// only contain a substring if all n-grams of the substring are in the filter, so row groups can be skipped for
+// LIKE '%...%' lookups. Substrings shorter than kNgramLength cannot be checked.
+inline constexpr size_t kNgramLength = 3;
+
+template <typename Consumer>
+void ForEachNgramHash(std::string_view value, Consumer&& consume) {
+  for (size_t i = 0; i + kNgramLength <= value.size(); ++i) {
+    uint64_t ngram = 0;
+    std::memcpy(&ngram, value.data() + i, kNgramLength);
+    consume(internal::Mix64(ngram));
+  }
+}
+
+inline BloomFilter ComputeNgramFilter(const Column& column, double fpp) {
+  ASSERT(column.GetType() == Type::kString);
+  const auto& values = std::get<ArrayType<Type::kString>>(column.Values());
+  const StringArray& distinct = values.IsDictionaryEncoded() ? *values.Dictionary() : values;
+
+  std::vector<uint64_t> hashes;
+  for (std::string_view value : distinct) {
+    ForEachNgramHash(value, [&hashes](uint64_t hash) { hashes.push_back(hash); });
+  }
+  return internal::BuildBloomFilter(std::move(hashes), fpp);
+}
+
+}  // namespace ngn
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <variant>
 
 #include "src/core/type.h"
@@ -7,41 +8,65 @@
 
 namespace ngn {
 
+// A column shares its values with its copies, so copying one, e.g. to pass a column of a batch on to an expression or a
+// projection, is cheap. The values are copied on the first mutable access to a column that shares them.
 class Column {
  public:
   using GenericColumn = std::variant<ArrayType<Type::kBool>, ArrayType<Type::kInt16>, ArrayType<Type::kInt32>,
                                      ArrayType<Type::kInt64>, ArrayType<Type::kInt128>, ArrayType<Type::kString>,
                                      ArrayType<Type::kDate>, ArrayType<Type::kTimestamp>, ArrayType<Type::kChar>>;
 
-  explicit Column(ArrayType<Type::kBool> values) : values_(std::move(values)) {}
-  explicit Column(ArrayType<Type::kInt16> values) : values_(std::move(values)) {}
-  explicit Column(ArrayType<Type::kInt32> values) : values_(std::move(values)) {}
-  explicit Column(ArrayType<Type::kInt64> values) : values_(std::move(values)) {}
-  explicit Column(ArrayType<Type::kInt128> values) : values_(std::move(values)) {}
-  explicit Column(ArrayType<Type::kDate> values) : values_(std::move(values)) {}
-  explicit Column(ArrayType<Type::kTimestamp> values) : values_(std::move(values)) {}
-  explicit Column(ArrayType<Type::kChar> values) : values_(std::move(values)) {}
-  explicit Column(ArrayType<Type::kString> values) : values_(std::move(values)) {}
+  explicit Column(ArrayType<Type::kBool> values) : values_(std::make_shared<GenericColumn>(std::move(values))) {}
+  explicit Column(ArrayType<Type::kInt16> values) : values_(std::make_shared<GenericColumn>(std::move(values))) {}
+  explicit Column(ArrayType<Type::kInt32> values) : values_(std::make_shared<GenericColumn>(std::move(values))) {}
+  explicit Column(ArrayType<Type::kInt64> values) : values_(std::make_shared<GenericColumn>(std::move(values))) {}
+  explicit Column(ArrayType<Type::kInt128> values) : values_(std::make_shared<GenericColumn>(std::move(values))) {}
+  explicit Column(ArrayType<Type::kDate> values) : values_(std::make_shared<GenericColumn>(std::move(values))) {}
+  explicit Column(ArrayType<Type::kTimestamp> values) : values_(std::make_shared<GenericColumn>(std::move(values))) {}
+  explicit Column(ArrayType<Type::kChar> values) : values_(std::make_shared<GenericColumn>(std::move(values))) {}
+  explicit Column(ArrayType<Type::kString> values) : values_(std::make_shared<GenericColumn>(std::move(values))) {}
 
-  GenericColumn& Values() { return values_; }
-  const GenericColumn& Values() const { return values_; }
+  GenericColumn& Values() {
+    if (values_.use_count() > 1) {
+      values_ = std::make_shared<GenericColumn>(*values_);
+    }
+    return *values_;
+  }
+  const GenericColumn& Values() const { return *values_; }
+
+  // Whether the values are shared with `other`.
+  bool SharesValues(const Column& other) const { return values_ == other.values_; }
 
   Value operator[](size_t index) const {
-    return std::visit([index]<Type type>(const ArrayType<type>& arr) { return Value(arr.at(index)); }, values_);
+    return std::visit(
+        [index]<Type type>(const ArrayType<type>& arr) { return Value(PhysicalType<type>(arr.at(index))); }, *values_);
   }
 
   Type GetType() const {
-    return std::visit([]<Type type>(const ArrayType<type>&) { return type; }, values_);
+    return std::visit([]<Type type>(const ArrayType<type>&) { return type; }, *values_);
   }
 
   size_t Size() const {
-    return std::visit([](const auto& arr) { return arr.size(); }, values_);
+    return std::visit([](const auto& arr) { return arr.size(); }, *values_);
+  }
+
+  // Approximate number of bytes held by the values.
+  size_t MemoryUsage() const {
+    return std::visit(
+        []<Type type>(const ArrayType<type>& arr) -> size_t {
+          if constexpr (type == Type::kString) {
+            return arr.MemoryUsage();
+          } else {
+            return arr.capacity() * sizeof(PhysicalType<type>);
+          }
+        },
+        *values_);
   }
 
-  bool operator==(const Column& other) const = default;
+  bool operator==(const Column& other) const { return SharesValues(other) || *values_ == *other.values_; }
 
  private:
-  GenericColumn values_;
+  std::shared_ptr<GenericColumn> values_;
 };
 
 }  // namespace ngn
@@ -1,12 +1,23 @@
 #pragma once
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <ios>
 #include <iostream>
+#include <memory>
+#include <numeric>
+#include <optional>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <vector>
 
+#include "src/core/bloom_filter.h"
 #include "src/core/column.h"
+#include "src/core/encoding.h"
+#include "src/core/hyperloglog.h"
+#include "src/core/mapped_file.h"
 #include "src/core/schema.h"
 #include "src/core/serde.h"
 #include "src/core/type.h"
@@ -22,11 +33,18 @@ static constexpr int64_t kColumnarFooterMagic = 0x434C4D4E52524734;  // "CLMNRRG
 class Metadata {
  public:
   Metadata(Schema schema, std::vector<int64_t> row_group_offsets, std::vector<int64_t> row_group_row_counts,
-           std::vector<RowGroupZoneMap> zone_maps = {})
+           std::vector<RowGroupZoneMap> zone_maps = {}, std::vector<std::vector<Encoding>> encodings = {},
+           std::vector<int64_t> page_index_offsets = {}, std::vector<int64_t> bloom_filter_offsets = {},
+           std::vector<int64_t> ngram_filter_offsets = {}, std::vector<int64_t> ndv_estimates = {})
       : schema_(std::move(schema)),
         row_group_offsets_(std::move(row_group_offsets)),
         row_group_row_counts_(std::move(row_group_row_counts)),
-        zone_maps_(std::move(zone_maps)) {}
+        zone_maps_(std::move(zone_maps)),
+        encodings_(std::move(encodings)),
+        page_index_offsets_(std::move(page_index_offsets)),
+        bloom_filter_offsets_(std::move(bloom_filter_offsets)),
+        ngram_filter_offsets_(std::move(ngram_filter_offsets)),
+        ndv_estimates_(std::move(ndv_estimates)) {}
 
   std::string Serialize() const {
     std::stringstream out;
@@ -54,6 +72,45 @@ class Metadata {
       Write(serialized_zm, out);
     }
 
+    // Serialize column chunk encodings
+    int64_t encodings_count = encodings_.size();
+    Write(encodings_count, out);
+    for (const auto& row_group_encodings : encodings_) {
+      int64_t column_count = row_group_encodings.size();
+      Write(column_count, out);
+      for (Encoding encoding : row_group_encodings) {
+        Write(static_cast<int16_t>(encoding), out);
+      }
+    }
+
+    // Serialize page index offsets
+    int64_t page_index_count = page_index_offsets_.size();
+    Write(page_index_count, out);
+    for (int64_t offset : page_index_offsets_) {
+      Write(offset, out);
+    }
+
+    // Serialize Bloom filter offsets
+    int64_t bloom_filter_count = bloom_filter_offsets_.size();
+    Write(bloom_filter_count, out);
+    for (int64_t offset : bloom_filter_offsets_) {
+      Write(offset, out);
+    }
+
+    // Serialize n-gram filter offsets
+    int64_t ngram_filter_count = ngram_filter_offsets_.size();
+    Write(ngram_filter_count, out);
+    for (int64_t offset : ngram_filter_offsets_) {
+      Write(offset, out);
+    }
+
+    // Serialize distinct value estimates
+    int64_t ndv_count = ndv_estimates_.size();
+    Write(ndv_count, out);
+    for (int64_t ndv : ndv_estimates_) {
+      Write(ndv, out);
+    }
+
     return out.str();
   }
 
@@ -86,8 +143,65 @@ class Metadata {
       }
     }
 
+    // Deserialize column chunk encodings (if present)
+    std::vector<std::vector<Encoding>> encodings;
+    if (in.peek() != EOF) {
+      int64_t encodings_count = Read<int64_t>(in);
+      encodings.resize(encodings_count);
+      for (auto& row_group_encodings : encodings) {
+        int64_t column_count = Read<int64_t>(in);
+        row_group_encodings.reserve(column_count);
+        for (int64_t i = 0; i < column_count; ++i) {
+          int16_t encoding = Read<int16_t>(in);
+          ASSERT(IsValidEncoding(encoding));
+          row_group_encodings.push_back(static_cast<Encoding>(encoding));
+        }
+      }
+    }
+
+    // Deserialize page index offsets (if present)
+    std::vector<int64_t> page_index_offsets;
+    if (in.peek() != EOF) {
+      int64_t page_index_count = Read<int64_t>(in);
+      page_index_offsets.resize(page_index_count);
+      for (auto& offset : page_index_offsets) {
+        offset = Read<int64_t>(in);
+      }
+    }
+
+    // Deserialize Bloom filter offsets (if present)
+    std::vector<int64_t> bloom_filter_offsets;
+    if (in.peek() != EOF) {
+      int64_t bloom_filter_count = Read<int64_t>(in);
+      bloom_filter_offsets.resize(bloom_filter_count);
+      for (auto& offset : bloom_filter_offsets) {
+        offset = Read<int64_t>(in);
+      }
+    }
+
+    // Deserialize n-gram filter offsets (if present)
+    std::vector<int64_t> ngram_filter_offsets;
+    if (in.peek() != EOF) {
+      int64_t ngram_filter_count = Read<int64_t>(in);
+      ngram_filter_offsets.resize(ngram_filter_count);
+      for (auto& offset : ngram_filter_offsets) {
+        offset = Read<int64_t>(in);
+      }
+    }
+
+    // Deserialize distinct value estimates (if present)
+    std::vector<int64_t> ndv_estimates;
+    if (in.peek() != EOF) {
+      int64_t ndv_count = Read<int64_t>(in);
+      ndv_estimates.resize(ndv_count);
+      for (auto& ndv : ndv_estimates) {
+        ndv = Read<int64_t>(in);
+      }
+    }
+
     return Metadata(std::move(schema), std::move(row_group_offsets), std::move(row_group_row_counts),
-                    std::move(zone_maps));
+                    std::move(zone_maps), std::move(encodings), std::move(page_index_offsets),
+                    std::move(bloom_filter_offsets), std::move(ngram_filter_offsets), std::move(ndv_estimates));
   }
 
   const Schema& GetSchema() const { return schema_; }
@@ -97,18 +211,79 @@ class Metadata {
 
   bool HasZoneMaps() const { return !zone_maps_.empty(); }
 
+  // Files written before encodings were recorded only contain plain column chunks.
+  Encoding GetEncoding(uint64_t row_group_idx, uint64_t column_idx) const {
+    if (row_group_idx >= encodings_.size() || column_idx >= encodings_[row_group_idx].size()) {
+      return Encoding::kPlain;
+    }
+    return encodings_[row_group_idx][column_idx];
+  }
+
+  // Absolute file offset of the page index of each row group, or -1 if the row group has none.
+  const std::vector<int64_t>& GetPageIndexOffsets() const { return page_index_offsets_; }
+
+  int64_t GetPageIndexOffset(uint64_t row_group_idx) const {
+    return row_group_idx < page_index_offsets_.size() ? page_index_offsets_[row_group_idx] : -1;
+  }
+
+  // Absolute file offset of the Bloom filters of each row group, or -1 if the row group has none.
+  const std::vector<int64_t>& GetBloomFilterOffsets() const { return bloom_filter_offsets_; }
+
+  int64_t GetBloomFilterOffset(uint64_t row_group_idx) const {
+    return row_group_idx < bloom_filter_offsets_.size() ? bloom_filter_offsets_[row_group_idx] : -1;
+  }
+
+  // Absolute file offset of the n-gram filters of each row group, or -1 if the row group has none.
+  const std::vector<int64_t>& GetNgramFilterOffsets() const { return ngram_filter_offsets_; }
+
+  int64_t GetNgramFilterOffset(uint64_t row_group_idx) const {
+    return row_group_idx < ngram_filter_offsets_.size() ? ngram_filter_offsets_[row_group_idx] : -1;
+  }
+
+  // Estimated number of distinct values of every column of the file, or -1 if it is unknown.
+  int64_t GetNdvEstimate(uint64_t column_idx) const {
+    return column_idx < ndv_estimates_.size() ? ndv_estimates_[column_idx] : -1;
+  }
+
  private:
   Schema schema_;
   std::vector<int64_t> row_group_offsets_;
   std::vector<int64_t> row_group_row_counts_;
   std::vector<RowGroupZoneMap> zone_maps_;
+  std::vector<std::vector<Encoding>> encodings_;
+  std::vector<int64_t> page_index_offsets_;
+  std::vector<int64_t> bloom_filter_offsets_;
+  std::vector<int64_t> ngram_filter_offsets_;
+  std::vector<int64_t> ndv_estimates_;
 };
 
 class FileWriter {
  public:
-  explicit FileWriter(const std::string& path, Schema schema)
-      : path_(path), schema_(std::move(schema)), output_(path, std::ios::binary) {
+  struct Options {
+    // Controls which encoding is chosen for each column chunk.
+    EncodingOptions encoding;
+    // Rows per page of the page index (min/max of every column for sub-ranges of a row group). 0 disables it.
+    int64_t page_index_rows = 8192;
+    // Columns that get a Bloom filter in every row group, used to skip row groups for equality predicates.
+    std::vector<std::string> bloom_filter_columns;
+    // Target false positive probability of the Bloom filters.
+    double bloom_filter_fpp = 0.01;
+    // String columns that get an n-gram filter in every row group, used to skip row groups for substring lookups.
+    std::vector<std::string> ngram_filter_columns;
+    // Target false positive probability of a single n-gram lookup in the n-gram filters.
+    double ngram_filter_fpp = 0.01;
+    // Store an estimate of the number of distinct values of every column, used by the planner to size aggregations.
+    bool ndv_estimates = true;
+
+    Options() {}
+  };
+
+  explicit FileWriter(const std::string& path, Schema schema, Options options = Options{})
+      : path_(path), schema_(std::move(schema)), options_(std::move(options)), output_(path, std::ios::binary) {
     ASSERT(output_.good());
+    if (options_.ndv_estimates) {
+      ndv_sketches_.resize(schema_.Fields().size());
+    }
   }
 
   void AppendRowGroup(std::vector<Column> columns) {
@@ -130,6 +305,16 @@ class FileWriter {
 
     // Compute zone map for this row group
     zone_maps_.push_back(ComputeRowGroupZoneMap(columns));
+    page_indexes_.push_back(options_.page_index_rows > 0 ? SerializePageIndex(columns) : std::string());
+    bloom_filters_.push_back(SerializeFilters(columns, options_.bloom_filter_columns, [this](const Column& column) {
+      return ComputeBloomFilter(column, options_.bloom_filter_fpp);
+    }));
+    ngram_filters_.push_back(SerializeFilters(columns, options_.ngram_filter_columns, [this](const Column& column) {
+      return ComputeNgramFilter(column, options_.ngram_filter_fpp);
+    }));
+    for (size_t i = 0; i < ndv_sketches_.size(); ++i) {
+      ndv_sketches_[i].InsertColumn(columns[i]);
+    }
 
     Write(row_count, output_);
 
@@ -148,10 +333,17 @@ class FileWriter {
 
     std::vector<int64_t> column_offsets;
     column_offsets.reserve(columns.size());
+    std::vector<Encoding> encodings;
+    encodings.reserve(columns.size());
     for (const auto& column : columns) {
       column_offsets.emplace_back(static_cast<int64_t>(output_.tellp()) - row_group_start);
-      std::visit([this](const auto& typed_column) { this->WriteColumn(typed_column, output_); }, column.Values());
+      std::visit(
+          [this, &encodings]<Type type>(const ArrayType<type>& typed_column) {
+            encodings.push_back(EncodeColumn(typed_column, options_.encoding, output_));
+          },
+          column.Values());
     }
+    encodings_.push_back(std::move(encodings));
 
     const std::streampos end_pos = output_.tellp();
     output_.seekp(offsets_pos, std::ios::beg);
@@ -163,8 +355,22 @@ class FileWriter {
 
   void Finalize() && {
     {
+      // Page indexes and filters go after the last row group, right before the metadata.
+      std::vector<int64_t> page_index_offsets = WriteSections(page_indexes_);
+      std::vector<int64_t> bloom_filter_offsets = WriteSections(bloom_filters_);
+      std::vector<int64_t> ngram_filter_offsets = WriteSections(ngram_filters_);
+
+      std::vector<int64_t> ndv_estimates;
+      ndv_estimates.reserve(ndv_sketches_.size());
+      for (const auto& sketch : ndv_sketches_) {
+        ndv_estimates.push_back(sketch.Estimate());
+      }
+
       std::string serialized_metadata =
-          Metadata(schema_, row_group_offsets_, row_group_row_counts_, zone_maps_).Serialize();
+          Metadata(schema_, row_group_offsets_, row_group_row_counts_, zone_maps_, encodings_,
+                   std::move(page_index_offsets), std::move(bloom_filter_offsets), std::move(ngram_filter_offsets),
+                   std::move(ndv_estimates))
+              .Serialize();
       Write(serialized_metadata, output_);
 
       int64_t metadata_size = serialized_metadata.size() + sizeof(int64_t);
@@ -176,64 +382,146 @@ class FileWriter {
   }
 
  private:
-  template <Type type>
-  void WriteColumn(const ArrayType<type>& values, std::ostream& output) {
-    const int64_t size = static_cast<int64_t>(values.size());
-    Write(size, output);
-    for (const auto& value : values) {
-      Write(value, output);
+  // Writes the non-empty sections and returns their offsets, -1 for empty ones.
+  std::vector<int64_t> WriteSections(const std::vector<std::string>& sections) {
+    std::vector<int64_t> offsets;
+    offsets.reserve(sections.size());
+    for (const auto& section : sections) {
+      if (section.empty()) {
+        offsets.push_back(-1);
+        continue;
+      }
+      offsets.push_back(output_.tellp());
+      output_.write(section.data(), static_cast<std::streamsize>(section.size()));
+    }
+    return offsets;
+  }
+
+  // Layout of a row group section with one optional entry per column:
+  //   column_count:int64
+  //   column_offsets[column_count]:int64 (relative to the section start, -1 if the column has no entry)
+  //   Write(entry) for each column that has one
+  // Returns an empty string if no column has an entry.
+  static std::string SerializeColumnEntries(const std::vector<std::optional<std::string>>& entries) {
+    if (std::none_of(entries.begin(), entries.end(), [](const auto& entry) { return entry.has_value(); })) {
+      return {};
+    }
+
+    std::stringstream out;
+    const int64_t column_count = static_cast<int64_t>(entries.size());
+    Write(column_count, out);
+    int64_t offset = static_cast<int64_t>(sizeof(int64_t)) * (1 + column_count);
+    for (const auto& entry : entries) {
+      Write(entry.has_value() ? offset : int64_t{-1}, out);
+      if (entry.has_value()) {
+        offset += static_cast<int64_t>(sizeof(int64_t) + entry->size());
+      }
+    }
+    for (const auto& entry : entries) {
+      if (entry.has_value()) {
+        Write(*entry, out);
+      }
+    }
+    return out.str();
+  }
+
+  std::string SerializePageIndex(const std::vector<Column>& columns) const {
+    std::vector<std::optional<std::string>> entries;
+    entries.reserve(columns.size());
+    for (const auto& column : columns) {
+      entries.emplace_back(ComputePageZoneMap(column, options_.page_index_rows).Serialize());
     }
+    return SerializeColumnEntries(entries);
+  }
+
+  // Builds a filter with `compute` for each of the named columns.
+  template <typename ComputeFilter>
+  std::string SerializeFilters(const std::vector<Column>& columns, const std::vector<std::string>& names,
+                               ComputeFilter&& compute) const {
+    std::vector<std::optional<std::string>> entries(columns.size());
+    for (const auto& name : names) {
+      const auto& fields = schema_.Fields();
+      auto it = std::find_if(fields.begin(), fields.end(), [&name](const Field& field) { return field.name == name; });
+      ASSERT_WITH_MESSAGE(it != fields.end(), "Filter column '" + name + "' is not found in schema");
+      const size_t column_idx = it - fields.begin();
+      entries[column_idx] = compute(columns[column_idx]).Serialize();
+    }
+    return SerializeColumnEntries(entries);
   }
 
   std::string path_;
   Schema schema_;
+  Options options_;
 
   std::ofstream output_;
 
   std::vector<int64_t> row_group_offsets_;
   std::vector<int64_t> row_group_row_counts_;
   std::vector<RowGroupZoneMap> zone_maps_;
+  std::vector<std::vector<Encoding>> encodings_;
+  std::vector<std::string> page_indexes_;
+  std::vector<std::string> bloom_filters_;
+  std::vector<std::string> ngram_filters_;
+  std::vector<HyperLogLog> ndv_sketches_;
 };
 
-namespace internal {
-template <Type type>
-ArrayType<type> ReadColumn(std::istream& input) {
-  const int64_t size = Read<int64_t>(input);
-  ArrayType<type> result;
-  result.reserve(size);
-  for (int64_t i = 0; i < size; ++i) {
-    result.emplace_back(Read<PhysicalType<type>>(input));
-  }
-  return result;
-}
-}  // namespace internal
-
 class FileReader {
  public:
-  explicit FileReader(const std::string& path)
-      : file_(path, std::ios::binary), metadata_([&]() {
-          ASSERT(file_.good());
+  struct Options {
+    // Map the whole file into memory instead of reading it through a stream. Column chunks are then decoded straight
+    // from the mapping, without reading them into a buffer first.
+    bool use_mmap = false;
+
+    Options() {}
+  };
+
+  explicit FileReader(const std::string& path, Options options = Options{})
+      : mapped_(options.use_mmap ? std::make_unique<MappedFile>(path) : nullptr),
+        file_(options.use_mmap ? std::ifstream() : std::ifstream(path, std::ios::binary)),
+        metadata_([&]() {
+          if (mapped_ == nullptr) {
+            ASSERT(file_.good());
+            file_.seekg(0, std::ios::end);
+            file_size_ = file_.tellg();
+          } else {
+            file_size_ = mapped_->Size();
+          }
 
           constexpr int64_t kShift = sizeof(int64_t);
+          ASSERT(file_size_ >= 2 * kShift);
 
           // Footer layout:
           //   ... data ...
           //   Write(serialized_metadata)  // string = [len:int64][bytes...]
           //   Write(metadata_size:int64)  // includes string length prefix
           //   Write(kColumnarFooterMagic:int64)
-          file_.seekg(-kShift, std::ios::end);
-          int64_t magic = Read<int64_t>(file_);
+          std::string buffer;
+          const char* cursor = ReadBytes(file_size_ - 2 * kShift, 2 * kShift, buffer).data();
+          const int64_t metadata_size = ReadFromBuffer<int64_t>(cursor);
+          const int64_t magic = ReadFromBuffer<int64_t>(cursor);
           ASSERT(magic == kColumnarFooterMagic);
 
-          file_.seekg(-(2 * kShift), std::ios::end);
-          int64_t metadata_size = Read<int64_t>(file_);
-          file_.seekg(-(metadata_size + 2 * kShift), std::ios::end);
-
-          std::string serialized_metadata = Read<std::string>(file_);
-          ASSERT(metadata_size == static_cast<int64_t>(serialized_metadata.size() + sizeof(int64_t)));
-
-          return Metadata::Deserialize(serialized_metadata);
-        }()) {}
+          data_end_ = file_size_ - 2 * kShift - metadata_size;
+          ASSERT(metadata_size >= kShift && data_end_ >= 0);
+
+          std::string_view serialized = ReadBytes(data_end_, metadata_size, buffer);
+          cursor = serialized.data();
+          const int64_t serialized_size = ReadFromBuffer<int64_t>(cursor);
+          ASSERT(metadata_size == static_cast<int64_t>(serialized_size + sizeof(int64_t)));
+
+          return Metadata::Deserialize(std::string(cursor, serialized_size));
+        }()) {
+    // Page indexes and filters are written after the last row group.
+    row_groups_end_ = data_end_;
+    for (const auto* offsets : {&metadata_.GetPageIndexOffsets(), &metadata_.GetBloomFilterOffsets(),
+                                &metadata_.GetNgramFilterOffsets()}) {
+      for (int64_t offset : *offsets) {
+        if (offset >= 0) {
+          row_groups_end_ = std::min(row_groups_end_, offset);
+        }
+      }
+    }
+  }
 
   const Schema& GetSchema() const { return metadata_.GetSchema(); }
 
@@ -245,10 +533,30 @@ class FileReader {
     return metadata_.GetRowGroupRowCounts()[row_group_idx];
   }
 
+  bool IsMemoryMapped() const { return mapped_ != nullptr; }
+
+  Encoding GetColumnEncoding(uint64_t row_group_idx, uint64_t column_idx) const {
+    ASSERT(row_group_idx < RowGroupCount());
+    ASSERT(column_idx < ColumnCount());
+    return metadata_.GetEncoding(row_group_idx, column_idx);
+  }
+
   bool HasZoneMaps() const { return metadata_.HasZoneMaps(); }
 
   const std::vector<RowGroupZoneMap>& GetZoneMaps() const { return metadata_.GetZoneMaps(); }
 
+  // Estimated number of distinct values of the column in the whole file, if the writer stored one.
+  std::optional<int64_t> GetNdvEstimate(uint64_t column_idx) const {
+    ASSERT(column_idx < ColumnCount());
+    const int64_t ndv = metadata_.GetNdvEstimate(column_idx);
+    return ndv >= 0 ? std::optional<int64_t>(ndv) : std::nullopt;
+  }
+
+  int64_t RowCount() const {
+    const auto& counts = metadata_.GetRowGroupRowCounts();
+    return std::accumulate(counts.begin(), counts.end(), int64_t{0});
+  }
+
   bool CanSkipRowGroupForRange(uint64_t row_group_idx, uint64_t column_idx, const Value& min_val,
                                const Value& max_val) const {
     if (!HasZoneMaps() || row_group_idx >= metadata_.GetZoneMaps().size()) {
@@ -261,70 +569,206 @@ class FileReader {
     return zm.columns[column_idx].CanSkipForRange(min_val, max_val);
   }
 
-  std::vector<Column> ReadRowGroup(uint64_t row_group_idx) const {
+  bool HasPageIndex(uint64_t row_group_idx) const {
     ASSERT(row_group_idx < RowGroupCount());
+    return metadata_.GetPageIndexOffset(row_group_idx) >= 0;
+  }
 
-    const int64_t offset = metadata_.GetRowGroupOffsets()[row_group_idx];
-    file_.seekg(offset, std::ios::beg);
+  // Page-level min/max of a column chunk. Requires HasPageIndex(row_group_idx).
+  PageZoneMap ReadPageZoneMap(uint64_t row_group_idx, uint64_t column_idx) const {
+    ASSERT(HasPageIndex(row_group_idx));
 
-    const int64_t row_count = Read<int64_t>(file_);
-    ASSERT(row_count == metadata_.GetRowGroupRowCounts()[row_group_idx]);
+    std::string buffer;
+    const int64_t entry_offset = ColumnEntryOffset(metadata_.GetPageIndexOffset(row_group_idx), column_idx);
+    ASSERT(entry_offset >= 0);
+    return PageZoneMap::Deserialize(ReadColumnEntry(entry_offset, buffer));
+  }
+
+  bool HasBloomFilter(uint64_t row_group_idx, uint64_t column_idx) const {
+    ASSERT(row_group_idx < RowGroupCount());
+    const int64_t offset = metadata_.GetBloomFilterOffset(row_group_idx);
+    return offset >= 0 && ColumnEntryOffset(offset, column_idx) >= 0;
+  }
 
-    std::vector<int64_t> column_offsets(ColumnCount());
-    for (uint64_t i = 0; i < ColumnCount(); ++i) {
-      column_offsets[i] = Read<int64_t>(file_);
-      ASSERT(column_offsets[i] >= 0);
+  // Returns false if the column chunk definitely does not contain `value`. Only the filter block the value maps to
+  // is read. A value of another type than the column hashes differently from the equal values of the column, so it
+  // may always be contained. Requires HasBloomFilter(row_group_idx, column_idx).
+  bool BloomFilterMayContain(uint64_t row_group_idx, uint64_t column_idx, const Value& value) const {
+    ASSERT(HasBloomFilter(row_group_idx, column_idx));
+    if (value.GetType() != metadata_.GetSchema().Fields()[column_idx].type) {
+      return true;
     }
 
+    const int64_t entry_offset = ColumnEntryOffset(metadata_.GetBloomFilterOffset(row_group_idx), column_idx);
+    return FilterMayContainAll(entry_offset, {BloomHash(value)});
+  }
+
+  bool HasNgramFilter(uint64_t row_group_idx, uint64_t column_idx) const {
+    ASSERT(row_group_idx < RowGroupCount());
+    const int64_t offset = metadata_.GetNgramFilterOffset(row_group_idx);
+    return offset >= 0 && ColumnEntryOffset(offset, column_idx) >= 0;
+  }
+
+  // Returns false if no value of the column chunk contains `substring`. Substrings shorter than kNgramLength are
+  // always assumed to be present. Requires HasNgramFilter(row_group_idx, column_idx).
+  bool NgramFilterMayContain(uint64_t row_group_idx, uint64_t column_idx, std::string_view substring) const {
+    ASSERT(HasNgramFilter(row_group_idx, column_idx));
+
+    std::vector<uint64_t> hashes;
+    ForEachNgramHash(substring, [&hashes](uint64_t hash) { hashes.push_back(hash); });
+    const int64_t entry_offset = ColumnEntryOffset(metadata_.GetNgramFilterOffset(row_group_idx), column_idx);
+    return FilterMayContainAll(entry_offset, hashes);
+  }
+
+  bool CanSkipRowGroupForContains(uint64_t row_group_idx, uint64_t column_idx, std::string_view substring) const {
+    return HasNgramFilter(row_group_idx, column_idx) && !NgramFilterMayContain(row_group_idx, column_idx, substring);
+  }
+
+  // Returns false if rows of the row group definitely do not contain `value` in the column, judging by the zone map
+  // and the Bloom filter if there is one.
+  bool CanSkipRowGroupForEqual(uint64_t row_group_idx, uint64_t column_idx, const Value& value) const {
+    if (CanSkipRowGroupForRange(row_group_idx, column_idx, value, value)) {
+      return true;
+    }
+    return HasBloomFilter(row_group_idx, column_idx) && !BloomFilterMayContain(row_group_idx, column_idx, value);
+  }
+
+  std::vector<Column> ReadRowGroup(uint64_t row_group_idx) const {
     std::vector<Column> result;
     result.reserve(ColumnCount());
     for (uint64_t col_idx = 0; col_idx < ColumnCount(); ++col_idx) {
-      const auto& field = metadata_.GetSchema().Fields()[col_idx];
-      file_.seekg(offset + column_offsets[col_idx], std::ios::beg);
-      Dispatch(
-          [&]<Type type>(Tag<type>) {
-            auto col = internal::ReadColumn<type>(file_);
-            ASSERT(static_cast<int64_t>(col.size()) == row_count);
-            result.emplace_back(std::move(col));
-          },
-          field.type);
+      result.emplace_back(ReadRowGroupColumn(row_group_idx, col_idx));
     }
-
     return result;
   }
 
   Column ReadRowGroupColumn(uint64_t row_group_idx, uint64_t column_idx) const {
+    std::string buffer;
+    std::string_view chunk = ReadColumnChunk(row_group_idx, column_idx, buffer);
+    const int64_t row_count = RowGroupRowCount(row_group_idx);
+
+    return Dispatch(
+        [&]<Type type>(Tag<type>) {
+          auto col = DecodeColumn<type>(chunk, metadata_.GetEncoding(row_group_idx, column_idx));
+          ASSERT(static_cast<int64_t>(col.size()) == row_count);
+          return Column(std::move(col));
+        },
+        metadata_.GetSchema().Fields()[column_idx].type);
+  }
+
+  // Reads only rows in `ranges` (sorted, non-overlapping) of a column chunk and returns them concatenated. Values
+  // outside the ranges are skipped without being decoded where the encoding allows it.
+  Column ReadRowGroupColumnRanges(uint64_t row_group_idx, uint64_t column_idx,
+                                  const std::vector<RowRange>& ranges) const {
+    std::string buffer;
+    std::string_view chunk = ReadColumnChunk(row_group_idx, column_idx, buffer);
+
+    return Dispatch(
+        [&]<Type type>(Tag<type>) {
+          return Column(DecodeColumnRanges<type>(chunk, metadata_.GetEncoding(row_group_idx, column_idx), ranges));
+        },
+        metadata_.GetSchema().Fields()[column_idx].type);
+  }
+
+ private:
+  // Returns `size` bytes starting at `offset`. With a mapping this is a view into it, otherwise the bytes are read
+  // into `buffer`.
+  std::string_view ReadBytes(int64_t offset, int64_t size, std::string& buffer) const {
+    ASSERT(offset >= 0 && size >= 0 && offset + size <= file_size_);
+    if (mapped_ != nullptr) {
+      return mapped_->View(offset, size);
+    }
+    buffer.resize(size);
+    file_.seekg(offset, std::ios::beg);
+    file_.read(buffer.data(), size);
+    ASSERT(file_.good());
+    return buffer;
+  }
+
+  // Absolute offset of the entry of a column in a section written by FileWriter::SerializeColumnEntries, or -1 if
+  // the column has none.
+  int64_t ColumnEntryOffset(int64_t section_offset, uint64_t column_idx) const {
+    ASSERT(column_idx < ColumnCount());
+    std::string buffer;
+    const int64_t header_size = static_cast<int64_t>(sizeof(int64_t) * (1 + ColumnCount()));
+    const char* cursor = ReadBytes(section_offset, header_size, buffer).data();
+    const int64_t column_count = ReadFromBuffer<int64_t>(cursor);
+    ASSERT(column_count == static_cast<int64_t>(ColumnCount()));
+
+    cursor += sizeof(int64_t) * column_idx;
+    const int64_t entry_offset = ReadFromBuffer<int64_t>(cursor);
+    return entry_offset < 0 ? -1 : section_offset + entry_offset;
+  }
+
+  // Checks hashes against the Bloom filter stored in the entry at `entry_offset`, reading only the blocks they map
+  // to. See BloomFilter::Serialize for the layout after the entry's length prefix.
+  bool FilterMayContainAll(int64_t entry_offset, const std::vector<uint64_t>& hashes) const {
+    ASSERT(entry_offset >= 0);
+    std::string buffer;
+    const int64_t filter_offset = entry_offset + sizeof(int64_t);
+    const char* cursor = ReadBytes(filter_offset, sizeof(int64_t), buffer).data();
+    const int64_t block_count = ReadFromBuffer<int64_t>(cursor);
+    ASSERT(block_count > 0);
+
+    for (uint64_t hash : hashes) {
+      const int64_t block_offset =
+          filter_offset + sizeof(int64_t) + BloomFilter::BlockIndex(hash, block_count) * BloomFilter::kBlockBytes;
+      if (!BloomFilter::BlockMayContain(ReadBytes(block_offset, BloomFilter::kBlockBytes, buffer).data(), hash)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Returns the bytes of a length-prefixed entry.
+  std::string_view ReadColumnEntry(int64_t entry_offset, std::string& buffer) const {
+    const char* cursor = ReadBytes(entry_offset, sizeof(int64_t), buffer).data();
+    const int64_t size = ReadFromBuffer<int64_t>(cursor);
+    return ReadBytes(entry_offset + sizeof(int64_t), size, buffer);
+  }
+
+  // Returns the bytes of a column chunk. The chunk ends where the next column (or row group, or the sections after
+  // the row groups, or footer) begins.
+  std::string_view ReadColumnChunk(uint64_t row_group_idx, uint64_t column_idx, std::string& buffer) const {
     ASSERT(row_group_idx < RowGroupCount());
     ASSERT(column_idx < ColumnCount());
 
+    // Row group layout:
+    //   row_count:int64
+    //   column_offsets[column_count]:int64 (relative to the row group start)
+    //   column_0 ...
     const int64_t offset = metadata_.GetRowGroupOffsets()[row_group_idx];
-    file_.seekg(offset, std::ios::beg);
+    const int64_t header_size = static_cast<int64_t>(sizeof(int64_t) * (1 + ColumnCount()));
+    const char* cursor = ReadBytes(offset, header_size, buffer).data();
 
-    const int64_t row_count = Read<int64_t>(file_);
+    const int64_t row_count = ReadFromBuffer<int64_t>(cursor);
     ASSERT(row_count == metadata_.GetRowGroupRowCounts()[row_group_idx]);
 
-    // Read offsets table and jump directly to the requested column.
-    std::vector<int64_t> column_offsets(ColumnCount());
-    for (uint64_t i = 0; i < ColumnCount(); ++i) {
-      column_offsets[i] = Read<int64_t>(file_);
-      ASSERT(column_offsets[i] >= 0);
+    cursor += sizeof(int64_t) * column_idx;
+    const int64_t begin = ReadFromBuffer<int64_t>(cursor);
+    ASSERT(begin >= header_size);
+
+    int64_t end = 0;
+    if (column_idx + 1 < ColumnCount()) {
+      end = offset + ReadFromBuffer<int64_t>(cursor);
+    } else if (row_group_idx + 1 < RowGroupCount()) {
+      end = metadata_.GetRowGroupOffsets()[row_group_idx + 1];
+    } else {
+      end = row_groups_end_;
     }
+    ASSERT(offset + begin <= end);
 
-    const Type col_type = metadata_.GetSchema().Fields()[column_idx].type;
-    file_.seekg(offset + column_offsets[column_idx], std::ios::beg);
-
-    return Dispatch(
-        [&]<Type type>(Tag<type>) {
-          auto col = internal::ReadColumn<type>(file_);
-          ASSERT(static_cast<int64_t>(col.size()) == row_count);
-          return Column(std::move(col));
-        },
-        col_type);
+    return ReadBytes(offset + begin, end - (offset + begin), buffer);
   }
 
- private:
+  std::unique_ptr<MappedFile> mapped_;
   mutable std::ifstream file_;
+
+  int64_t file_size_ = 0;
+  int64_t data_end_ = 0;
+
   Metadata metadata_;
+  int64_t row_groups_end_ = 0;
 };
 
 }  // namespace ngn
@@ -0,0 +1,652 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "src/core/bit_packing.h"
+#include "src/core/serde.h"
+#include "src/core/type.h"
+#include "src/util/assert.h"
+#include "src/util/macro.h"
+
+namespace ngn {
+
+// Physical layout of a column chunk. It is chosen by the writer per row group and column and recorded in the file
+// metadata; files without this information use kPlain everywhere.
+//
+// Every chunk starts with the number of values as int64, followed by the encoding specific payload.
+enum class Encoding : int16_t {
+  // Fixed-width values back to back. Strings are stored as [length:int64][bytes...] per value.
+  kPlain = 0,
+  // Strings only: offsets[size + 1]:int64 followed by all string bytes back to back.
+  kStringOffsets = 1,
+  // Strings only: dictionary_size:int64, the distinct values in kStringOffsets layout, then codes[size]:int32
+  // indexing into the dictionary. Dictionary entries are stored in order of first occurrence.
+  kDictionary = 2,
+  // Integer, date and timestamp only: run_count:int64, run values[run_count], run lengths[run_count]:int32.
+  kRunLength = 3,
+  // Integer, date and timestamp only: reference:int64 (the chunk minimum), bit_width:int64, then the differences from
+  // the reference bit packed as described in bit_packing.h.
+  kBitPacked = 4,
+  // Date and timestamp only: first value:int64, then the size - 1 differences between consecutive values in the
+  // kBitPacked layout (reference:int64, bit_width:int64, packed words). Decoding is a prefix sum.
+  kDeltaBitPacked = 5,
+};
+
+inline bool IsValidEncoding(int16_t value) {
+  return value >= static_cast<int16_t>(Encoding::kPlain) && value <= static_cast<int16_t>(Encoding::kDeltaBitPacked);
+}
+
+// Types whose values are stored as a single signed integer and can use the integer encodings.
+template <Type type>
+inline constexpr bool kIsIntegerEncodable = type == Type::kInt16 || type == Type::kInt32 || type == Type::kInt64 ||
+                                            type == Type::kDate || type == Type::kTimestamp;
+
+// Types that are usually close to sorted inside a chunk and can use delta encoding.
+template <Type type>
+inline constexpr bool kIsDeltaEncodable = type == Type::kDate || type == Type::kTimestamp;
+
+struct EncodingOptions {
+  // A string chunk is dictionary encoded only if it has at most this many distinct values...
+  int64_t dictionary_max_distinct = std::numeric_limits<int32_t>::max();
+  // ...and the number of distinct values does not exceed this fraction of its size.
+  double dictionary_max_distinct_ratio = 0.5;
+  // Try run-length, bit-packed and (for dates and timestamps) delta encodings for integer, date and timestamp chunks.
+  // The smallest of them and plain is used; plain wins ties since it is the only layout that can be accessed in place.
+  bool integer_compression = true;
+
+  EncodingOptions() {}
+};
+
+// Distinct values of a string chunk and the code of every value.
+struct StringDictionary {
+  StringArray values;
+  std::vector<int32_t> codes;
+};
+
+// Builds the dictionary of `values`. Returns std::nullopt as soon as more than `max_distinct` distinct values are
+// seen.
+inline std::optional<StringDictionary> BuildStringDictionary(const StringArray& values, int64_t max_distinct) {
+  StringDictionary dictionary;
+  dictionary.codes.reserve(values.size());
+
+  std::unordered_map<std::string_view, int32_t> codes;
+  for (std::string_view value : values) {
+    auto [it, inserted] = codes.try_emplace(value, static_cast<int32_t>(codes.size()));
+    if (inserted) {
+      if (static_cast<int64_t>(codes.size()) > max_distinct) {
+        return std::nullopt;
+      }
+      dictionary.values.emplace_back(value);
+    }
+    dictionary.codes.push_back(it->second);
+  }
+  return dictionary;
+}
+
+// Rows [begin, end) of a column chunk.
+struct RowRange {
+  int64_t begin = 0;
+  int64_t end = 0;
+
+  int64_t Size() const { return end - begin; }
+
+  bool operator==(const RowRange& other) const = default;
+};
+
+namespace internal {
+
+template <typename T>
+void WriteRaw(const T* data, size_t count, std::ostream& out) {
+  out.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(count * sizeof(T)));
+}
+
+template <typename T>
+void ReadRaw(const char*& cursor, const char* end, T* data, size_t count) {
+  const size_t bytes = count * sizeof(T);
+  ASSERT(bytes <= static_cast<size_t>(end - cursor));
+  std::memcpy(data, cursor, bytes);
+  cursor += bytes;
+}
+
+// Ranges must be sorted, non-overlapping and lie inside [0, size).
+inline int64_t CheckRanges(const std::vector<RowRange>& ranges, int64_t size) {
+  int64_t total = 0;
+  int64_t previous_end = 0;
+  for (const auto& range : ranges) {
+    ASSERT(previous_end <= range.begin && range.begin <= range.end && range.end <= size);
+    previous_end = range.end;
+    total += range.Size();
+  }
+  return total;
+}
+
+// Copies the given ranges of a fixed-width array starting at `values` to `out`.
+template <typename T>
+void ReadRawRanges(const char* values, const char* end, const std::vector<RowRange>& ranges, T* out) {
+  for (const auto& range : ranges) {
+    ASSERT(static_cast<size_t>(range.end) * sizeof(T) <= static_cast<size_t>(end - values));
+    std::memcpy(out, values + range.begin * sizeof(T), range.Size() * sizeof(T));
+    out += range.Size();
+  }
+}
+
+// Slices already decoded values.
+template <Type type>
+ArrayType<type> SliceRanges(const ArrayType<type>& values, const std::vector<RowRange>& ranges) {
+  ArrayType<type> result;
+  for (const auto& range : ranges) {
+    if constexpr (type == Type::kString) {
+      result.AppendRange(values, range.begin, range.end);
+    } else {
+      result.insert(result.end(), values.begin() + range.begin, values.begin() + range.end);
+    }
+  }
+  return result;
+}
+
+inline void WriteStringOffsets(const StringArray& values, std::ostream& out) {
+  if (values.IsDictionaryEncoded()) {
+    StringArray materialized = values;
+    materialized.Materialize();
+    WriteStringOffsets(materialized, out);
+    return;
+  }
+  WriteRaw(values.Offsets().data(), values.Offsets().size(), out);
+  WriteRaw(values.Bytes().data(), values.Bytes().size(), out);
+}
+
+inline StringArray ReadStringOffsets(const char*& cursor, const char* end, int64_t size) {
+  std::vector<int64_t> offsets(size + 1);
+  ReadRaw(cursor, end, offsets.data(), offsets.size());
+  ASSERT(offsets.front() == 0);
+  for (size_t i = 1; i < offsets.size(); ++i) {
+    ASSERT(offsets[i - 1] <= offsets[i]);
+  }
+  ASSERT(offsets.back() <= end - cursor);
+  std::vector<char> bytes(offsets.back());
+  ReadRaw(cursor, end, bytes.data(), bytes.size());
+  return StringArray(std::move(offsets), std::move(bytes));
+}
+
+inline StringArray ReadStringOffsetsRanges(const char*& cursor, const char* end, int64_t size,
+                                           const std::vector<RowRange>& ranges) {
+  const char* const offsets_begin = cursor;
+  const char* const bytes_begin = offsets_begin + (size + 1) * sizeof(int64_t);
+  ASSERT(bytes_begin <= end);
+  const auto offset_at = [offsets_begin](int64_t i) {
+    const char* position = offsets_begin + i * sizeof(int64_t);
+    return ReadFromBuffer<int64_t>(position);
+  };
+
+  std::vector<int64_t> offsets(CheckRanges(ranges, size) + 1);
+  offsets[0] = 0;
+  std::vector<char> bytes;
+  int64_t position = 0;
+  for (const auto& range : ranges) {
+    const int64_t first = offset_at(range.begin);
+    const int64_t last = offset_at(range.end);
+    ASSERT(0 <= first && first <= last && last <= end - bytes_begin);
+
+    std::memcpy(offsets.data() + position + 1, offsets_begin + (range.begin + 1) * sizeof(int64_t),
+                range.Size() * sizeof(int64_t));
+    const int64_t shift = static_cast<int64_t>(bytes.size()) - first;
+    int64_t previous = first;
+    for (int64_t i = 1; i <= range.Size(); ++i) {
+      ASSERT(previous <= offsets[position + i]);
+      previous = offsets[position + i];
+      offsets[position + i] += shift;
+    }
+    bytes.insert(bytes.end(), bytes_begin + first, bytes_begin + last);
+    position += range.Size();
+  }
+  const int64_t total = offset_at(size);
+  ASSERT(0 <= total && total <= end - bytes_begin);
+  cursor = bytes_begin + total;
+  return StringArray(std::move(offsets), std::move(bytes));
+}
+
+inline void WriteDictionary(const StringDictionary& dictionary, std::ostream& out) {
+  Write(static_cast<int64_t>(dictionary.values.size()), out);
+  WriteStringOffsets(dictionary.values, out);
+  WriteRaw(dictionary.codes.data(), dictionary.codes.size(), out);
+}
+
+// The result references the dictionary instead of expanding it; see StringArray.
+inline StringArray ReadDictionary(const char*& cursor, const char* end, int64_t size,
+                                  const std::vector<RowRange>& ranges) {
+  ASSERT(sizeof(int64_t) <= static_cast<size_t>(end - cursor));
+  const int64_t dictionary_size = ReadFromBuffer<int64_t>(cursor);
+  ASSERT(dictionary_size >= 0 && dictionary_size <= std::numeric_limits<int32_t>::max());
+  auto dictionary = std::make_shared<const StringArray>(ReadStringOffsets(cursor, end, dictionary_size));
+
+  std::vector<int32_t> codes(CheckRanges(ranges, size));
+  ReadRawRanges(cursor, end, ranges, codes.data());
+  cursor += size * sizeof(int32_t);
+  for (int32_t code : codes) {
+    ASSERT(code >= 0 && code < dictionary_size);
+  }
+  return StringArray(std::move(dictionary), std::move(codes));
+}
+
+template <Type type>
+int64_t ToInt64(const PhysicalType<type>& value) {
+  if constexpr (type == Type::kDate || type == Type::kTimestamp) {
+    return value.value;
+  } else {
+    return static_cast<int64_t>(value);
+  }
+}
+
+template <Type type>
+PhysicalType<type> FromInt64(int64_t value) {
+  if constexpr (type == Type::kDate || type == Type::kTimestamp) {
+    return PhysicalType<type>{value};
+  } else {
+    return static_cast<PhysicalType<type>>(value);
+  }
+}
+
+inline int BitWidthForRange(int64_t min, int64_t max) {
+  return std::bit_width(static_cast<uint64_t>(max) - static_cast<uint64_t>(min));
+}
+
+// Differences between consecutive values are computed with wrapping arithmetic, so the encoding round-trips for any
+// input even if a difference does not fit into int64.
+inline int64_t WrappingDelta(int64_t from, int64_t to) {
+  return static_cast<int64_t>(static_cast<uint64_t>(to) - static_cast<uint64_t>(from));
+}
+
+struct IntegerChunkStats {
+  int64_t min = 0;
+  int64_t max = 0;
+  int64_t runs = 0;
+  int64_t delta_min = 0;
+  int64_t delta_max = 0;
+
+  int BitWidth() const { return BitWidthForRange(min, max); }
+  int DeltaBitWidth() const { return BitWidthForRange(delta_min, delta_max); }
+};
+
+template <Type type>
+IntegerChunkStats ComputeIntegerChunkStats(const ArrayType<type>& values) {
+  IntegerChunkStats stats;
+  if (values.empty()) {
+    return stats;
+  }
+  int64_t previous = ToInt64<type>(values[0]);
+  stats.min = stats.max = previous;
+  stats.runs = 1;
+  if (values.size() > 1) {
+    stats.delta_min = stats.delta_max = WrappingDelta(previous, ToInt64<type>(values[1]));
+  }
+  for (size_t i = 1; i < values.size(); ++i) {
+    const int64_t value = ToInt64<type>(values[i]);
+    const int64_t delta = WrappingDelta(previous, value);
+    stats.min = std::min(stats.min, value);
+    stats.max = std::max(stats.max, value);
+    stats.runs += values[i] != values[i - 1];
+    stats.delta_min = std::min(stats.delta_min, delta);
+    stats.delta_max = std::max(stats.delta_max, delta);
+    previous = value;
+  }
+  return stats;
+}
+
+template <Type type>
+void WriteRunLength(const ArrayType<type>& values, std::ostream& out) {
+  std::vector<PhysicalType<type>> run_values;
+  std::vector<int32_t> run_lengths;
+  for (size_t i = 0; i < values.size(); ++i) {
+    if (i > 0 && values[i] == run_values.back() && run_lengths.back() < std::numeric_limits<int32_t>::max()) {
+      ++run_lengths.back();
+    } else {
+      run_values.push_back(values[i]);
+      run_lengths.push_back(1);
+    }
+  }
+  Write(static_cast<int64_t>(run_values.size()), out);
+  WriteRaw(run_values.data(), run_values.size(), out);
+  WriteRaw(run_lengths.data(), run_lengths.size(), out);
+}
+
+template <Type type>
+ArrayType<type> ReadRunLength(const char*& cursor, const char* end, int64_t size, const std::vector<RowRange>& ranges) {
+  ASSERT(sizeof(int64_t) <= static_cast<size_t>(end - cursor));
+  const int64_t run_count = ReadFromBuffer<int64_t>(cursor);
+  ASSERT(run_count >= 0 && run_count <= size);
+  std::vector<PhysicalType<type>> run_values(run_count);
+  ReadRaw(cursor, end, run_values.data(), run_values.size());
+  std::vector<int32_t> run_lengths(run_count);
+  ReadRaw(cursor, end, run_lengths.data(), run_lengths.size());
+
+  int64_t total_length = 0;
+  for (int32_t length : run_lengths) {
+    ASSERT(length > 0);
+    total_length += length;
+  }
+  ASSERT(total_length == size);
+
+  ArrayType<type> result(CheckRanges(ranges, size));
+  auto out = result.begin();
+  int64_t run = 0;
+  int64_t run_begin = 0;
+  for (const auto& range : ranges) {
+    // An empty range may begin at `size`, past the last run.
+    if (range.Size() == 0) {
+      continue;
+    }
+    while (run_begin + run_lengths[run] <= range.begin) {
+      run_begin += run_lengths[run++];
+    }
+    for (int64_t position = range.begin; position < range.end;) {
+      const int64_t run_end = run_begin + run_lengths[run];
+      const int64_t count = std::min(range.end, run_end) - position;
+      out = std::fill_n(out, count, run_values[run]);
+      position += count;
+      if (position == run_end) {
+        run_begin = run_end;
+        ++run;
+      }
+    }
+  }
+  return result;
+}
+
+template <Type type>
+void WriteBitPacked(const ArrayType<type>& values, const IntegerChunkStats& stats, std::ostream& out) {
+  std::vector<uint64_t> deltas(values.size());
+  for (size_t i = 0; i < values.size(); ++i) {
+    deltas[i] = static_cast<uint64_t>(ToInt64<type>(values[i])) - static_cast<uint64_t>(stats.min);
+  }
+  const int bit_width = stats.BitWidth();
+  const std::vector<uint64_t> words = BitPack(deltas.data(), static_cast<int64_t>(deltas.size()), bit_width);
+
+  Write(stats.min, out);
+  Write(static_cast<int64_t>(bit_width), out);
+  WriteRaw(words.data(), words.size(), out);
+}
+
+template <Type type>
+ArrayType<type> ReadBitPacked(const char*& cursor, const char* end, int64_t size, const std::vector<RowRange>& ranges) {
+  ASSERT(2 * sizeof(int64_t) <= static_cast<size_t>(end - cursor));
+  const int64_t reference = ReadFromBuffer<int64_t>(cursor);
+  const int64_t bit_width = ReadFromBuffer<int64_t>(cursor);
+  ASSERT(bit_width >= 0 && bit_width <= 64);
+  const int64_t words_bytes = BitPackedWordCount(size, static_cast<int>(bit_width)) * sizeof(uint64_t);
+  ASSERT(words_bytes <= end - cursor);
+
+  ArrayType<type> result(CheckRanges(ranges, size));
+  int64_t position = 0;
+  for (const auto& range : ranges) {
+    BitUnpackRange(cursor, range.begin, range.end, static_cast<int>(bit_width), static_cast<uint64_t>(reference),
+                   [&result, position](const uint64_t* values, int64_t offset, int64_t count) {
+                     for (int64_t i = 0; i < count; ++i) {
+                       result[position + offset + i] = FromInt64<type>(static_cast<int64_t>(values[i]));
+                     }
+                   });
+    position += range.Size();
+  }
+  cursor += words_bytes;
+  return result;
+}
+
+template <Type type>
+void WriteDeltaBitPacked(const ArrayType<type>& values, const IntegerChunkStats& stats, std::ostream& out) {
+  ASSERT(!values.empty());
+  std::vector<uint64_t> deltas(values.size() - 1);
+  for (size_t i = 1; i < values.size(); ++i) {
+    const int64_t delta = WrappingDelta(ToInt64<type>(values[i - 1]), ToInt64<type>(values[i]));
+    deltas[i - 1] = static_cast<uint64_t>(delta) - static_cast<uint64_t>(stats.delta_min);
+  }
+  const int bit_width = stats.DeltaBitWidth();
+  const std::vector<uint64_t> words = BitPack(deltas.data(), static_cast<int64_t>(deltas.size()), bit_width);
+
+  Write(ToInt64<type>(values[0]), out);
+  Write(stats.delta_min, out);
+  Write(static_cast<int64_t>(bit_width), out);
+  WriteRaw(words.data(), words.size(), out);
+}
+
+template <Type type>
+ArrayType<type> ReadDeltaBitPacked(const char*& cursor, const char* end, int64_t size) {
+  ASSERT(size > 0);
+  ASSERT(3 * sizeof(int64_t) <= static_cast<size_t>(end - cursor));
+  const int64_t first = ReadFromBuffer<int64_t>(cursor);
+  const int64_t reference = ReadFromBuffer<int64_t>(cursor);
+  const int64_t bit_width = ReadFromBuffer<int64_t>(cursor);
+  ASSERT(bit_width >= 0 && bit_width <= 64);
+  const int64_t words_bytes = BitPackedWordCount(size - 1, static_cast<int>(bit_width)) * sizeof(uint64_t);
+  ASSERT(words_bytes <= end - cursor);
+
+  ArrayType<type> result(size);
+  result[0] = FromInt64<type>(first);
+  uint64_t carry = static_cast<uint64_t>(first);
+  BitUnpack(cursor, size - 1, static_cast<int>(bit_width), static_cast<uint64_t>(reference),
+            [&result, &carry](uint64_t* values, int64_t offset, int64_t count) {
+              carry = PrefixSum(values, count, carry);
+              for (int64_t i = 0; i < count; ++i) {
+                result[offset + i + 1] = FromInt64<type>(static_cast<int64_t>(values[i]));
+              }
+            });
+  cursor += words_bytes;
+  return result;
+}
+
+// Picks the smallest of plain, run-length, bit-packed and delta layouts.
+template <Type type>
+Encoding ChooseIntegerEncoding(const IntegerChunkStats& stats, int64_t size) {
+  constexpr int64_t kValueBytes = sizeof(PhysicalType<type>);
+  constexpr int64_t kHeaderBytes = sizeof(int64_t);
+  constexpr int64_t kWordBytes = sizeof(uint64_t);
+
+  Encoding best = Encoding::kPlain;
+  int64_t best_bytes = size * kValueBytes;
+  const auto consider = [&](Encoding encoding, int64_t bytes) {
+    if (bytes < best_bytes) {
+      best = encoding;
+      best_bytes = bytes;
+    }
+  };
+
+  consider(Encoding::kRunLength, kHeaderBytes + stats.runs * (kValueBytes + static_cast<int64_t>(sizeof(int32_t))));
+  consider(Encoding::kBitPacked, 2 * kHeaderBytes + BitPackedWordCount(size, stats.BitWidth()) * kWordBytes);
+  if constexpr (kIsDeltaEncodable<type>) {
+    consider(Encoding::kDeltaBitPacked,
+             3 * kHeaderBytes + BitPackedWordCount(size - 1, stats.DeltaBitWidth()) * kWordBytes);
+  }
+  return best;
+}
+
+}  // namespace internal
+
+template <Type type>
+void EncodeColumn(const ArrayType<type>& values, Encoding encoding, std::ostream& out) {
+  const int64_t size = static_cast<int64_t>(values.size());
+  Write(size, out);
+
+  if constexpr (type == Type::kString) {
+    switch (encoding) {
+      case Encoding::kPlain:
+        for (std::string_view value : values) {
+          Write(static_cast<int64_t>(value.size()), out);
+          out.write(value.data(), static_cast<std::streamsize>(value.size()));
+        }
+        return;
+      case Encoding::kStringOffsets:
+        internal::WriteStringOffsets(values, out);
+        return;
+      case Encoding::kDictionary:
+        internal::WriteDictionary(*BuildStringDictionary(values, std::numeric_limits<int32_t>::max()), out);
+        return;
+
+      default:
+        break;
+    }
+  } else {
+    if (encoding == Encoding::kPlain) {
+      internal::WriteRaw(values.data(), values.size(), out);
+      return;
+    }
+    if constexpr (kIsIntegerEncodable<type>) {
+      switch (encoding) {
+        case Encoding::kRunLength:
+          internal::WriteRunLength(values, out);
+          return;
+        case Encoding::kBitPacked:
+          internal::WriteBitPacked(values, internal::ComputeIntegerChunkStats(values), out);
+          return;
+        case Encoding::kDeltaBitPacked:
+          if constexpr (kIsDeltaEncodable<type>) {
+            if (!values.empty()) {
+              internal::WriteDeltaBitPacked(values, internal::ComputeIntegerChunkStats(values), out);
+              return;
+            }
+          }
+          break;
+        default:
+          break;
+      }
+    }
+  }
+  THROW_RUNTIME_ERROR("Unsupported encoding " + std::to_string(static_cast<int>(encoding)) + " for type " +
+                      std::to_string(static_cast<int>(type)));
+}
+
+namespace internal {
+
+// Decodes the given ranges of a chunk, or the whole chunk if `ranges` is null. Encodings that allow it decode only
+// the requested rows; delta and legacy plain strings are decoded in full and then sliced.
+template <Type type>
+ArrayType<type> DecodeChunk(std::string_view chunk, Encoding encoding, const std::vector<RowRange>* ranges) {
+  const char* cursor = chunk.data();
+  const char* const end = chunk.data() + chunk.size();
+
+  ASSERT(sizeof(int64_t) <= chunk.size());
+  const int64_t size = ReadFromBuffer<int64_t>(cursor);
+  ASSERT(size >= 0);
+
+  const std::vector<RowRange> all_rows = ranges == nullptr ? std::vector<RowRange>{RowRange{0, size}}
+                                                           : std::vector<RowRange>{};
+  const std::vector<RowRange>& rows = ranges == nullptr ? all_rows : *ranges;
+  const auto slice = [&](ArrayType<type> values) {
+    return ranges == nullptr ? values : SliceRanges(values, *ranges);
+  };
+
+  if constexpr (type == Type::kString) {
+    switch (encoding) {
+      case Encoding::kPlain: {
+        ArrayType<type> result;
+        result.reserve(size);
+        for (int64_t i = 0; i < size; ++i) {
+          ASSERT(sizeof(int64_t) <= static_cast<size_t>(end - cursor));
+          const int64_t length = ReadFromBuffer<int64_t>(cursor);
+          ASSERT(length >= 0 && length <= end - cursor);
+          result.emplace_back(std::string_view(cursor, length));
+          cursor += length;
+        }
+        return slice(std::move(result));
+      }
+      case Encoding::kStringOffsets:
+        return ArrayType<type>(ReadStringOffsetsRanges(cursor, end, size, rows));
+      case Encoding::kDictionary:
+        return ArrayType<type>(ReadDictionary(cursor, end, size, rows));
+      default:
+        break;
+    }
+  } else {
+    if (encoding == Encoding::kPlain) {
+      ArrayType<type> result(CheckRanges(rows, size));
+      ReadRawRanges(cursor, end, rows, result.data());
+      return result;
+    }
+    if constexpr (kIsIntegerEncodable<type>) {
+      switch (encoding) {
+        case Encoding::kRunLength:
+          return ReadRunLength<type>(cursor, end, size, rows);
+        case Encoding::kBitPacked:
+          return ReadBitPacked<type>(cursor, end, size, rows);
+        case Encoding::kDeltaBitPacked:
+          if constexpr (kIsDeltaEncodable<type>) {
+            return slice(ReadDeltaBitPacked<type>(cursor, end, size));
+          }
+          break;
+        default:
+          break;
+      }
+    }
+  }
+  THROW_RUNTIME_ERROR("Unsupported encoding " + std::to_string(static_cast<int>(encoding)) + " for type " +
+                      std::to_string(static_cast<int>(type)));
+}
+
+}  // namespace internal
+
+template <Type type>
+ArrayType<type> DecodeColumn(std::string_view chunk, Encoding encoding) {
+  return internal::DecodeChunk<type>(chunk, encoding, nullptr);
+}
+
+// Decodes only rows in `ranges` (sorted and non-overlapping) and returns them concatenated.
+template <Type type>
+ArrayType<type> DecodeColumnRanges(std::string_view chunk, Encoding encoding, const std::vector<RowRange>& ranges) {
+  return internal::DecodeChunk<type>(chunk, encoding, &ranges);
+}
+
+// Picks the encoding for `values`, writes the chunk and returns the chosen encoding.
+template <Type type>
+Encoding EncodeColumn(const ArrayType<type>& values, const EncodingOptions& options, std::ostream& out) {
+  if constexpr (type == Type::kString) {
+    const int64_t size = static_cast<int64_t>(values.size());
+    const int64_t max_distinct = std::min<int64_t>(
+        options.dictionary_max_distinct, static_cast<int64_t>(options.dictionary_max_distinct_ratio * size));
+    if (size > 0 && max_distinct > 0) {
+      if (auto dictionary = BuildStringDictionary(values, max_distinct)) {
+        Write(size, out);
+        internal::WriteDictionary(*dictionary, out);
+        return Encoding::kDictionary;
+      }
+    }
+    EncodeColumn(values, Encoding::kStringOffsets, out);
+    return Encoding::kStringOffsets;
+  } else if constexpr (kIsIntegerEncodable<type>) {
+    if (!options.integer_compression || values.empty()) {
+      EncodeColumn(values, Encoding::kPlain, out);
+      return Encoding::kPlain;
+    }
+    const internal::IntegerChunkStats stats = internal::ComputeIntegerChunkStats(values);
+    const Encoding encoding = internal::ChooseIntegerEncoding<type>(stats, static_cast<int64_t>(values.size()));
+    Write(static_cast<int64_t>(values.size()), out);
+    switch (encoding) {
+      case Encoding::kRunLength:
+        internal::WriteRunLength(values, out);
+        break;
+      case Encoding::kBitPacked:
+        internal::WriteBitPacked(values, stats, out);
+        break;
+      case Encoding::kDeltaBitPacked:
+        if constexpr (kIsDeltaEncodable<type>) {
+          internal::WriteDeltaBitPacked(values, stats, out);
+        }
+        break;
+      default:
+        internal::WriteRaw(values.data(), values.size(), out);
+        break;
+    }
+    return encoding;
+  } else {
+    EncodeColumn(values, Encoding::kPlain, out);
+    return Encoding::kPlain;
+  }
+}
+
+}  // namespace ngn
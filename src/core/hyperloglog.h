@@ -0,0 +1,72 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <variant>
+
+#include "src/core/bloom_filter.h"
+#include "src/core/column.h"
+#include "src/core/type.h"
+
+namespace ngn {
+
+// HyperLogLog sketch estimating the number of distinct values of a column, with a standard error of about 1.6%. The
+// writer keeps one sketch per column and stores the estimate in the file metadata; the sketch itself is not stored.
+class HyperLogLog {
+ public:
+  static constexpr int kPrecision = 12;
+  static constexpr int64_t kRegisters = int64_t{1} << kPrecision;
+
+  // `hash` must be well mixed, e.g. BloomHash(value).
+  void Insert(uint64_t hash) {
+    const uint64_t index = hash >> (64 - kPrecision);
+    // Position of the first set bit of the remaining bits; a sentinel bit bounds it.
+    const uint64_t rest = (hash << kPrecision) | (uint64_t{1} << (kPrecision - 1));
+    const auto rank = static_cast<uint8_t>(std::countl_zero(rest) + 1);
+    registers_[index] = std::max(registers_[index], rank);
+  }
+
+  // Adds every value of `column`. Dictionary encoded strings only hash their dictionary.
+  void InsertColumn(const Column& column) {
+    std::visit(
+        [this]<Type type>(const ArrayType<type>& values) {
+          if constexpr (type == Type::kString) {
+            if (values.IsDictionaryEncoded()) {
+              for (std::string_view value : *values.Dictionary()) {
+                Insert(BloomHash(value));
+              }
+              return;
+            }
+          }
+          for (const auto& value : values) {
+            Insert(BloomHash(value));
+          }
+        },
+        column.Values());
+  }
+
+  int64_t Estimate() const {
+    constexpr double kAlpha = 0.7213 / (1.0 + 1.079 / static_cast<double>(kRegisters));
+    double sum = 0;
+    int64_t zeros = 0;
+    for (uint8_t rank : registers_) {
+      sum += std::ldexp(1.0, -rank);
+      zeros += rank == 0 ? 1 : 0;
+    }
+    const double m = static_cast<double>(kRegisters);
+    double estimate = kAlpha * m * m / sum;
+    // Linear counting is more precise while many registers are still empty.
+    if (estimate <= 2.5 * m && zeros != 0) {
+      estimate = m * std::log(m / static_cast<double>(zeros));
+    }
+    return std::llround(estimate);
+  }
+
+ private:
+  std::array<uint8_t, kRegisters> registers_ = {};
+};
+
+}  // namespace ngn
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "src/util/assert.h"
+#include "src/util/macro.h"
+
+namespace ngn {
+
+// Read-only memory mapping of a whole file. The mapping lives as long as the object.
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    ASSERT_WITH_MESSAGE(fd >= 0, "Failed to open file: " + path);
+
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+      ::close(fd);
+      THROW_RUNTIME_ERROR("Failed to stat file: " + path);
+    }
+    size_ = static_cast<int64_t>(st.st_size);
+
+    if (size_ > 0) {
+      void* addr = ::mmap(nullptr, static_cast<size_t>(size_), PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr == MAP_FAILED) {
+        ::close(fd);
+        THROW_RUNTIME_ERROR("Failed to mmap file: " + path);
+      }
+      data_ = static_cast<char*>(addr);
+    }
+    ::close(fd);
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  ~MappedFile() {
+    if (data_ != nullptr) {
+      ::munmap(data_, static_cast<size_t>(size_));
+    }
+  }
+
+  const char* Data() const { return data_; }
+  int64_t Size() const { return size_; }
+
+  std::string_view View(int64_t offset, int64_t size) const {
+    ASSERT(offset >= 0 && size >= 0 && offset + size <= size_);
+    return std::string_view(data_ + offset, static_cast<size_t>(size));
+  }
+
+ private:
+  char* data_ = nullptr;
+  int64_t size_ = 0;
+};
+
+}  // namespace ngn
@@ -1,9 +1,13 @@
 #pragma once
 
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <string>
+#include <type_traits>
 
 #include "src/core/type.h"
+#include "src/util/assert.h"
 
 namespace ngn {
 
@@ -13,6 +17,31 @@ void Write(const T& value, std::ostream& out);
 template <typename T>
 T Read(std::istream& in);
 
+// Reads a trivially copyable value from memory and advances the cursor past it.
+template <typename T>
+T ReadFromBuffer(const char*& cursor) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  T value;
+  std::memcpy(&value, cursor, sizeof(T));
+  cursor += sizeof(T);
+  return value;
+}
+
+// Reads a value written by Write<T> from memory and advances the cursor past it. Throws instead of reading past `end`.
+template <typename T>
+T ReadFromBuffer(const char*& cursor, const char* end) {
+  if constexpr (std::is_same_v<T, std::string>) {
+    const int64_t size = ReadFromBuffer<int64_t>(cursor, end);
+    ASSERT(size >= 0 && size <= end - cursor);
+    std::string value(cursor, size);
+    cursor += size;
+    return value;
+  } else {
+    ASSERT(sizeof(T) <= static_cast<size_t>(end - cursor));
+    return ReadFromBuffer<T>(cursor);
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 template <>
@@ -0,0 +1,291 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "src/util/assert.h"
+
+namespace ngn {
+
+// Contiguous storage for a column of strings: one byte buffer holding all values back to back plus an offsets
+// array with size() + 1 entries, where value i occupies bytes [offsets[i], offsets[i + 1]).
+//
+// Alternatively the array can be dictionary encoded: a shared dictionary of (usually distinct) values plus one int32
+// code per element. Reads work the same way in both modes; appending single values to a dictionary encoded array
+// first converts it to the contiguous layout. Kernels can check IsDictionaryEncoded() and work on the codes.
+//
+// Elements are exposed as std::string_view, so reading a value never allocates. Views are invalidated by any
+// modification of the array.
+class StringArray {
+ public:
+  class ConstIterator {
+   public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = std::string_view;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = std::string_view;
+
+    ConstIterator() = default;
+    ConstIterator(const StringArray* array, size_t index) : array_(array), index_(index) {}
+
+    std::string_view operator*() const { return (*array_)[index_]; }
+    std::string_view operator[](difference_type n) const { return (*array_)[index_ + n]; }
+
+    ConstIterator& operator++() {
+      ++index_;
+      return *this;
+    }
+    ConstIterator operator++(int) {
+      ConstIterator copy = *this;
+      ++index_;
+      return copy;
+    }
+    ConstIterator& operator--() {
+      --index_;
+      return *this;
+    }
+    ConstIterator operator--(int) {
+      ConstIterator copy = *this;
+      --index_;
+      return copy;
+    }
+    ConstIterator& operator+=(difference_type n) {
+      index_ += n;
+      return *this;
+    }
+    ConstIterator& operator-=(difference_type n) {
+      index_ -= n;
+      return *this;
+    }
+    ConstIterator operator+(difference_type n) const { return ConstIterator(array_, index_ + n); }
+    ConstIterator operator-(difference_type n) const { return ConstIterator(array_, index_ - n); }
+    difference_type operator-(const ConstIterator& other) const {
+      return static_cast<difference_type>(index_) - static_cast<difference_type>(other.index_);
+    }
+
+    bool operator==(const ConstIterator& other) const = default;
+    auto operator<=>(const ConstIterator& other) const { return index_ <=> other.index_; }
+
+    const StringArray* Array() const { return array_; }
+    size_t Index() const { return index_; }
+
+   private:
+    const StringArray* array_ = nullptr;
+    size_t index_ = 0;
+  };
+
+  using const_iterator = ConstIterator;
+  using iterator = ConstIterator;
+
+  StringArray() : offsets_{0} {}
+
+  explicit StringArray(size_t count, std::string_view value = {}) : StringArray() {
+    offsets_.reserve(count + 1);
+    bytes_.reserve(count * value.size());
+    for (size_t i = 0; i < count; ++i) {
+      emplace_back(value);
+    }
+  }
+
+  StringArray(std::initializer_list<std::string_view> values) : StringArray() {
+    reserve(values.size());
+    for (std::string_view value : values) {
+      emplace_back(value);
+    }
+  }
+
+  StringArray(const std::vector<std::string>& values) : StringArray() {
+    reserve(values.size());
+    for (const auto& value : values) {
+      emplace_back(value);
+    }
+  }
+
+  // Takes ownership of already laid out buffers. `offsets` must start with 0, be non-decreasing and end with
+  // bytes.size().
+  StringArray(std::vector<int64_t> offsets, std::vector<char> bytes)
+      : offsets_(std::move(offsets)), bytes_(std::move(bytes)) {
+    ASSERT(!offsets_.empty());
+    ASSERT(offsets_.front() == 0);
+    ASSERT(offsets_.back() == static_cast<int64_t>(bytes_.size()));
+  }
+
+  // Dictionary encoded array. `dictionary` must not be dictionary encoded itself and every code must index into it.
+  StringArray(std::shared_ptr<const StringArray> dictionary, std::vector<int32_t> codes)
+      : dictionary_(std::move(dictionary)), codes_(std::move(codes)) {
+    ASSERT(dictionary_ != nullptr);
+    ASSERT(!dictionary_->IsDictionaryEncoded());
+  }
+
+  size_t size() const { return IsDictionaryEncoded() ? codes_.size() : offsets_.size() - 1; }
+  bool empty() const { return size() == 0; }
+
+  void reserve(size_t count) {
+    if (IsDictionaryEncoded()) {
+      codes_.reserve(count);
+    } else {
+      offsets_.reserve(count + 1);
+    }
+  }
+  void reserve(size_t count, size_t bytes) {
+    if (!IsDictionaryEncoded()) {
+      offsets_.reserve(count + 1);
+      bytes_.reserve(bytes);
+    }
+  }
+
+  void clear() {
+    dictionary_.reset();
+    codes_.clear();
+    offsets_.assign(1, 0);
+    bytes_.clear();
+  }
+
+  std::string_view operator[](size_t index) const {
+    if (IsDictionaryEncoded()) {
+      return (*dictionary_)[codes_[index]];
+    }
+    return std::string_view(bytes_.data() + offsets_[index], offsets_[index + 1] - offsets_[index]);
+  }
+
+  std::string_view at(size_t index) const {
+    ASSERT(index < size());
+    return (*this)[index];
+  }
+
+  int64_t Length(size_t index) const {
+    if (IsDictionaryEncoded()) {
+      return dictionary_->Length(codes_[index]);
+    }
+    return offsets_[index + 1] - offsets_[index];
+  }
+
+  void emplace_back(std::string_view value) {
+    Materialize();
+    bytes_.insert(bytes_.end(), value.begin(), value.end());
+    offsets_.push_back(static_cast<int64_t>(bytes_.size()));
+  }
+
+  void push_back(std::string_view value) { emplace_back(value); }
+
+  // Only appending at the end is supported. A range taken from another StringArray is copied as one block.
+  void insert(const_iterator pos, const_iterator first, const_iterator last) {
+    ASSERT(pos == end());
+    if (first == last) {
+      return;
+    }
+    if (first.Array() != this) {
+      AppendRange(*first.Array(), first.Index(), last.Index());
+      return;
+    }
+    StringArray copy;
+    copy.AppendRange(*this, first.Index(), last.Index());
+    AppendRange(copy, 0, copy.size());
+  }
+
+  // Appends values [begin, end) of `other`. Codes are copied as is if both arrays share the dictionary (or this one is
+  // empty); otherwise the values are appended to the contiguous layout.
+  void AppendRange(const StringArray& other, size_t begin, size_t end) {
+    ASSERT(&other != this);
+    ASSERT(begin <= end && end <= other.size());
+    if (other.IsDictionaryEncoded()) {
+      if (empty() && !IsDictionaryEncoded()) {
+        dictionary_ = other.dictionary_;
+        offsets_.clear();
+      }
+      if (dictionary_ == other.dictionary_) {
+        codes_.insert(codes_.end(), other.codes_.begin() + begin, other.codes_.begin() + end);
+        return;
+      }
+      Materialize();
+      for (size_t i = begin; i < end; ++i) {
+        emplace_back(other[i]);
+      }
+      return;
+    }
+    Materialize();
+    const int64_t base = static_cast<int64_t>(bytes_.size()) - other.offsets_[begin];
+    bytes_.insert(bytes_.end(), other.bytes_.begin() + other.offsets_[begin],
+                  other.bytes_.begin() + other.offsets_[end]);
+    offsets_.reserve(offsets_.size() + (end - begin));
+    for (size_t i = begin + 1; i <= end; ++i) {
+      offsets_.push_back(other.offsets_[i] + base);
+    }
+  }
+
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, size()); }
+
+  // Contiguous layout; only valid if the array is not dictionary encoded.
+  const std::vector<int64_t>& Offsets() const {
+    ASSERT(!IsDictionaryEncoded());
+    return offsets_;
+  }
+  const std::vector<char>& Bytes() const {
+    ASSERT(!IsDictionaryEncoded());
+    return bytes_;
+  }
+
+  bool IsDictionaryEncoded() const { return dictionary_ != nullptr; }
+
+  // Bytes held by the array. A dictionary is shared, so it is not counted.
+  size_t MemoryUsage() const {
+    return offsets_.capacity() * sizeof(int64_t) + bytes_.capacity() + codes_.capacity() * sizeof(int32_t);
+  }
+
+  const std::shared_ptr<const StringArray>& Dictionary() const {
+    ASSERT(IsDictionaryEncoded());
+    return dictionary_;
+  }
+  const std::vector<int32_t>& Codes() const {
+    ASSERT(IsDictionaryEncoded());
+    return codes_;
+  }
+
+  // Converts a dictionary encoded array to the contiguous layout. The total size is computed first, so the byte
+  // buffer is allocated once and every value is a single copy.
+  void Materialize() {
+    if (!IsDictionaryEncoded()) {
+      return;
+    }
+    const auto& dictionary_offsets = dictionary_->offsets_;
+    std::vector<int64_t> offsets(codes_.size() + 1);
+    offsets[0] = 0;
+    for (size_t i = 0; i < codes_.size(); ++i) {
+      offsets[i + 1] = offsets[i] + (dictionary_offsets[codes_[i] + 1] - dictionary_offsets[codes_[i]]);
+    }
+    std::vector<char> bytes(offsets.back());
+    for (size_t i = 0; i < codes_.size(); ++i) {
+      std::memcpy(bytes.data() + offsets[i], dictionary_->bytes_.data() + dictionary_offsets[codes_[i]],
+                  offsets[i + 1] - offsets[i]);
+    }
+    dictionary_.reset();
+    codes_.clear();
+    offsets_ = std::move(offsets);
+    bytes_ = std::move(bytes);
+  }
+
+  bool operator==(const StringArray& other) const {
+    if (IsDictionaryEncoded() || other.IsDictionaryEncoded()) {
+      return size() == other.size() && std::equal(begin(), end(), other.begin());
+    }
+    return offsets_ == other.offsets_ && bytes_ == other.bytes_;
+  }
+
+ private:
+  std::vector<int64_t> offsets_;
+  std::vector<char> bytes_;
+
+  std::shared_ptr<const StringArray> dictionary_;
+  std::vector<int32_t> codes_;
+};
+
+}  // namespace ngn
@@ -5,6 +5,7 @@
 #include <variant>
 #include <vector>
 
+#include "src/core/string_array.h"
 #include "src/execution/int128.h"
 
 namespace ngn {
@@ -148,6 +149,16 @@ struct ArrayType : public std::vector<PhysicalType<type>> {
   ArrayType(std::vector<PhysicalType<type>> vals) : std::vector<PhysicalType<type>>(std::move(vals)) {}
 };
 
+// Strings are stored contiguously (offsets + bytes) rather than as one heap allocation per value.
+// Elements are accessed as std::string_view.
+template <>
+struct ArrayType<Type::kString> : public StringArray {
+  using StringArray::StringArray;
+
+  ArrayType() = default;
+  ArrayType(StringArray vals) : StringArray(std::move(vals)) {}
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 
 }  // namespace ngn
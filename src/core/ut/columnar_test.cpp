@@ -1,10 +1,14 @@
 #include "src/core/columnar.h"
 
 #include <cstdio>
+#include <cstring>
 #include <filesystem>
+#include <limits>
 #include <random>
+#include <sstream>
 
 #include "gtest/gtest.h"
+#include "src/core/bloom_filter.h"
 #include "src/core/column.h"
 #include "src/core/datetime.h"
 
@@ -193,4 +197,493 @@ TEST(ColumnarFile, DateTimestampMixed) {
   EXPECT_EQ(rg0[2][0].ToString(), "2013-07-15 10:30:45");
 }
 
+TEST(ColumnarFile, MemoryMapped) {
+  std::mt19937 rnd(2104);
+
+  std::filesystem::path path = std::filesystem::temp_directory_path() / std::to_string(rnd() % 10000);
+
+  Schema schema({Field{"a", Type::kInt16}, Field{"b", Type::kString}, Field{"c", Type::kInt128},
+                 Field{"d", Type::kTimestamp}});
+  FileWriter writer(path, schema);
+
+  Column rg0_a(ArrayType<Type::kInt16>{1, 2, 3});
+  Column rg0_b(ArrayType<Type::kString>{"x", "yy", "zzz"});
+  Column rg0_c(ArrayType<Type::kInt128>{Int128{1} << 100, -1, 0});
+  Column rg0_d(ArrayType<Type::kTimestamp>{Timestamp{1}, Timestamp{2}, Timestamp{3}});
+  writer.AppendRowGroup({rg0_a, rg0_b, rg0_c, rg0_d});
+
+  Column rg1_a(ArrayType<Type::kInt16>{4});
+  Column rg1_b(ArrayType<Type::kString>{""});
+  Column rg1_c(ArrayType<Type::kInt128>{42});
+  Column rg1_d(ArrayType<Type::kTimestamp>{Timestamp{-5}});
+  writer.AppendRowGroup({rg1_a, rg1_b, rg1_c, rg1_d});
+
+  std::move(writer).Finalize();
+
+  FileReader::Options options;
+  options.use_mmap = true;
+  FileReader reader(path, options);
+  ASSERT_TRUE(reader.IsMemoryMapped());
+  ASSERT_EQ(reader.RowGroupCount(), 2);
+
+  EXPECT_EQ(reader.ReadRowGroup(0), (std::vector<Column>{rg0_a, rg0_b, rg0_c, rg0_d}));
+  EXPECT_EQ(reader.ReadRowGroup(1), (std::vector<Column>{rg1_a, rg1_b, rg1_c, rg1_d}));
+
+  FileReader stream_reader(path);
+  ASSERT_FALSE(stream_reader.IsMemoryMapped());
+  EXPECT_EQ(stream_reader.ReadRowGroup(1), reader.ReadRowGroup(1));
+}
+
+TEST(ColumnarFile, StringOffsets) {
+  std::mt19937 rnd(2105);
+
+  std::filesystem::path path = std::filesystem::temp_directory_path() / std::to_string(rnd() % 10000);
+
+  Schema schema({Field{"a", Type::kInt64}, Field{"b", Type::kString}});
+  FileWriter writer(path, schema);
+
+  Column col_a(ArrayType<Type::kInt64>{1, 2, 3, 4});
+  Column col_b(ArrayType<Type::kString>{"hello", "", "world", std::string(1000, 'x')});
+  writer.AppendRowGroup({col_a, col_b});
+  std::move(writer).Finalize();
+
+  FileReader reader(path);
+  EXPECT_EQ(reader.GetColumnEncoding(0, 0), Encoding::kPlain);
+  EXPECT_EQ(reader.GetColumnEncoding(0, 1), Encoding::kStringOffsets);
+
+  Column read_b = reader.ReadRowGroupColumn(0, 1);
+  EXPECT_EQ(read_b, col_b);
+
+  const auto& strings = std::get<ArrayType<Type::kString>>(read_b.Values());
+  EXPECT_EQ(strings.Offsets(), (std::vector<int64_t>{0, 5, 5, 10, 1010}));
+  EXPECT_EQ(strings.Bytes().size(), 1010);
+  EXPECT_EQ(strings[2], "world");
+  EXPECT_EQ(strings.Length(3), 1000);
+}
+
+TEST(ColumnarFile, DictionaryEncoding) {
+  std::mt19937 rnd(2106);
+
+  std::filesystem::path path = std::filesystem::temp_directory_path() / std::to_string(rnd() % 10000);
+
+  Schema schema({Field{"low", Type::kString}, Field{"high", Type::kString}});
+
+  ArrayType<Type::kString> low;
+  ArrayType<Type::kString> high;
+  for (int i = 0; i < 1000; ++i) {
+    low.emplace_back(i % 7 == 0 ? "" : "phrase " + std::to_string(i % 5));
+    high.emplace_back(std::to_string(i));
+  }
+  Column col_low(low);
+  Column col_high(high);
+
+  {
+    FileWriter writer(path, schema);
+    writer.AppendRowGroup({col_low, col_high});
+    std::move(writer).Finalize();
+
+    FileReader reader(path);
+    EXPECT_EQ(reader.GetColumnEncoding(0, 0), Encoding::kDictionary);
+    EXPECT_EQ(reader.GetColumnEncoding(0, 1), Encoding::kStringOffsets);
+    EXPECT_EQ(reader.ReadRowGroupColumn(0, 0), col_low);
+    EXPECT_EQ(reader.ReadRowGroupColumn(0, 1), col_high);
+  }
+  {
+    FileWriter::Options options;
+    options.encoding.dictionary_max_distinct = 5;
+    FileWriter writer(path, schema, options);
+    writer.AppendRowGroup({col_low, col_high});
+    std::move(writer).Finalize();
+
+    FileReader reader(path);
+    EXPECT_EQ(reader.GetColumnEncoding(0, 0), Encoding::kStringOffsets);
+    EXPECT_EQ(reader.ReadRowGroupColumn(0, 0), col_low);
+  }
+}
+
+TEST(Encoding, StringRoundTrip) {
+  ArrayType<Type::kString> values{"a", "", "a", "bcd", "", "a"};
+  for (Encoding encoding : {Encoding::kPlain, Encoding::kStringOffsets, Encoding::kDictionary}) {
+    std::stringstream out;
+    EncodeColumn(values, encoding, out);
+    EXPECT_EQ(DecodeColumn<Type::kString>(out.str(), encoding), values);
+  }
+
+  std::stringstream out;
+  EncodeColumn(ArrayType<Type::kInt32>{1, 2}, Encoding::kPlain, out);
+  ASSERT_ANY_THROW(DecodeColumn<Type::kInt32>(out.str(), Encoding::kDictionary));
+}
+
+TEST(Encoding, CorruptStringOffsets) {
+  // Replaces the `index`-th int64_t of a chunk.
+  const auto corrupt = [](std::string chunk, size_t index, int64_t value) {
+    std::memcpy(chunk.data() + index * sizeof(int64_t), &value, sizeof(int64_t));
+    return chunk;
+  };
+  const std::vector<RowRange> ranges{RowRange{1, 3}};
+
+  std::stringstream offsets;
+  EncodeColumn(ArrayType<Type::kString>{"ab", "cd", "ef"}, Encoding::kStringOffsets, offsets);
+  // The chunk is the size, then the offsets 0, 2, 4, 6, then the bytes.
+  for (const std::string& chunk : {corrupt(offsets.str(), 3, 1), corrupt(offsets.str(), 3, 100),
+                                   corrupt(offsets.str(), 4, 100), corrupt(offsets.str(), 4, 3)}) {
+    ASSERT_ANY_THROW(DecodeColumn<Type::kString>(chunk, Encoding::kStringOffsets));
+    ASSERT_ANY_THROW(DecodeColumnRanges<Type::kString>(chunk, Encoding::kStringOffsets, ranges));
+  }
+
+  std::stringstream dictionary;
+  EncodeColumn(ArrayType<Type::kString>{"ab", "cd", "ab"}, Encoding::kDictionary, dictionary);
+  // The chunk is the size, then the dictionary size and the dictionary offsets 0, 2, 4.
+  for (const std::string& chunk : {corrupt(dictionary.str(), 3, 5), corrupt(dictionary.str(), 4, 100)}) {
+    ASSERT_ANY_THROW(DecodeColumn<Type::kString>(chunk, Encoding::kDictionary));
+  }
+}
+
+TEST(ColumnarFile, IntegerEncodings) {
+  std::mt19937 rnd(2107);
+
+  std::filesystem::path path = std::filesystem::temp_directory_path() / std::to_string(rnd() % 10000);
+
+  Schema schema({Field{"constant", Type::kInt16}, Field{"small", Type::kInt32}, Field{"wide", Type::kInt64},
+                 Field{"date", Type::kDate}, Field{"runs", Type::kTimestamp}});
+
+  constexpr int kRows = 1000;
+  ArrayType<Type::kInt16> constant(kRows, 3);
+  ArrayType<Type::kInt32> small;
+  ArrayType<Type::kInt64> wide;
+  ArrayType<Type::kDate> date;
+  ArrayType<Type::kTimestamp> runs;
+  for (int i = 0; i < kRows; ++i) {
+    small.push_back(-1000 + static_cast<int32_t>(rnd() % 100));
+    wide.push_back(static_cast<int64_t>(rnd()) << 32 | rnd());
+    date.push_back(Date{19000 + static_cast<int64_t>(rnd() % 30)});
+    runs.push_back(Timestamp{i / 100 * 1'000'000'000LL});
+  }
+  std::vector<Column> columns{Column(constant), Column(small), Column(wide), Column(date), Column(runs)};
+
+  FileWriter writer(path, schema);
+  writer.AppendRowGroup(columns);
+  std::move(writer).Finalize();
+
+  FileReader reader(path);
+  EXPECT_EQ(reader.GetColumnEncoding(0, 0), Encoding::kRunLength);
+  EXPECT_EQ(reader.GetColumnEncoding(0, 1), Encoding::kBitPacked);
+  EXPECT_EQ(reader.GetColumnEncoding(0, 2), Encoding::kPlain);
+  EXPECT_EQ(reader.GetColumnEncoding(0, 3), Encoding::kBitPacked);
+  EXPECT_EQ(reader.GetColumnEncoding(0, 4), Encoding::kRunLength);
+  EXPECT_EQ(reader.ReadRowGroup(0), columns);
+}
+
+TEST(Encoding, IntegerRoundTrip) {
+  std::mt19937_64 rnd(2108);
+  for (int bit_width = 0; bit_width <= 64; ++bit_width) {
+    for (int64_t size : {1, 255, 256, 257, 1000}) {
+      ArrayType<Type::kInt64> values;
+      for (int64_t i = 0; i < size; ++i) {
+        const uint64_t delta = bit_width == 0 ? 0 : rnd() >> (64 - bit_width);
+        values.push_back(static_cast<int64_t>(static_cast<uint64_t>(-12345) + delta));
+      }
+      for (Encoding encoding : {Encoding::kRunLength, Encoding::kBitPacked}) {
+        std::stringstream out;
+        EncodeColumn(values, encoding, out);
+        EXPECT_EQ(DecodeColumn<Type::kInt64>(out.str(), encoding), values) << bit_width << " " << size;
+      }
+    }
+  }
+
+  ArrayType<Type::kInt16> narrow{-32768, 32767, 0, -1};
+  std::stringstream out;
+  EncodeColumn(narrow, Encoding::kBitPacked, out);
+  EXPECT_EQ(DecodeColumn<Type::kInt16>(out.str(), Encoding::kBitPacked), narrow);
+}
+
+TEST(ColumnarFile, DeltaEncoding) {
+  std::mt19937 rnd(2109);
+
+  std::filesystem::path path = std::filesystem::temp_directory_path() / std::to_string(rnd() % 10000);
+
+  Schema schema({Field{"event_time", Type::kTimestamp}, Field{"event_date", Type::kDate}});
+
+  ArrayType<Type::kTimestamp> event_time;
+  ArrayType<Type::kDate> event_date;
+  int64_t time = 1'373'000'000'000'000;
+  for (int i = 0; i < 1000; ++i) {
+    time += static_cast<int64_t>(rnd() % 3'000'000) - 500'000;
+    event_time.push_back(Timestamp{time});
+    event_date.push_back(Date{15'887 + i * 3});
+  }
+  std::vector<Column> columns{Column(event_time), Column(event_date)};
+
+  FileWriter writer(path, schema);
+  writer.AppendRowGroup(columns);
+  std::move(writer).Finalize();
+
+  FileReader reader(path);
+  EXPECT_EQ(reader.GetColumnEncoding(0, 0), Encoding::kDeltaBitPacked);
+  EXPECT_EQ(reader.GetColumnEncoding(0, 1), Encoding::kDeltaBitPacked);
+  EXPECT_EQ(reader.ReadRowGroup(0), columns);
+}
+
+TEST(Encoding, DeltaRoundTrip) {
+  std::mt19937_64 rnd(2110);
+  for (int64_t size : {1, 2, 5, 256, 257, 1000}) {
+    ArrayType<Type::kTimestamp> values;
+    for (int64_t i = 0; i < size; ++i) {
+      values.push_back(Timestamp{static_cast<int64_t>(rnd())});
+    }
+    values.back() = Timestamp{std::numeric_limits<int64_t>::min()};
+
+    std::stringstream out;
+    EncodeColumn(values, Encoding::kDeltaBitPacked, out);
+    EXPECT_EQ(DecodeColumn<Type::kTimestamp>(out.str(), Encoding::kDeltaBitPacked), values) << size;
+  }
+}
+
+TEST(ColumnarFile, PageIndex) {
+  std::mt19937 rnd(2111);
+
+  std::filesystem::path path = std::filesystem::temp_directory_path() / std::to_string(rnd() % 10000);
+
+  Schema schema({Field{"id", Type::kInt64}, Field{"name", Type::kString}});
+
+  constexpr int kRows = 1000;
+  ArrayType<Type::kInt64> id;
+  ArrayType<Type::kString> name;
+  for (int i = 0; i < kRows; ++i) {
+    id.push_back(i);
+    name.emplace_back(std::string(1 + i % 7, 'n'));
+  }
+  std::vector<Column> columns{Column(id), Column(name)};
+
+  FileWriter::Options options;
+  options.page_index_rows = 300;
+  FileWriter writer(path, schema, options);
+  writer.AppendRowGroup(columns);
+  writer.AppendRowGroup(columns);
+  std::move(writer).Finalize();
+
+  FileReader reader(path);
+  ASSERT_TRUE(reader.HasPageIndex(1));
+  PageZoneMap pages = reader.ReadPageZoneMap(1, 0);
+  EXPECT_EQ(pages.page_rows, 300);
+  ASSERT_EQ(pages.pages.size(), 4);
+  EXPECT_EQ(pages.pages[1].min_value, Value(int64_t{300}));
+  EXPECT_EQ(pages.pages[3].max_value, Value(int64_t{999}));
+  EXPECT_TRUE(pages.pages[0].CanSkipForRange(Value(int64_t{600}), Value(int64_t{700})));
+  EXPECT_FALSE(reader.ReadPageZoneMap(0, 1).pages[0].has_stats);
+
+  // A mapped reader decodes the index from the mapping; a truncated index throws.
+  FileReader::Options mapped;
+  mapped.use_mmap = true;
+  EXPECT_EQ(FileReader(path, mapped).ReadPageZoneMap(1, 0).pages[3].max_value, Value(int64_t{999}));
+  const std::string serialized = pages.Serialize();
+  EXPECT_ANY_THROW(PageZoneMap::Deserialize(std::string_view(serialized).substr(0, serialized.size() - 1)));
+
+  // Row groups are still read in full, the page indexes are not part of the last column chunk.
+  EXPECT_EQ(reader.ReadRowGroup(1), columns);
+
+  std::vector<RowRange> ranges{{10, 20}, {600, 1000}};
+  ArrayType<Type::kString> expected_names;
+  for (const auto& range : ranges) {
+    expected_names.AppendRange(name, range.begin, range.end);
+  }
+  EXPECT_EQ(reader.ReadRowGroupColumnRanges(1, 1, ranges), Column(expected_names));
+}
+
+TEST(BloomFilter, Lookup) {
+  std::mt19937_64 rnd(2113);
+
+  constexpr int kValues = 10000;
+  ArrayType<Type::kInt64> values;
+  for (int i = 0; i < kValues; ++i) {
+    values.push_back(static_cast<int64_t>(rnd()));
+  }
+  BloomFilter filter = ComputeBloomFilter(Column(values), 0.01);
+
+  for (int64_t value : values) {
+    EXPECT_TRUE(filter.MayContain(BloomHash(value)));
+  }
+  int false_positives = 0;
+  for (int i = 0; i < kValues; ++i) {
+    false_positives += filter.MayContain(BloomHash(static_cast<int64_t>(rnd())));
+  }
+  EXPECT_LT(false_positives, kValues / 50);
+
+  BloomFilter restored = BloomFilter::Deserialize(filter.Serialize());
+  EXPECT_EQ(restored.BlockCount(), filter.BlockCount());
+  EXPECT_TRUE(restored.MayContain(BloomHash(values[0])));
+  EXPECT_EQ(BloomHash(Value(values[0])), BloomHash(values[0]));
+}
+
+TEST(ColumnarFile, BloomFilter) {
+  std::mt19937 rnd(2114);
+
+  std::filesystem::path path = std::filesystem::temp_directory_path() / std::to_string(rnd() % 10000);
+
+  Schema schema({Field{"id", Type::kInt64}, Field{"name", Type::kString}});
+
+  FileWriter::Options options;
+  options.bloom_filter_columns = {"id", "name"};
+  FileWriter writer(path, schema, options);
+  std::vector<Column> first{Column(ArrayType<Type::kInt64>{1, 1000000}), Column(ArrayType<Type::kString>{"a", "b"})};
+  std::vector<Column> second{Column(ArrayType<Type::kInt64>{7, 42}), Column(ArrayType<Type::kString>{"c", "d"})};
+  writer.AppendRowGroup(first);
+  writer.AppendRowGroup(second);
+  std::move(writer).Finalize();
+
+  FileReader reader(path);
+  ASSERT_TRUE(reader.HasBloomFilter(0, 0));
+  ASSERT_TRUE(reader.HasBloomFilter(1, 1));
+
+  EXPECT_TRUE(reader.BloomFilterMayContain(0, 0, Value(int64_t{1000000})));
+  EXPECT_TRUE(reader.BloomFilterMayContain(1, 1, Value(std::string("d"))));
+  // Values of another type than the column are never excluded.
+  EXPECT_TRUE(reader.BloomFilterMayContain(0, 0, Value(int32_t{42})));
+  EXPECT_TRUE(reader.BloomFilterMayContain(0, 1, Value(int64_t{42})));
+
+  // 42 is inside the min/max of the first row group, only the Bloom filter excludes it.
+  EXPECT_FALSE(reader.CanSkipRowGroupForRange(0, 0, Value(int64_t{42}), Value(int64_t{42})));
+  EXPECT_TRUE(reader.CanSkipRowGroupForEqual(0, 0, Value(int64_t{42})));
+  EXPECT_FALSE(reader.CanSkipRowGroupForEqual(1, 0, Value(int64_t{42})));
+
+  EXPECT_EQ(reader.ReadRowGroup(1), second);
+}
+
+TEST(ColumnarFile, NgramFilter) {
+  std::mt19937 rnd(2115);
+
+  std::filesystem::path path = std::filesystem::temp_directory_path() / std::to_string(rnd() % 10000);
+
+  Schema schema({Field{"url", Type::kString}});
+
+  FileWriter::Options options;
+  options.ngram_filter_columns = {"url"};
+  FileWriter writer(path, schema, options);
+  writer.AppendRowGroup({Column(ArrayType<Type::kString>{"https://google.com/search", "http://ya.ru"})});
+  writer.AppendRowGroup({Column(ArrayType<Type::kString>{"http://example.com", "", "ab"})});
+  std::move(writer).Finalize();
+
+  FileReader reader(path);
+  ASSERT_TRUE(reader.HasNgramFilter(0, 0));
+  ASSERT_TRUE(reader.HasNgramFilter(1, 0));
+
+  EXPECT_TRUE(reader.NgramFilterMayContain(0, 0, "google"));
+  EXPECT_TRUE(reader.NgramFilterMayContain(0, 0, "ya.ru"));
+  EXPECT_FALSE(reader.CanSkipRowGroupForContains(0, 0, "/search"));
+  EXPECT_TRUE(reader.CanSkipRowGroupForContains(1, 0, "google"));
+  // Too short to be checked.
+  EXPECT_FALSE(reader.CanSkipRowGroupForContains(1, 0, "go"));
+  EXPECT_FALSE(reader.CanSkipRowGroupForContains(1, 0, ""));
+
+  EXPECT_EQ(reader.ReadRowGroup(1)[0], Column(ArrayType<Type::kString>{"http://example.com", "", "ab"}));
+}
+
+TEST(ColumnarFile, NdvEstimates) {
+  std::mt19937 rnd(2116);
+
+  std::filesystem::path path = std::filesystem::temp_directory_path() / std::to_string(rnd() % 10000);
+
+  Schema schema({Field{"id", Type::kInt64}, Field{"flag", Type::kInt16}, Field{"name", Type::kString}});
+  FileWriter writer(path, schema);
+  for (int64_t row_group = 0; row_group < 10; ++row_group) {
+    std::vector<int64_t> ids;
+    std::vector<int16_t> flags;
+    std::vector<std::string> names;
+    for (int64_t i = 0; i < 10000; ++i) {
+      ids.push_back(row_group * 10000 + i);
+      flags.push_back(static_cast<int16_t>(i % 3));
+      names.push_back("name" + std::to_string(i % 500));
+    }
+    writer.AppendRowGroup({Column(std::move(ids)), Column(std::move(flags)), Column(ArrayType<Type::kString>(names))});
+  }
+  std::move(writer).Finalize();
+
+  FileReader reader(path);
+  EXPECT_EQ(reader.RowCount(), 100000);
+  ASSERT_TRUE(reader.GetNdvEstimate(0).has_value());
+  EXPECT_NEAR(static_cast<double>(*reader.GetNdvEstimate(0)), 100000.0, 5000.0);
+  EXPECT_EQ(reader.GetNdvEstimate(1), 3);
+  EXPECT_NEAR(static_cast<double>(*reader.GetNdvEstimate(2)), 500.0, 10.0);
+
+  FileWriter::Options options;
+  options.ndv_estimates = false;
+  FileWriter without(path, schema, options);
+  without.AppendRowGroup({Column(ArrayType<Type::kInt64>{1}), Column(ArrayType<Type::kInt16>{1}),
+                          Column(ArrayType<Type::kString>{"a"})});
+  std::move(without).Finalize();
+  EXPECT_FALSE(FileReader(path).GetNdvEstimate(0).has_value());
+}
+
+TEST(Encoding, RangesRoundTrip) {
+  std::mt19937_64 rnd(2112);
+
+  constexpr int64_t kRows = 1000;
+  ArrayType<Type::kInt64> runs;
+  ArrayType<Type::kInt64> packed;
+  ArrayType<Type::kTimestamp> deltas;
+  ArrayType<Type::kString> strings;
+  for (int64_t i = 0; i < kRows; ++i) {
+    runs.push_back(i / 37);
+    packed.push_back(static_cast<int64_t>(rnd() % 5000));
+    deltas.push_back(Timestamp{i * 1000 + static_cast<int64_t>(rnd() % 100)});
+    strings.emplace_back(std::to_string(rnd() % 10));
+  }
+
+  const std::vector<RowRange> ranges{{0, 1}, {255, 513}, {700, 700}, {999, 1000}};
+  auto expected = [&]<typename Array>(const Array& values) {
+    Array result;
+    for (const auto& range : ranges) {
+      result.insert(result.end(), values.begin() + range.begin, values.begin() + range.end);
+    }
+    return result;
+  };
+  auto check = [&]<Type type>(const ArrayType<type>& values, Encoding encoding) {
+    std::stringstream out;
+    EncodeColumn(values, encoding, out);
+    EXPECT_EQ(DecodeColumnRanges<type>(out.str(), encoding, ranges), expected(values))
+        << static_cast<int>(encoding);
+  };
+
+  check(runs, Encoding::kRunLength);
+  check(packed, Encoding::kBitPacked);
+  check(packed, Encoding::kPlain);
+  check(deltas, Encoding::kDeltaBitPacked);
+  check(strings, Encoding::kStringOffsets);
+  check(strings, Encoding::kDictionary);
+}
+
+TEST(Encoding, EmptyRangeAtEnd) {
+  const ArrayType<Type::kInt64> values{7, 7, 7, 8, 8, 9};
+  const std::vector<RowRange> ranges{{1, 4}, {6, 6}};
+  for (Encoding encoding : {Encoding::kRunLength, Encoding::kBitPacked, Encoding::kPlain}) {
+    std::stringstream out;
+    EncodeColumn(values, encoding, out);
+    EXPECT_EQ(DecodeColumnRanges<Type::kInt64>(out.str(), encoding, ranges), (ArrayType<Type::kInt64>{7, 7, 8}))
+        << static_cast<int>(encoding);
+  }
+
+  std::stringstream empty;
+  EncodeColumn(ArrayType<Type::kInt64>{}, Encoding::kRunLength, empty);
+  EXPECT_TRUE(DecodeColumnRanges<Type::kInt64>(empty.str(), Encoding::kRunLength, {RowRange{0, 0}}).empty());
+}
+
+TEST(StringArray, Append) {
+  ArrayType<Type::kString> values{"a", "bc"};
+  values.emplace_back("def");
+  ASSERT_EQ(values.size(), 3);
+  EXPECT_EQ(values[1], "bc");
+
+  ArrayType<Type::kString> other{"x", "yz"};
+  values.insert(values.end(), other.begin(), other.end());
+  values.insert(values.end(), values.begin(), values.begin() + 2);
+  EXPECT_EQ(values, (ArrayType<Type::kString>{"a", "bc", "def", "x", "yz", "a", "bc"}));
+
+  std::vector<std::string> copied(values.begin(), values.end());
+  EXPECT_EQ(copied.back(), "bc");
+
+  values.clear();
+  EXPECT_TRUE(values.empty());
+  EXPECT_EQ(values.Bytes().size(), 0);
+}
+
 }  // namespace ngn
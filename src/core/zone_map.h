@@ -1,7 +1,9 @@
 #pragma once
 
+#include <algorithm>
 #include <optional>
 #include <sstream>
+#include <string_view>
 #include <variant>
 #include <vector>
 
@@ -72,6 +74,22 @@ struct ZoneMapEntry {
     }
     return entry;
   }
+
+  // Reads an entry written by Serialize() from memory, advancing `cursor`. Throws instead of reading past `end`.
+  static ZoneMapEntry Deserialize(const char*& cursor, const char* end) {
+    ZoneMapEntry entry;
+    entry.has_stats = ReadFromBuffer<Boolean>(cursor, end).value;
+    if (entry.has_stats) {
+      entry.type = static_cast<Type>(ReadFromBuffer<int16_t>(cursor, end));
+      Dispatch(
+          [&]<Type type>(Tag<type>) {
+            entry.min_value.emplace(ReadFromBuffer<PhysicalType<type>>(cursor, end));
+            entry.max_value.emplace(ReadFromBuffer<PhysicalType<type>>(cursor, end));
+          },
+          *entry.type);
+    }
+    return entry;
+  }
 };
 
 struct RowGroupZoneMap {
@@ -101,11 +119,51 @@ struct RowGroupZoneMap {
   }
 };
 
+// Min/max of fixed-size pages of one column chunk. Page i covers rows [i * page_rows, (i + 1) * page_rows) of the
+// row group.
+struct PageZoneMap {
+  int64_t page_rows = 0;
+  std::vector<ZoneMapEntry> pages;
+
+  std::string Serialize() const {
+    std::stringstream out;
+    Write(page_rows, out);
+    int64_t sz = pages.size();
+    Write(sz, out);
+    for (const auto& entry : pages) {
+      std::string serialized = entry.Serialize();
+      Write(serialized, out);
+    }
+    return out.str();
+  }
+
+  // Decodes the index in place, e.g. straight from a memory-mapped file.
+  static PageZoneMap Deserialize(std::string_view data) {
+    const char* cursor = data.data();
+    const char* const end = data.data() + data.size();
+    PageZoneMap zm;
+    zm.page_rows = ReadFromBuffer<int64_t>(cursor, end);
+    const int64_t sz = ReadFromBuffer<int64_t>(cursor, end);
+    // Every page takes at least its length prefix.
+    ASSERT(sz >= 0 && sz <= (end - cursor) / static_cast<int64_t>(sizeof(int64_t)));
+    zm.pages.reserve(sz);
+    for (int64_t i = 0; i < sz; ++i) {
+      const int64_t size = ReadFromBuffer<int64_t>(cursor, end);
+      ASSERT(size >= 0 && size <= end - cursor);
+      const char* const page_end = cursor + size;
+      zm.pages.push_back(ZoneMapEntry::Deserialize(cursor, page_end));
+      cursor = page_end;
+    }
+    return zm;
+  }
+};
+
+// Stats of values [begin, end).
 template <Type type>
-ZoneMapEntry ComputeZoneMapEntry(const ArrayType<type>& values) {
+ZoneMapEntry ComputeZoneMapEntry(const ArrayType<type>& values, size_t begin, size_t end) {
   ZoneMapEntry entry;
 
-  if (values.empty()) {
+  if (begin >= end) {
     entry.has_stats = false;
     return entry;
   }
@@ -113,28 +171,51 @@ ZoneMapEntry ComputeZoneMapEntry(const ArrayType<type>& values) {
   entry.has_stats = true;
   entry.type = type;
 
-  std::optional<PhysicalType<type>> min_value;
-  std::optional<PhysicalType<type>> max_value;
-
-  for (const auto& v : values) {
-    ASSERT(min_value.has_value() == max_value.has_value());
-
-    if (!min_value.has_value()) {
+  // For strings the elements are views into the array, so the scan itself does not copy.
+  auto min_value = values[begin];
+  auto max_value = values[begin];
+  for (size_t i = begin + 1; i < end; ++i) {
+    const auto v = values[i];
+    if (v < min_value) {
       min_value = v;
+    }
+    if (max_value < v) {
       max_value = v;
-    } else {
-      min_value = std::min(*min_value, v);
-      max_value = std::max(*max_value, v);
     }
   }
 
-  ASSERT(min_value.has_value() && max_value.has_value());
-  entry.min_value = Value(std::move(*min_value));
-  entry.max_value = Value(std::move(*max_value));
+  entry.min_value = Value(PhysicalType<type>(min_value));
+  entry.max_value = Value(PhysicalType<type>(max_value));
 
   return entry;
 }
 
+template <Type type>
+ZoneMapEntry ComputeZoneMapEntry(const ArrayType<type>& values) {
+  return ComputeZoneMapEntry(values, 0, values.size());
+}
+
+// String pages get no stats: their min/max would make the index as large as the data while rarely allowing to skip
+// anything.
+inline PageZoneMap ComputePageZoneMap(const Column& column, int64_t page_rows) {
+  ASSERT(page_rows > 0);
+  PageZoneMap zm;
+  zm.page_rows = page_rows;
+  std::visit(
+      [&]<Type type>(const ArrayType<type>& values) {
+        const int64_t size = static_cast<int64_t>(values.size());
+        for (int64_t begin = 0; begin < size; begin += page_rows) {
+          if constexpr (type == Type::kString) {
+            zm.pages.emplace_back();
+          } else {
+            zm.pages.push_back(ComputeZoneMapEntry(values, begin, std::min(size, begin + page_rows)));
+          }
+        }
+      },
+      column.Values());
+  return zm;
+}
+
 inline RowGroupZoneMap ComputeRowGroupZoneMap(const std::vector<Column>& columns) {
   RowGroupZoneMap zm;
   zm.columns.reserve(columns.size());
@@ -1,9 +1,13 @@
 #include "src/execution/aggregation_executor.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <limits>
+#include <memory>
 #include <optional>
-#include <unordered_map>
+#include <string>
+#include <string_view>
 #include <unordered_set>
 #include <vector>
 
@@ -13,6 +17,8 @@
 #include "src/execution/expression.h"
 #include "src/execution/int128.h"
 #include "src/execution/stream.h"
+#include "src/execution/string_key_table.h"
+#include "src/execution/thread_pool.h"
 #include "src/util/assert.h"
 #include "src/util/macro.h"
 
@@ -44,181 +50,425 @@ struct ValueHash {
   }
 };
 
-struct VectorValueHash {
-  std::size_t operator()(const std::vector<ngn::Value>& value) const {
-    std::size_t result = 0;
-    for (const auto& elem : value) {
-      result = (result << 17) + ValueHash{}(elem);
-    }
-    return result;
-  }
-};
+constexpr int kPartitionBits = 6;
+constexpr int kPartitions = 1 << kPartitionBits;
 
-class IState {
+// Typed state of one aggregate for all groups, stored contiguously. A group is addressed by its partition and its
+// dense id within the partition.
+class IAccumulator {
  public:
-  virtual ~IState() = default;
+  virtual ~IAccumulator() = default;
+
+  // Grows the state of `partition` to `groups` groups.
+  virtual void Resize(int partition, size_t groups) = 0;
+
+  // Adds row i of `values` to group groups[i] of partition partitions[i]. `values` is null for COUNT.
+  virtual void Update(const Column* values, const std::vector<uint8_t>& partitions,
+                      const std::vector<uint32_t>& groups) = 0;
+
+  // Adds group g of `partition` of `other` to group mapping[g] of the same partition.
+  virtual void Merge(int partition, IAccumulator& other, const std::vector<uint32_t>& mapping) = 0;
 
-  virtual void Update(const Value& value) = 0;
-  virtual Value Finalize() = 0;
+  // Appends the result of every group of `partition` to `output`.
+  virtual void Finalize(int partition, Column& output) = 0;
+
+  // Approximate number of bytes held by the state of all groups.
+  virtual size_t MemoryUsage() const = 0;
 };
 
-class CountState : public IState {
+template <typename T>
+class AccumulatorBase : public IAccumulator {
  public:
-  CountState() : count_(0) {}
+  explicit AccumulatorBase(T initial = T{}) : initial_(std::move(initial)), values_(kPartitions) {}
 
-  void Update(const Value&) override { ++count_; }
+  void Resize(int partition, size_t groups) override { values_[partition].resize(groups, initial_); }
 
-  Value Finalize() override { return Value(count_); }
+  size_t MemoryUsage() const override {
+    size_t bytes = 0;
+    for (const auto& values : values_) {
+      bytes += values.capacity() * sizeof(T);
+    }
+    return bytes;
+  }
 
- private:
-  int64_t count_;
+ protected:
+  T initial_;
+  std::vector<std::vector<T>> values_;
 };
 
-std::shared_ptr<IState> MakeCountState() { return std::make_shared<CountState>(); }
+class CountAccumulator : public AccumulatorBase<int64_t> {
+ public:
+  void Update(const Column*, const std::vector<uint8_t>& partitions, const std::vector<uint32_t>& groups) override {
+    for (size_t i = 0; i < groups.size(); ++i) {
+      ++values_[partitions[i]][groups[i]];
+    }
+  }
+
+  void Merge(int partition, IAccumulator& other, const std::vector<uint32_t>& mapping) override {
+    const auto& other_values = static_cast<CountAccumulator&>(other).values_[partition];
+    for (size_t g = 0; g < mapping.size(); ++g) {
+      values_[partition][mapping[g]] += other_values[g];
+    }
+  }
 
-class SumState : public IState {
+  void Finalize(int partition, Column& output) override {
+    auto& column = std::get<ArrayType<Type::kInt64>>(output.Values());
+    column.insert(column.end(), values_[partition].begin(), values_[partition].end());
+  }
+};
+
+template <Type input_type>
+class SumAccumulator : public AccumulatorBase<Int128> {
  public:
-  explicit SumState(Type output_type) : sum_(static_cast<Int128>(0)), output_type_(output_type) {}
-
-  void Update(const Value& value) override {
-    if (auto ptr = std::get_if<int64_t>(&value.GetValue()); ptr != nullptr) {
-      sum_ += static_cast<Int128>(*ptr);
-    } else if (auto ptr = std::get_if<int16_t>(&value.GetValue()); ptr != nullptr) {
-      sum_ += static_cast<Int128>(*ptr);
-    } else if (auto ptr = std::get_if<int32_t>(&value.GetValue()); ptr != nullptr) {
-      sum_ += static_cast<Int128>(*ptr);
-    } else if (auto ptr = std::get_if<Int128>(&value.GetValue()); ptr != nullptr) {
-      sum_ += *ptr;
-    } else {
-      THROW_NOT_IMPLEMENTED;
+  explicit SumAccumulator(Type output_type) : AccumulatorBase(static_cast<Int128>(0)), output_type_(output_type) {}
+
+  void Update(const Column* values, const std::vector<uint8_t>& partitions,
+              const std::vector<uint32_t>& groups) override {
+    const auto& input = std::get<ArrayType<input_type>>(values->Values());
+    for (size_t i = 0; i < groups.size(); ++i) {
+      values_[partitions[i]][groups[i]] += static_cast<Int128>(input[i]);
+    }
+  }
+
+  void Merge(int partition, IAccumulator& other, const std::vector<uint32_t>& mapping) override {
+    const auto& other_values = static_cast<SumAccumulator&>(other).values_[partition];
+    for (size_t g = 0; g < mapping.size(); ++g) {
+      values_[partition][mapping[g]] += other_values[g];
     }
   }
 
-  Value Finalize() override {
+  void Finalize(int partition, Column& output) override {
     if (output_type_ == Type::kInt128) {
-      return Value(sum_);
+      auto& column = std::get<ArrayType<Type::kInt128>>(output.Values());
+      column.insert(column.end(), values_[partition].begin(), values_[partition].end());
+      return;
     }
-    if (sum_ > static_cast<Int128>(std::numeric_limits<int64_t>::max()) ||
-        sum_ < static_cast<Int128>(std::numeric_limits<int64_t>::min())) {
-      THROW_RUNTIME_ERROR("Overlflow");
+
+    auto& column = std::get<ArrayType<Type::kInt64>>(output.Values());
+    for (Int128 sum : values_[partition]) {
+      if (sum > static_cast<Int128>(std::numeric_limits<int64_t>::max()) ||
+          sum < static_cast<Int128>(std::numeric_limits<int64_t>::min())) {
+        THROW_RUNTIME_ERROR("Overlflow");
+      }
+      column.emplace_back(static_cast<int64_t>(sum));
     }
-    return Value(static_cast<int64_t>(sum_));
   }
 
  private:
-  Int128 sum_;
   Type output_type_;
 };
 
-std::shared_ptr<IState> MakeSumState(Type output_type) { return std::make_shared<SumState>(output_type); }
-
-template <bool is_min>
-class MinMaxState : public IState {
+template <Type type, bool is_min>
+class MinMaxAccumulator : public AccumulatorBase<PhysicalType<type>> {
  public:
-  explicit MinMaxState([[maybe_unused]] Type output_type) {}
-
-  void Update(const Value& value) override {
-    if (result_value_.has_value()) {
-      Dispatch(
-          [&]<Type type>(Tag<type>) {
-            const auto& current_value = std::get<PhysicalType<type>>(result_value_->GetValue());
-            const auto& candidate_value = std::get<PhysicalType<type>>(value.GetValue());
-
-            if constexpr (is_min) {
-              if (candidate_value < current_value) {
-                result_value_ = Value(candidate_value);
-              }
-            } else {
-              if (candidate_value > current_value) {
-                result_value_ = Value(candidate_value);
-              }
-            }
-          },
-          value.GetType());
-    } else {
-      result_value_ = value;
+  void Resize(int partition, size_t groups) override {
+    AccumulatorBase<PhysicalType<type>>::Resize(partition, groups);
+    has_value_[partition].resize(groups, 0);
+  }
+
+  size_t MemoryUsage() const override {
+    size_t bytes = AccumulatorBase<PhysicalType<type>>::MemoryUsage();
+    for (const auto& has_value : has_value_) {
+      bytes += has_value.capacity();
     }
+    return bytes;
   }
 
-  Value Finalize() override {
-    ASSERT(result_value_.has_value());
+  void Update(const Column* values, const std::vector<uint8_t>& partitions,
+              const std::vector<uint32_t>& groups) override {
+    const auto& input = std::get<ArrayType<type>>(values->Values());
+    for (size_t i = 0; i < groups.size(); ++i) {
+      Offer(partitions[i], groups[i], input[i]);
+    }
+  }
 
-    return *result_value_;
+  void Merge(int partition, IAccumulator& other, const std::vector<uint32_t>& mapping) override {
+    auto& other_accumulator = static_cast<MinMaxAccumulator&>(other);
+    for (size_t g = 0; g < mapping.size(); ++g) {
+      if (other_accumulator.has_value_[partition][g]) {
+        Offer(partition, mapping[g], other_accumulator.values_[partition][g]);
+      }
+    }
+  }
+
+  void Finalize(int partition, Column& output) override {
+    auto& column = std::get<ArrayType<type>>(output.Values());
+    for (size_t g = 0; g < this->values_[partition].size(); ++g) {
+      ASSERT(has_value_[partition][g]);
+      column.emplace_back(this->values_[partition][g]);
+    }
   }
 
  private:
-  std::optional<Value> result_value_;
+  template <typename V>
+  void Offer(int partition, uint32_t group, const V& candidate) {
+    auto& current = this->values_[partition][group];
+    if (!has_value_[partition][group]) {
+      has_value_[partition][group] = 1;
+      current = candidate;
+    } else if (is_min ? candidate < current : candidate > current) {
+      current = candidate;
+    }
+  }
+
+  std::vector<std::vector<uint8_t>> has_value_ = std::vector<std::vector<uint8_t>>(kPartitions);
 };
 
-std::shared_ptr<IState> MakeMinState(Type output_type) { return std::make_shared<MinMaxState<true>>(output_type); }
+class DistinctAccumulator : public AccumulatorBase<std::unordered_set<Value, ValueHash>> {
+ public:
+  void Update(const Column* values, const std::vector<uint8_t>& partitions,
+              const std::vector<uint32_t>& groups) override {
+    for (size_t i = 0; i < groups.size(); ++i) {
+      values_[partitions[i]][groups[i]].insert((*values)[i]);
+    }
+  }
+
+  void Merge(int partition, IAccumulator& other, const std::vector<uint32_t>& mapping) override {
+    auto& other_values = static_cast<DistinctAccumulator&>(other).values_[partition];
+    for (size_t g = 0; g < mapping.size(); ++g) {
+      values_[partition][mapping[g]].merge(other_values[g]);
+    }
+  }
+
+  void Finalize(int partition, Column& output) override {
+    auto& column = std::get<ArrayType<Type::kInt64>>(output.Values());
+    for (const auto& distinct : values_[partition]) {
+      column.emplace_back(static_cast<int64_t>(distinct.size()));
+    }
+  }
 
-std::shared_ptr<IState> MakeMaxState(Type output_type) { return std::make_shared<MinMaxState<false>>(output_type); }
+  size_t MemoryUsage() const override {
+    size_t bytes = AccumulatorBase::MemoryUsage();
+    for (const auto& sets : values_) {
+      for (const auto& distinct : sets) {
+        // One node per value and one pointer per bucket.
+        bytes += distinct.size() * (sizeof(Value) + 2 * sizeof(void*)) + distinct.bucket_count() * sizeof(void*);
+      }
+    }
+    return bytes;
+  }
+};
 
-class DistinctState : public IState {
+// Codes of string group keys. Key hashes use Hash(code), which unlike the code itself does not depend on the order
+// values were seen in.
+using GroupKeyDictionary = StringKeyTable;
+
+// Open addressing table mapping group keys to dense group ids. Keys are fixed-width byte strings; the key and the hash
+// of every group are kept in insertion order, so growing the table never rehashes keys.
+class GroupTable {
  public:
-  explicit DistinctState() {}
+  uint32_t FindOrInsert(uint64_t hash, const uint8_t* key, size_t key_size) {
+    if ((Size() + 1) * 10 > slots_.size() * 7) {
+      Grow();
+    }
 
-  void Update(const Value& value) override { result_.insert(value); }
+    const size_t mask = slots_.size() - 1;
+    for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+      const uint32_t group = slots_[slot];
+      if (group == kEmpty) {
+        const auto inserted = static_cast<uint32_t>(Size());
+        slots_[slot] = inserted;
+        hashes_.push_back(hash);
+        keys_.insert(keys_.end(), key, key + key_size);
+        return inserted;
+      }
+      if (hashes_[group] == hash && std::memcmp(keys_.data() + group * key_size, key, key_size) == 0) {
+        return group;
+      }
+    }
+  }
 
-  Value Finalize() override { return Value(static_cast<int64_t>(result_.size())); }
+  size_t Size() const { return hashes_.size(); }
+
+  uint64_t Hash(uint32_t group) const { return hashes_[group]; }
+
+  const uint8_t* Key(uint32_t group, size_t key_size) const { return keys_.data() + group * key_size; }
+
+  size_t MemoryUsage() const {
+    return slots_.capacity() * sizeof(uint32_t) + hashes_.capacity() * sizeof(uint64_t) + keys_.capacity();
+  }
 
  private:
-  std::unordered_set<Value, ValueHash> result_;
+  static constexpr uint32_t kEmpty = std::numeric_limits<uint32_t>::max();
+
+  void Grow() {
+    slots_.assign(std::max<size_t>(16, slots_.size() * 2), kEmpty);
+    const size_t mask = slots_.size() - 1;
+    for (uint32_t group = 0; group < Size(); ++group) {
+      size_t slot = hashes_[group] & mask;
+      while (slots_[slot] != kEmpty) {
+        slot = (slot + 1) & mask;
+      }
+      slots_[slot] = group;
+    }
+  }
+
+  std::vector<uint32_t> slots_;
+  std::vector<uint64_t> hashes_;
+  std::vector<uint8_t> keys_;
 };
 
-std::shared_ptr<IState> MakeDistinctState() { return std::make_shared<DistinctState>(); }
+template <typename T>
+uint64_t KeyHash(const T& value) {
+  if constexpr (std::is_same_v<T, Int128>) {
+    const auto u = static_cast<unsigned __int128>(value);
+    return static_cast<uint64_t>(u) ^ (static_cast<uint64_t>(u >> 64) * 0x9e3779b97f4a7c15ULL);
+  } else if constexpr (std::is_same_v<T, Date> || std::is_same_v<T, Timestamp> || std::is_same_v<T, Boolean>) {
+    return static_cast<uint64_t>(value.value);
+  } else {
+    return static_cast<uint64_t>(value);
+  }
+}
+
+inline uint64_t CombineHash(uint64_t hash, uint64_t part) { return (hash ^ part) * 0x9e3779b97f4a7c15ULL; }
 
+// Final mixing step of MurmurHash3, so that both the high bits (partition) and the low bits (slot) are usable.
+inline uint64_t FinalizeHash(uint64_t hash) {
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+// Hash aggregation that works on whole batches. The key columns are hashed one column at a time and packed into
+// fixed-width keys (string keys become codes in key_dictionaries_), every row is resolved to a dense group id in a
+// single probe pass, and each aggregate then updates its typed accumulator arrays.
+//
+// Groups are radix-partitioned by the hash of their key. Partitions of different aggregators over the same
+// aggregation hold disjoint sets of groups, so they can be merged in parallel.
 class Aggregator {
  public:
-  explicit Aggregator(Aggregation aggregation) : aggregation_(std::move(aggregation)) {
+  explicit Aggregator(Aggregation aggregation, const std::vector<std::optional<KeyDomain>>& key_domains = {})
+      : aggregation_(std::move(aggregation)),
+        partitions_(kPartitions),
+        key_dictionaries_(aggregation_.group_by_expressions.size()) {
     ASSERT(!aggregation_.aggregations.empty());
+
+    for (const auto& group_by : aggregation_.group_by_expressions) {
+      const Type type = GetExpressionType(group_by.expression);
+      key_types_.push_back(type);
+      key_offsets_.push_back(key_size_);
+      key_size_ += type == Type::kString ? sizeof(int32_t)
+                                         : Dispatch([]<Type t>(Tag<t>) { return sizeof(PhysicalType<t>); }, type);
+    }
+
+    for (const auto& aggr : aggregation_.aggregations) {
+      accumulators_.emplace_back(MakeAccumulator(aggr));
+    }
+
+    InitDirectIndex(key_domains);
   }
 
   void Consume(std::shared_ptr<Batch> batch) {
-    std::vector<Column> group_by_columns;
-    for (const auto& expr : aggregation_.group_by_expressions) {
-      group_by_columns.emplace_back(Evaluate(batch, expr.expression));
+    const size_t rows = batch->Rows();
+    if (rows == 0) {
+      return;
     }
 
-    std::vector<Column> value_columns;
-    for (const auto& aggr : aggregation_.aggregations) {
-      value_columns.emplace_back(Evaluate(batch, aggr.expression));
+    std::vector<Column> key_columns;
+    key_columns.reserve(key_types_.size());
+    for (size_t j = 0; j < key_types_.size(); ++j) {
+      key_columns.emplace_back(Evaluate(batch, aggregation_.group_by_expressions[j].expression));
+      ASSERT(key_columns.back().GetType() == key_types_[j]);
     }
 
-    for (int64_t i = 0; i < batch->Rows(); ++i) {
-      std::vector<Value> group_by;
-      for (size_t j = 0; j < group_by_columns.size(); ++j) {
-        group_by.emplace_back(group_by_columns[j][i]);
+    std::vector<uint8_t> partitions(rows);
+    std::vector<uint32_t> groups(rows);
+    std::vector<uint32_t> indices;
+    if (direct_.has_value() && ComputeDirectIndices(key_columns, indices)) {
+      std::vector<uint8_t> key(key_size_);
+      for (size_t i = 0; i < rows; ++i) {
+        const uint32_t index = indices[i];
+        if (direct_->groups[index] == DirectIndex::kNoGroup) {
+          // The first row of a group takes the hashed path, so the group is also found by hashed lookups and merges.
+          const uint64_t hash = PackRowKey(key_columns, i, key.data());
+          direct_->partitions[index] = static_cast<uint8_t>(hash >> (64 - kPartitionBits));
+          direct_->groups[index] = partitions_[direct_->partitions[index]].FindOrInsert(hash, key.data(), key_size_);
+        }
+        partitions[i] = direct_->partitions[index];
+        groups[i] = direct_->groups[index];
+      }
+    } else {
+      std::vector<uint64_t> hashes(rows, 0);
+      std::vector<uint8_t> keys(rows * key_size_);
+      for (size_t j = 0; j < key_types_.size(); ++j) {
+        AddKeyColumn(j, key_columns[j], hashes, keys);
       }
 
-      auto it = state_.find(group_by);
-      if (it == state_.end()) {
-        std::vector<std::shared_ptr<IState>> state;
-        state.reserve(value_columns.size());
-        for (size_t j = 0; j < value_columns.size(); ++j) {
-          if (aggregation_.aggregations[j].type == AggregationType::kCount) {
-            state.emplace_back(MakeCountState());
-          } else if (aggregation_.aggregations[j].type == AggregationType::kSum) {
-            state.emplace_back(MakeSumState(GetAggregationType(aggregation_.aggregations[j])));
-          } else if (aggregation_.aggregations[j].type == AggregationType::kDistinct) {
-            state.emplace_back(MakeDistinctState());
-          } else if (aggregation_.aggregations[j].type == AggregationType::kMin) {
-            state.emplace_back(MakeMinState(GetAggregationType(aggregation_.aggregations[j])));
-          } else if (aggregation_.aggregations[j].type == AggregationType::kMax) {
-            state.emplace_back(MakeMaxState(GetAggregationType(aggregation_.aggregations[j])));
-          } else {
-            THROW_NOT_IMPLEMENTED;
-          }
+      for (size_t i = 0; i < rows; ++i) {
+        const uint64_t hash = FinalizeHash(hashes[i]);
+        partitions[i] = static_cast<uint8_t>(hash >> (64 - kPartitionBits));
+        groups[i] = partitions_[partitions[i]].FindOrInsert(hash, keys.data() + i * key_size_, key_size_);
+      }
+    }
+
+    for (int partition = 0; partition < kPartitions; ++partition) {
+      ResizeAccumulators(partition);
+    }
+
+    for (size_t a = 0; a < accumulators_.size(); ++a) {
+      const auto& aggr = aggregation_.aggregations[a];
+      if (aggr.type == AggregationType::kCount) {
+        accumulators_[a]->Update(nullptr, partitions, groups);
+      } else {
+        Column values = Evaluate(batch, aggr.expression);
+        accumulators_[a]->Update(&values, partitions, groups);
+      }
+    }
+  }
+
+  // Moves the groups of `others` into this aggregator. Partitions are merged in parallel on the thread pool.
+  void Merge(const std::vector<Aggregator*>& others) {
+    // String keys are codes of each aggregator's own dictionaries. The dictionaries are shared by all partitions, so
+    // the codes are translated up front.
+    std::vector<std::vector<std::vector<int32_t>>> translations(others.size());
+    for (size_t i = 0; i < others.size(); ++i) {
+      // The groups of the others are moved out, so their direct indices no longer point anywhere.
+      others[i]->direct_.reset();
+
+      translations[i].resize(key_dictionaries_.size());
+      for (size_t j = 0; j < key_dictionaries_.size(); ++j) {
+        const GroupKeyDictionary& dictionary = others[i]->key_dictionaries_[j];
+        translations[i][j].reserve(dictionary.Size());
+        for (size_t code = 0; code < dictionary.Size(); ++code) {
+          const auto c = static_cast<int32_t>(code);
+          translations[i][j].push_back(key_dictionaries_[j].Lookup(dictionary.Decode(c), dictionary.Hash(c)));
         }
-        state_[group_by] = std::move(state);
-        it = state_.find(group_by);
       }
+    }
 
-      auto& state = it->second;
-      for (size_t j = 0; j < value_columns.size(); ++j) {
-        state[j]->Update(value_columns[j][i]);
+    GetThreadPool().ParallelFor(kPartitions, [&](int partition) {
+      for (size_t i = 0; i < others.size(); ++i) {
+        MergePartition(partition, *others[i], translations[i]);
       }
+    });
+  }
+
+  size_t Groups() const {
+    size_t groups = 0;
+    for (const auto& table : partitions_) {
+      groups += table.Size();
     }
+    return groups;
+  }
+
+  size_t MemoryUsage() const {
+    size_t bytes = 0;
+    for (const auto& table : partitions_) {
+      bytes += table.MemoryUsage();
+    }
+    for (const auto& dictionary : key_dictionaries_) {
+      bytes += dictionary.MemoryUsage();
+    }
+    for (const auto& accumulator : accumulators_) {
+      bytes += accumulator->MemoryUsage();
+    }
+    if (direct_.has_value()) {
+      bytes += direct_->partitions.capacity() + direct_->groups.capacity() * sizeof(uint32_t);
+    }
+    return bytes;
   }
 
   Batch Finalize() {
@@ -241,31 +491,212 @@ class Aggregator {
       Dispatch([&]<Type type>(Tag<type>) { columns.emplace_back(Column(ArrayType<type>{})); }, field.type);
     }
 
-    for (const auto& [group_by, state] : state_) {
-      std::vector<Value> values = group_by;
-      values.reserve(values.size() + state.size());
-      for (const auto& s : state) {
-        values.emplace_back(s->Finalize());
+    for (int partition = 0; partition < kPartitions; ++partition) {
+      for (size_t j = 0; j < key_types_.size(); ++j) {
+        AppendKeyColumn(partition, j, columns[j]);
       }
-      for (size_t i = 0; i < values.size(); ++i) {
-        Column& column = columns[i];
-        Value::GenericValue value = values[i].GetValue();
-
-        std::visit(
-            [value]<Type type>(ArrayType<type>& column) -> void {
-              if (std::holds_alternative<PhysicalType<type>>(value)) {
-                column.emplace_back(std::get<PhysicalType<type>>(value));
-              } else {
-                THROW_RUNTIME_ERROR("Type mismatch");
-              }
-            },
-            column.Values());
+      for (size_t a = 0; a < accumulators_.size(); ++a) {
+        accumulators_[a]->Finalize(partition, columns[key_types_.size() + a]);
       }
     }
     return Batch(std::move(columns), Schema(fields));
   }
 
  private:
+  // Dense index over the cross product of small integer key domains. Rows are mapped to groups by computing
+  // sum((key_j - min_j) * stride_j) column by column, without hashing.
+  struct DirectIndex {
+    static constexpr uint32_t kNoGroup = std::numeric_limits<uint32_t>::max();
+
+    std::vector<KeyDomain> domains;
+    std::vector<uint32_t> strides;
+
+    std::vector<uint8_t> partitions;
+    std::vector<uint32_t> groups;
+  };
+
+  void InitDirectIndex(const std::vector<std::optional<KeyDomain>>& key_domains) {
+    if (key_domains.size() != key_types_.size() || key_types_.empty()) {
+      return;
+    }
+
+    DirectIndex direct;
+    uint64_t size = 1;
+    for (size_t j = 0; j < key_types_.size(); ++j) {
+      const Type type = key_types_[j];
+      if (!key_domains[j].has_value() || (type != Type::kInt16 && type != Type::kInt32 && type != Type::kInt64)) {
+        return;
+      }
+      const KeyDomain& domain = *key_domains[j];
+      ASSERT(domain.min <= domain.max);
+      const auto width = static_cast<unsigned __int128>(static_cast<__int128>(domain.max) - domain.min + 1);
+      if (width > kMaxDirectAggregationGroups || size * width > kMaxDirectAggregationGroups) {
+        return;
+      }
+      direct.domains.push_back(domain);
+      direct.strides.push_back(static_cast<uint32_t>(size));
+      size *= static_cast<uint64_t>(width);
+    }
+
+    direct.partitions.resize(size);
+    direct.groups.resize(size, DirectIndex::kNoGroup);
+    direct_ = std::move(direct);
+  }
+
+  // Returns false if some key of the batch lies outside of its domain.
+  bool ComputeDirectIndices(const std::vector<Column>& key_columns, std::vector<uint32_t>& indices) const {
+    indices.assign(key_columns.empty() ? 0 : key_columns[0].Size(), 0);
+    for (size_t j = 0; j < key_columns.size(); ++j) {
+      const KeyDomain& domain = direct_->domains[j];
+      const uint32_t stride = direct_->strides[j];
+      const bool in_domain = std::visit(
+          [&]<Type type>(const ArrayType<type>& values) {
+            if constexpr (type == Type::kInt16 || type == Type::kInt32 || type == Type::kInt64) {
+              for (size_t i = 0; i < values.size(); ++i) {
+                const auto value = static_cast<int64_t>(values[i]);
+                if (value < domain.min || value > domain.max) {
+                  return false;
+                }
+                indices[i] += static_cast<uint32_t>(value - domain.min) * stride;
+              }
+              return true;
+            } else {
+              return false;
+            }
+          },
+          key_columns[j].Values());
+      if (!in_domain) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Packs the key of one row like AddKeyColumn does for whole columns and returns its finalized hash.
+  uint64_t PackRowKey(const std::vector<Column>& key_columns, size_t row, uint8_t* key) const {
+    uint64_t hash = 0;
+    for (size_t j = 0; j < key_columns.size(); ++j) {
+      std::visit(
+          [&]<Type type>(const ArrayType<type>& values) {
+            if constexpr (type == Type::kString) {
+              THROW_NOT_IMPLEMENTED;
+            } else {
+              hash = CombineHash(hash, KeyHash(values[row]));
+              std::memcpy(key + key_offsets_[j], &values[row], sizeof(PhysicalType<type>));
+            }
+          },
+          key_columns[j].Values());
+    }
+    return FinalizeHash(hash);
+  }
+
+  void AddKeyColumn(size_t j, const Column& column, std::vector<uint64_t>& hashes, std::vector<uint8_t>& keys) {
+    const size_t offset = key_offsets_[j];
+    std::visit(
+        [&]<Type type>(const ArrayType<type>& values) {
+          if constexpr (type == Type::kString) {
+            // Codes depend on the order values were seen in, so the string itself is hashed.
+            const std::vector<int32_t> codes = key_dictionaries_[j].Encode(values);
+            for (size_t i = 0; i < codes.size(); ++i) {
+              hashes[i] = CombineHash(hashes[i], key_dictionaries_[j].Hash(codes[i]));
+              std::memcpy(keys.data() + i * key_size_ + offset, &codes[i], sizeof(int32_t));
+            }
+          } else {
+            for (size_t i = 0; i < values.size(); ++i) {
+              hashes[i] = CombineHash(hashes[i], KeyHash(values[i]));
+              std::memcpy(keys.data() + i * key_size_ + offset, &values[i], sizeof(PhysicalType<type>));
+            }
+          }
+        },
+        column.Values());
+  }
+
+  void AppendKeyColumn(int partition, size_t j, Column& column) const {
+    const GroupTable& table = partitions_[partition];
+    const size_t offset = key_offsets_[j];
+    std::visit(
+        [&]<Type type>(ArrayType<type>& output) {
+          for (uint32_t group = 0; group < table.Size(); ++group) {
+            const uint8_t* key = table.Key(group, key_size_) + offset;
+            if constexpr (type == Type::kString) {
+              int32_t code;
+              std::memcpy(&code, key, sizeof(code));
+              output.emplace_back(key_dictionaries_[j].Decode(code));
+            } else {
+              PhysicalType<type> value;
+              std::memcpy(&value, key, sizeof(value));
+              output.emplace_back(value);
+            }
+          }
+        },
+        column.Values());
+  }
+
+  void ResizeAccumulators(int partition) {
+    for (auto& accumulator : accumulators_) {
+      accumulator->Resize(partition, partitions_[partition].Size());
+    }
+  }
+
+  void MergePartition(int partition, Aggregator& other, const std::vector<std::vector<int32_t>>& translation) {
+    GroupTable& table = partitions_[partition];
+    const GroupTable& source = other.partitions_[partition];
+
+    std::vector<uint8_t> key(key_size_);
+    std::vector<uint32_t> mapping(source.Size());
+    for (uint32_t group = 0; group < source.Size(); ++group) {
+      std::memcpy(key.data(), source.Key(group, key_size_), key_size_);
+      for (size_t j = 0; j < key_types_.size(); ++j) {
+        if (key_types_[j] == Type::kString) {
+          int32_t code;
+          std::memcpy(&code, key.data() + key_offsets_[j], sizeof(code));
+          std::memcpy(key.data() + key_offsets_[j], &translation[j][code], sizeof(code));
+        }
+      }
+      // Key hashes do not depend on string codes, so they stay valid.
+      mapping[group] = table.FindOrInsert(source.Hash(group), key.data(), key_size_);
+    }
+
+    ResizeAccumulators(partition);
+    for (size_t a = 0; a < accumulators_.size(); ++a) {
+      accumulators_[a]->Merge(partition, *other.accumulators_[a], mapping);
+    }
+    other.partitions_[partition] = GroupTable();
+  }
+
+  static std::unique_ptr<IAccumulator> MakeAccumulator(const AggregationUnit& unit) {
+    switch (unit.type) {
+      case AggregationType::kCount:
+        return std::make_unique<CountAccumulator>();
+      case AggregationType::kSum:
+        return Dispatch(
+            [&unit]<Type type>(Tag<type>) -> std::unique_ptr<IAccumulator> {
+              if constexpr (type == Type::kInt16 || type == Type::kInt32 || type == Type::kInt64 ||
+                            type == Type::kInt128) {
+                return std::make_unique<SumAccumulator<type>>(GetAggregationType(unit));
+              } else {
+                THROW_NOT_IMPLEMENTED;
+              }
+            },
+            GetExpressionType(unit.expression));
+      case AggregationType::kDistinct:
+        return std::make_unique<DistinctAccumulator>();
+      case AggregationType::kMin:
+        return Dispatch(
+            []<Type type>(Tag<type>) -> std::unique_ptr<IAccumulator> {
+              return std::make_unique<MinMaxAccumulator<type, true>>();
+            },
+            GetExpressionType(unit.expression));
+      case AggregationType::kMax:
+        return Dispatch(
+            []<Type type>(Tag<type>) -> std::unique_ptr<IAccumulator> {
+              return std::make_unique<MinMaxAccumulator<type, false>>();
+            },
+            GetExpressionType(unit.expression));
+    }
+    THROW_NOT_IMPLEMENTED;
+  }
+
   static Type GetExpressionType(const std::shared_ptr<Expression>& expression) {
     switch (expression->expr_type) {
       case ExpressionType::kVariable:
@@ -327,21 +758,60 @@ class Aggregator {
     THROW_NOT_IMPLEMENTED;
   }
 
-  std::unordered_map<std::vector<Value>, std::vector<std::shared_ptr<IState>>, VectorValueHash> state_;
   Aggregation aggregation_;
+  std::vector<GroupTable> partitions_;
+  std::vector<GroupKeyDictionary> key_dictionaries_;
+
+  std::vector<Type> key_types_;
+  std::vector<size_t> key_offsets_;
+  size_t key_size_ = 0;
+
+  std::vector<std::unique_ptr<IAccumulator>> accumulators_;
+
+  std::optional<DirectIndex> direct_;
 };
 
 }  // namespace
 
+class AggregationState::Impl : public Aggregator {
+ public:
+  using Aggregator::Aggregator;
+};
+
+AggregationState::AggregationState(std::shared_ptr<Aggregation> aggregation,
+                                   std::vector<std::optional<KeyDomain>> key_domains)
+    : impl_(std::make_unique<Impl>(*aggregation, key_domains)) {}
+
+AggregationState::AggregationState(AggregationState&&) noexcept = default;
+AggregationState& AggregationState::operator=(AggregationState&&) noexcept = default;
+AggregationState::~AggregationState() = default;
+
+void AggregationState::Consume(std::shared_ptr<Batch> batch) { impl_->Consume(std::move(batch)); }
+
+void AggregationState::Merge(std::vector<AggregationState> others) {
+  std::vector<Aggregator*> aggregators;
+  aggregators.reserve(others.size());
+  for (auto& other : others) {
+    aggregators.push_back(other.impl_.get());
+  }
+  impl_->Merge(aggregators);
+}
+
+size_t AggregationState::Groups() const { return impl_->Groups(); }
+
+size_t AggregationState::MemoryUsage() const { return impl_->MemoryUsage(); }
+
+std::shared_ptr<Batch> AggregationState::Finalize() { return std::make_shared<Batch>(impl_->Finalize()); }
+
 std::shared_ptr<Batch> Evaluate(std::shared_ptr<IStream<std::shared_ptr<Batch>>> stream,
                                 std::shared_ptr<Aggregation> aggregation) {
-  Aggregator aggregator(*aggregation);
+  AggregationState state(std::move(aggregation));
 
   while (const auto& batch = stream->Next()) {
-    aggregator.Consume(batch.value());
+    state.Consume(batch.value());
   }
 
-  return std::make_shared<Batch>(aggregator.Finalize());
+  return state.Finalize();
 }
 
 }  // namespace ngn
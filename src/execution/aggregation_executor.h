@@ -1,12 +1,54 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
+#include <optional>
+#include <vector>
 
 #include "src/execution/aggregation.h"
 #include "src/execution/stream.h"
 
 namespace ngn {
 
+// Range of the values of an integer group-by key, e.g. taken from zone maps.
+struct KeyDomain {
+  int64_t min;
+  int64_t max;
+};
+
+// Largest product of key domain sizes aggregated by indexing a dense array.
+inline constexpr uint64_t kMaxDirectAggregationGroups = uint64_t{1} << 20;
+
+// Hash aggregation state. Several instances can consume disjoint parts of the input, e.g. on different threads, and
+// then be merged into one. Groups are radix-partitioned by hash, so the partitions are merged in parallel.
+class AggregationState {
+ public:
+  // If every group-by key is an integer with a known domain and the domains are small, rows are mapped to groups by
+  // indexing a dense array with the keys instead of hashing them. Keys outside of the domains are still handled.
+  explicit AggregationState(std::shared_ptr<Aggregation> aggregation,
+                            std::vector<std::optional<KeyDomain>> key_domains = {});
+  AggregationState(AggregationState&&) noexcept;
+  AggregationState& operator=(AggregationState&&) noexcept;
+  ~AggregationState();
+
+  void Consume(std::shared_ptr<Batch> batch);
+
+  // Moves the groups of `others` into this state, combining groups present in several of them.
+  void Merge(std::vector<AggregationState> others);
+
+  // Number of groups seen so far.
+  size_t Groups() const;
+
+  // Approximate number of bytes held by the groups and their aggregates.
+  size_t MemoryUsage() const;
+
+  std::shared_ptr<Batch> Finalize();
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
 std::shared_ptr<Batch> Evaluate(std::shared_ptr<IStream<std::shared_ptr<Batch>>> batch,
                                 std::shared_ptr<Aggregation> aggregation);
 
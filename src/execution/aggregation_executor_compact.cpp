@@ -1,9 +1,11 @@
 #include "src/execution/aggregation_executor_compact.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <cstring>
 #include <optional>
-#include <type_traits>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 #include "src/core/column.h"
@@ -11,6 +13,7 @@
 #include "src/execution/aggregation_executor.h"  // fallback Evaluate()
 #include "src/execution/expression.h"
 #include "src/execution/int128.h"
+#include "src/execution/string_key_table.h"
 #include "src/util/assert.h"
 #include "src/util/macro.h"
 
@@ -69,7 +72,10 @@ static inline size_t SizeOfFixedWidthType(Type type) {
   return 0;
 }
 
-static inline bool IsFixedWidthType(Type type) { return SizeOfFixedWidthType(type) != 0; }
+// Strings are packed as int32 codes into a StringKeyTable.
+static inline size_t PackedSize(Type type) {
+  return type == Type::kString ? sizeof(int32_t) : SizeOfFixedWidthType(type);
+}
 
 struct KeyPart {
   Type type;
@@ -77,15 +83,15 @@ struct KeyPart {
   size_t size;
 };
 
-enum class StateKind { kCount, kSum, kMin, kMax };
+enum class StateKind { kCount, kSum, kMin, kMax, kDistinct };
 
 struct StatePart {
   StateKind kind;
   Type input_type;
   Type output_type;
   size_t has_value_offset;  // for min/max
-  size_t value_offset;
-  size_t value_size;
+  size_t value_offset;      // for distinct: the int64 number of distinct values
+  size_t value_size;        // for distinct: packed size of a value
 };
 
 struct CompactPlan {
@@ -96,14 +102,14 @@ struct CompactPlan {
   size_t state_size = 0;
 };
 
-static inline Type GetExpressionType(const std::shared_ptr<Expression>& expression) {
+static inline std::optional<Type> GetExpressionType(const std::shared_ptr<Expression>& expression) {
   switch (expression->expr_type) {
     case ExpressionType::kVariable:
       return std::static_pointer_cast<Variable>(expression)->type;
     case ExpressionType::kConst:
       return std::static_pointer_cast<Const>(expression)->value.GetType();
     default:
-      return Type::kString;  // sentinel for "unsupported" (non-fixed-width in our compact impl)
+      return std::nullopt;
   }
 }
 
@@ -123,28 +129,22 @@ static inline Type GetSumOutputType(Type input_type) {
 static std::optional<CompactPlan> TryBuildCompactPlan(const Aggregation& aggregation) {
   CompactPlan plan;
 
-  // Group-by: only fixed-width types for compact representation.
   size_t key_offset = 0;
   plan.key_parts.reserve(aggregation.group_by_expressions.size());
   for (const auto& g : aggregation.group_by_expressions) {
-    Type t = GetExpressionType(g.expression);
-    if (!IsFixedWidthType(t) || t == Type::kString) {
+    const std::optional<Type> t = GetExpressionType(g.expression);
+    if (!t.has_value()) {
       return std::nullopt;
     }
-    const size_t sz = SizeOfFixedWidthType(t);
-    plan.key_parts.push_back(KeyPart{.type = t, .offset = key_offset, .size = sz});
+    const size_t sz = PackedSize(*t);
+    plan.key_parts.push_back(KeyPart{.type = *t, .offset = key_offset, .size = sz});
     key_offset += sz;
   }
   plan.key_size = key_offset;
 
-  // Aggregations: support COUNT/SUM/MIN/MAX. DISTINCT unsupported (too memory heavy by design).
   size_t state_offset = 0;
   plan.state_parts.reserve(aggregation.aggregations.size());
   for (const auto& a : aggregation.aggregations) {
-    if (a.type == AggregationType::kDistinct) {
-      return std::nullopt;
-    }
-
     if (a.type == AggregationType::kCount) {
       plan.state_parts.push_back(StatePart{.kind = StateKind::kCount,
                                            .input_type = Type::kInt64,
@@ -156,20 +156,32 @@ static std::optional<CompactPlan> TryBuildCompactPlan(const Aggregation& aggrega
       continue;
     }
 
-    Type input_type = GetExpressionType(a.expression);
-    if (!IsFixedWidthType(input_type) || input_type == Type::kString) {
+    const std::optional<Type> input_type = GetExpressionType(a.expression);
+    if (!input_type.has_value()) {
       return std::nullopt;
     }
 
+    if (a.type == AggregationType::kDistinct) {
+      // Distinct values live in a separate set of (group key, value) pairs, the state only counts them.
+      plan.state_parts.push_back(StatePart{.kind = StateKind::kDistinct,
+                                           .input_type = *input_type,
+                                           .output_type = Type::kInt64,
+                                           .has_value_offset = 0,
+                                           .value_offset = state_offset,
+                                           .value_size = PackedSize(*input_type)});
+      state_offset += sizeof(int64_t);
+      continue;
+    }
+
     if (a.type == AggregationType::kSum) {
-      Type out_t = GetSumOutputType(input_type);
+      Type out_t = GetSumOutputType(*input_type);
       if (out_t == Type::kString) {
         return std::nullopt;
       }
 
       // Store sums internally as Int128 to avoid overflow and avoid per-agg variants.
       plan.state_parts.push_back(StatePart{.kind = StateKind::kSum,
-                                           .input_type = input_type,
+                                           .input_type = *input_type,
                                            .output_type = out_t,
                                            .has_value_offset = 0,
                                            .value_offset = state_offset,
@@ -182,13 +194,13 @@ static std::optional<CompactPlan> TryBuildCompactPlan(const Aggregation& aggrega
       const size_t has_value_off = state_offset;
       state_offset += sizeof(uint8_t);
       const size_t val_off = state_offset;
-      const size_t val_sz = SizeOfFixedWidthType(input_type);
+      const size_t val_sz = PackedSize(*input_type);
       state_offset += val_sz;
 
       plan.state_parts.push_back(StatePart{
           .kind = (a.type == AggregationType::kMin) ? StateKind::kMin : StateKind::kMax,
-          .input_type = input_type,
-          .output_type = input_type,
+          .input_type = *input_type,
+          .output_type = *input_type,
           .has_value_offset = has_value_off,
           .value_offset = val_off,
           .value_size = val_sz,
@@ -205,11 +217,15 @@ static std::optional<CompactPlan> TryBuildCompactPlan(const Aggregation& aggrega
 
 class FlatHashAggCompact {
  public:
-  FlatHashAggCompact(size_t key_size, size_t state_size) : key_size_(key_size), state_size_(state_size) {
-    Rehash(1u << 20);  // ~1M slots initial
+  FlatHashAggCompact(size_t key_size, size_t state_size, size_t initial_capacity = size_t{1} << 20)
+      : key_size_(key_size), state_size_(state_size) {
+    Rehash(initial_capacity);
   }
 
-  uint8_t* GetOrInsert(const uint8_t* key_bytes) {
+  uint8_t* GetOrInsert(const uint8_t* key_bytes) { return Insert(key_bytes).first; }
+
+  // Returns the state of the key and whether the key was inserted by this call.
+  std::pair<uint8_t*, bool> Insert(const uint8_t* key_bytes) {
     if (size_ + 1 > static_cast<size_t>(static_cast<double>(capacity_) * kMaxLoadFactor)) {
       Rehash(capacity_ * 2);
     }
@@ -221,29 +237,30 @@ class FlatHashAggCompact {
     while (occupied_[idx]) {
       const uint8_t* existing_key = &keys_[idx * key_size_];
       if (std::memcmp(existing_key, key_bytes, key_size_) == 0) {
-        return &states_[idx * state_size_];
+        return {states_.data() + idx * state_size_, false};
       }
       idx = (idx + 1) & mask;
     }
 
     occupied_[idx] = 1;
     std::memcpy(&keys_[idx * key_size_], key_bytes, key_size_);
-    std::memset(&states_[idx * state_size_], 0, state_size_);
     ++size_;
-    return &states_[idx * state_size_];
+    return {states_.data() + idx * state_size_, true};
   }
 
   template <typename Fn>
   void ForEach(Fn&& fn) const {
     for (size_t i = 0; i < capacity_; ++i) {
       if (occupied_[i]) {
-        fn(&keys_[i * key_size_], &states_[i * state_size_]);
+        fn(&keys_[i * key_size_], states_.data() + i * state_size_);
       }
     }
   }
 
   size_t Size() const { return size_; }
 
+  size_t MemoryUsage() const { return keys_.capacity() + states_.capacity() + occupied_.capacity(); }
+
  private:
   static constexpr double kMaxLoadFactor = 0.70;
 
@@ -283,7 +300,7 @@ class FlatHashAggCompact {
       }
 
       const uint8_t* key_ptr = &old_keys[i * key_size_];
-      const uint8_t* state_ptr = &old_states[i * state_size_];
+      const uint8_t* state_ptr = old_states.data() + i * state_size_;
       uint64_t h = HashBytes(key_ptr, key_size_);
       size_t idx = static_cast<size_t>(h) & mask;
       while (occupied_[idx]) {
@@ -292,7 +309,9 @@ class FlatHashAggCompact {
 
       occupied_[idx] = 1;
       std::memcpy(&keys_[idx * key_size_], key_ptr, key_size_);
-      std::memcpy(&states_[idx * state_size_], state_ptr, state_size_);
+      if (state_size_ != 0) {
+        std::memcpy(states_.data() + idx * state_size_, state_ptr, state_size_);
+      }
       ++size_;
     }
   }
@@ -310,7 +329,8 @@ class FlatHashAggCompact {
 
 struct ColAccessor {
   Type type;
-  const void* data;  // points to contiguous PhysicalType<type> array
+  const void* data;                      // points to contiguous PhysicalType<type> array
+  const StringArray* strings = nullptr;  // set instead of data for strings
 };
 
 static ColAccessor MakeAccessor(const Column& col) {
@@ -319,12 +339,21 @@ static ColAccessor MakeAccessor(const Column& col) {
   Dispatch(
       [&]<Type type>(Tag<type>) {
         const auto& arr = std::get<ArrayType<type>>(col.Values());
-        a.data = static_cast<const void*>(arr.data());
+        if constexpr (type != Type::kString) {
+          a.data = static_cast<const void*>(arr.data());
+        } else {
+          a.strings = &arr;
+        }
       },
       t);
   return a;
 }
 
+// Accessor packing the codes of a string column.
+static ColAccessor MakeCodesAccessor(const std::vector<int32_t>& codes) {
+  return ColAccessor{.type = Type::kInt32, .data = static_cast<const void*>(codes.data())};
+}
+
 static inline void PackValue(uint8_t* dst, const ColAccessor& acc, int64_t row) {
   switch (acc.type) {
     case Type::kBool:
@@ -403,104 +432,326 @@ static inline bool Less(Type type, const void* a, const void* b) {
 
 static inline bool Greater(Type type, const void* a, const void* b) { return Less(type, b, a); }
 
-static std::shared_ptr<Batch> EvaluateCompactGeneral(std::shared_ptr<IStream<std::shared_ptr<Batch>>> stream,
-                                                     std::shared_ptr<Aggregation> aggregation,
-                                                     const CompactPlan& plan) {
-  FlatHashAggCompact ht(plan.key_size, plan.state_size);
+class CompactAggregator {
+ public:
+  CompactAggregator(std::shared_ptr<Aggregation> aggregation, CompactPlan plan, size_t initial_groups)
+      : aggregation_(std::move(aggregation)),
+        plan_(std::move(plan)),
+        ht_(plan_.key_size, plan_.state_size, initial_groups),
+        key_strings_(plan_.key_parts.size()),
+        value_strings_(plan_.state_parts.size()),
+        distinct_sets_(plan_.state_parts.size()) {
+    // Pre-create expressions vectors to evaluate.
+    group_exprs_.reserve(aggregation_->group_by_expressions.size());
+    for (const auto& g : aggregation_->group_by_expressions) {
+      group_exprs_.emplace_back(g.expression);
+    }
+
+    // For aggregations, evaluate only for SUM/MIN/MAX/DISTINCT; COUNT ignores its input.
+    agg_exprs_.reserve(aggregation_->aggregations.size());
+    for (const auto& a : aggregation_->aggregations) {
+      if (a.type == AggregationType::kCount) {
+        agg_exprs_.emplace_back(std::nullopt);
+      } else {
+        agg_exprs_.emplace_back(a.expression);
+      }
+    }
 
-  // Pre-create expressions vectors to evaluate.
-  std::vector<std::shared_ptr<Expression>> group_exprs;
-  group_exprs.reserve(aggregation->group_by_expressions.size());
-  for (const auto& g : aggregation->group_by_expressions) {
-    group_exprs.emplace_back(g.expression);
+    for (size_t ai = 0; ai < plan_.state_parts.size(); ++ai) {
+      const auto& sp = plan_.state_parts[ai];
+      if (sp.kind == StateKind::kDistinct) {
+        distinct_sets_[ai].emplace(plan_.key_size + sp.value_size, 0, kInitialDistinctCapacity);
+      }
+    }
   }
 
-  // For aggregations, evaluate only for SUM/MIN/MAX; COUNT ignores its input.
-  std::vector<std::optional<std::shared_ptr<Expression>>> agg_exprs;
-  agg_exprs.reserve(aggregation->aggregations.size());
-  for (const auto& a : aggregation->aggregations) {
-    if (a.type == AggregationType::kCount) {
-      agg_exprs.emplace_back(std::nullopt);
-    } else {
-      agg_exprs.emplace_back(a.expression);
+  void Consume(const std::shared_ptr<Batch>& batch) {
+    // Evaluate group-by and aggregation input columns once per batch (for non-count aggs).
+    std::vector<Column> evaluated;
+    evaluated.reserve(group_exprs_.size() + agg_exprs_.size());
+    for (const auto& expr : group_exprs_) {
+      evaluated.emplace_back(Evaluate(batch, expr));
+    }
+    for (const auto& maybe_expr : agg_exprs_) {
+      if (maybe_expr.has_value()) {
+        evaluated.emplace_back(Evaluate(batch, maybe_expr.value()));
+      }
+    }
+
+    std::vector<const Column*> keys;
+    std::vector<const Column*> inputs;
+    size_t next = 0;
+    for (size_t i = 0; i < group_exprs_.size(); ++i) {
+      keys.push_back(&evaluated[next++]);
     }
+    for (const auto& maybe_expr : agg_exprs_) {
+      inputs.push_back(maybe_expr.has_value() ? &evaluated[next++] : nullptr);
+    }
+    Update(keys, inputs, batch->Rows(), /*finalized=*/false);
   }
 
-  std::vector<uint8_t> key_buf(plan.key_size);
+  // Folds in a result of Finalize() for the same aggregation, e.g. by an AggregationState: the key columns followed by
+  // one column per aggregation. Counts and sums are added up; DISTINCT results cannot be combined.
+  void ConsumeFinalized(const std::shared_ptr<Batch>& partial) {
+    const auto& columns = partial->Columns();
+    ASSERT(columns.size() == plan_.key_parts.size() + plan_.state_parts.size());
+
+    std::vector<const Column*> keys;
+    std::vector<const Column*> inputs;
+    for (size_t i = 0; i < columns.size(); ++i) {
+      (i < plan_.key_parts.size() ? keys : inputs).push_back(&columns[i]);
+    }
+    Update(keys, inputs, partial->Rows(), /*finalized=*/true);
+  }
+  // Combines the groups of `other`, which must use the same plan, into this table.
+  void Merge(const CompactAggregator& other) {
+    std::vector<uint8_t> key(plan_.key_size);
+    other.ht_.ForEach([&](const uint8_t* key_bytes, const uint8_t* other_state) {
+      std::memcpy(key.data(), key_bytes, plan_.key_size);
+      TranslateKey(other, key.data());
+      uint8_t* state = ht_.GetOrInsert(key.data());
+      for (size_t ai = 0; ai < plan_.state_parts.size(); ++ai) {
+        const auto& sp = plan_.state_parts[ai];
+        switch (sp.kind) {
+          case StateKind::kCount:
+            *reinterpret_cast<int64_t*>(state + sp.value_offset) +=
+                *reinterpret_cast<const int64_t*>(other_state + sp.value_offset);
+            break;
+          case StateKind::kSum:
+            *reinterpret_cast<Int128*>(state + sp.value_offset) +=
+                *reinterpret_cast<const Int128*>(other_state + sp.value_offset);
+            break;
+          case StateKind::kMin:
+          case StateKind::kMax:
+            if (other_state[sp.has_value_offset] == 0) {
+              break;
+            }
+            if (sp.input_type == Type::kString) {
+              UpdateMinMaxString(ai, state, other.value_strings_[ai].Decode(LoadCode(other_state + sp.value_offset)));
+            } else {
+              UpdateMinMax(sp, state, other_state + sp.value_offset);
+            }
+            break;
+          case StateKind::kDistinct:
+            // Values seen by both sides must be counted once, so the counts are rebuilt from the pairs below.
+            break;
+        }
+      }
+    });
+
+    for (size_t ai = 0; ai < plan_.state_parts.size(); ++ai) {
+      const auto& sp = plan_.state_parts[ai];
+      if (sp.kind != StateKind::kDistinct) {
+        continue;
+      }
+      std::vector<uint8_t> pair(plan_.key_size + sp.value_size);
+      other.distinct_sets_[ai]->ForEach([&](const uint8_t* pair_bytes, const uint8_t*) {
+        std::memcpy(pair.data(), pair_bytes, pair.size());
+        TranslateKey(other, pair.data());
+        if (sp.input_type == Type::kString) {
+          TranslateCode(other.value_strings_[ai], value_strings_[ai], pair.data() + plan_.key_size);
+        }
+        if (distinct_sets_[ai]->Insert(pair.data()).second) {
+          // The leading bytes of a pair are its group key.
+          *reinterpret_cast<int64_t*>(ht_.GetOrInsert(pair.data()) + sp.value_offset) += 1;
+        }
+      });
+    }
+  }
+
+  size_t MemoryUsage() const {
+    size_t bytes = ht_.MemoryUsage();
+    for (const auto& strings : key_strings_) {
+      bytes += strings.MemoryUsage();
+    }
+    for (const auto& strings : value_strings_) {
+      bytes += strings.MemoryUsage();
+    }
+    for (const auto& set : distinct_sets_) {
+      bytes += set.has_value() ? set->MemoryUsage() : 0;
+    }
+    return bytes;
+  }
+
+  std::shared_ptr<Batch> Finalize() const {
+    // Build output schema.
+    std::vector<Field> fields;
+    fields.reserve(aggregation_->group_by_expressions.size() + aggregation_->aggregations.size());
+    for (size_t i = 0; i < aggregation_->group_by_expressions.size(); ++i) {
+      fields.emplace_back(Field(aggregation_->group_by_expressions[i].name, plan_.key_parts[i].type));
+    }
+    for (size_t i = 0; i < aggregation_->aggregations.size(); ++i) {
+      fields.emplace_back(Field(aggregation_->aggregations[i].name, plan_.state_parts[i].output_type));
+    }
+
+    std::vector<Column> columns;
+    columns.reserve(fields.size());
+    const size_t n = ht_.Size();
+    for (const auto& f : fields) {
+      Dispatch([&]<Type type>(Tag<type>) { columns.emplace_back(Column(ArrayType<type>{})); }, f.type);
+      std::visit([&]<Type type>(ArrayType<type>& arr) { arr.reserve(n); }, columns.back().Values());
+    }
+
+    // Helper: append a packed value from bytes to a column. String codes are decoded through `strings`.
+    auto append_from_bytes = [&](size_t col_idx, Type type, const uint8_t* src,
+                                 const StringKeyTable* strings = nullptr) {
+      Column& col = columns[col_idx];
+      Dispatch(
+          [&]<Type t>(Tag<t>) {
+            auto& arr = std::get<ArrayType<t>>(col.Values());
+            if constexpr (t == Type::kString) {
+              ASSERT(strings != nullptr);
+              arr.emplace_back(strings->Decode(LoadCode(src)));
+            } else {
+              PhysicalType<t> v{};
+              std::memcpy(&v, src, sizeof(PhysicalType<t>));
+              arr.emplace_back(v);
+            }
+          },
+          type);
+    };
+
+    // Materialize output.
+    ht_.ForEach([&](const uint8_t* key_bytes, const uint8_t* state_bytes) {
+      size_t out_col = 0;
+
+      // Group-by key columns.
+      for (size_t i = 0; i < plan_.key_parts.size(); ++i) {
+        const auto& kp = plan_.key_parts[i];
+        append_from_bytes(out_col, kp.type, key_bytes + kp.offset, &key_strings_[i]);
+        ++out_col;
+      }
+
+      // Aggregations.
+      for (size_t ai = 0; ai < plan_.state_parts.size(); ++ai) {
+        const auto& sp = plan_.state_parts[ai];
+        const uint8_t* value_ptr = state_bytes + sp.value_offset;
+
+        switch (sp.kind) {
+          case StateKind::kCount:
+          case StateKind::kDistinct: {
+            append_from_bytes(out_col, Type::kInt64, value_ptr);
+            break;
+          }
+          case StateKind::kSum: {
+            const Int128 sum = *reinterpret_cast<const Int128*>(value_ptr);
+            if (sp.output_type == Type::kInt64) {
+              const int64_t v = static_cast<int64_t>(sum);
+              append_from_bytes(out_col, Type::kInt64, reinterpret_cast<const uint8_t*>(&v));
+            } else {
+              append_from_bytes(out_col, Type::kInt128, reinterpret_cast<const uint8_t*>(&sum));
+            }
+            break;
+          }
+          case StateKind::kMin:
+          case StateKind::kMax: {
+            const uint8_t has_value = *(state_bytes + sp.has_value_offset);
+            ASSERT(has_value != 0);
+            append_from_bytes(out_col, sp.output_type, value_ptr, &value_strings_[ai]);
+            break;
+          }
+        }
+
+        ++out_col;
+      }
+    });
 
-  while (auto batch_opt = stream->Next()) {
-    std::shared_ptr<Batch> batch = batch_opt.value();
-    const int64_t rows = batch->Rows();
+    return std::make_shared<Batch>(std::move(columns), Schema(fields));
+  }
 
-    // Evaluate group-by columns once per batch.
+ private:
+  // Sets of (group key, value) pairs start small: they only grow large for queries with many groups or values.
+  static constexpr size_t kInitialDistinctCapacity = size_t{1} << 10;
+
+  // Combines `rows` rows into the groups. `inputs` has one column per aggregation, nullptr for COUNT over the input.
+  // With `finalized` the inputs are results of the aggregations rather than their arguments.
+  void Update(const std::vector<const Column*>& keys, const std::vector<const Column*>& inputs, int64_t rows,
+              bool finalized) {
+    // String codes must outlive the accessors pointing into them.
+    std::vector<std::vector<int32_t>> codes;
+    codes.reserve(keys.size() + inputs.size());
+
+    // String keys are packed as codes.
     std::vector<ColAccessor> group_cols;
-    group_cols.reserve(group_exprs.size());
-    for (const auto& expr : group_exprs) {
-      Column c = Evaluate(batch, expr);
-      group_cols.emplace_back(MakeAccessor(c));
+    group_cols.reserve(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+      ColAccessor accessor = MakeAccessor(*keys[i]);
+      if (accessor.strings != nullptr) {
+        codes.emplace_back(key_strings_[i].Encode(*accessor.strings));
+        accessor = MakeCodesAccessor(codes.back());
+      }
+      group_cols.emplace_back(accessor);
     }
 
-    // Evaluate aggregation input columns once per batch (for non-count aggs).
+    // Distinct strings are packed as codes, min/max compare the strings themselves.
     std::vector<std::optional<ColAccessor>> agg_cols;
-    agg_cols.reserve(agg_exprs.size());
-    for (const auto& maybe_expr : agg_exprs) {
-      if (!maybe_expr.has_value()) {
+    agg_cols.reserve(inputs.size());
+    for (size_t ai = 0; ai < inputs.size(); ++ai) {
+      if (inputs[ai] == nullptr) {
         agg_cols.emplace_back(std::nullopt);
-      } else {
-        Column c = Evaluate(batch, maybe_expr.value());
-        agg_cols.emplace_back(MakeAccessor(c));
+        continue;
+      }
+      ColAccessor accessor = MakeAccessor(*inputs[ai]);
+      if (accessor.strings != nullptr && plan_.state_parts[ai].kind == StateKind::kDistinct) {
+        codes.emplace_back(value_strings_[ai].Encode(*accessor.strings));
+        accessor = MakeCodesAccessor(codes.back());
       }
+      agg_cols.emplace_back(accessor);
     }
 
+    std::vector<uint8_t> key_buf(plan_.key_size);
+    std::vector<uint8_t> pair_buf;
     for (int64_t r = 0; r < rows; ++r) {
       // Pack group-by key for this row.
-      for (size_t i = 0; i < plan.key_parts.size(); ++i) {
-        const auto& kp = plan.key_parts[i];
+      for (size_t i = 0; i < plan_.key_parts.size(); ++i) {
+        const auto& kp = plan_.key_parts[i];
         PackValue(&key_buf[kp.offset], group_cols[i], r);
       }
 
-      uint8_t* state = ht.GetOrInsert(key_buf.data());
+      uint8_t* state = ht_.GetOrInsert(key_buf.data());
 
       // Update states.
-      for (size_t ai = 0; ai < plan.state_parts.size(); ++ai) {
-        const auto& sp = plan.state_parts[ai];
+      for (size_t ai = 0; ai < plan_.state_parts.size(); ++ai) {
+        const auto& sp = plan_.state_parts[ai];
         uint8_t* value_ptr = state + sp.value_offset;
 
         switch (sp.kind) {
           case StateKind::kCount: {
             auto* cnt = reinterpret_cast<int64_t*>(value_ptr);
-            *cnt += 1;
+            *cnt += finalized ? LoadAt<Type::kInt64>(agg_cols[ai]->data, r) : 1;
             break;
           }
           case StateKind::kSum: {
             ASSERT(agg_cols[ai].has_value());
             const auto& acc = agg_cols[ai].value();
             auto* sum = reinterpret_cast<Int128*>(value_ptr);
-            *sum += ToInt128(sp.input_type, acc.data, r);
+            *sum += ToInt128(finalized ? sp.output_type : sp.input_type, acc.data, r);
             break;
           }
           case StateKind::kMin:
           case StateKind::kMax: {
             ASSERT(agg_cols[ai].has_value());
             const auto& acc = agg_cols[ai].value();
-
-            uint8_t* has_value = state + sp.has_value_offset;
-            uint8_t* stored = state + sp.value_offset;
+            if (acc.strings != nullptr) {
+              UpdateMinMaxString(ai, state, (*acc.strings)[r]);
+              break;
+            }
 
             // Load candidate into a temporary small buffer on stack.
             // value_size is <= 16 for supported types.
             uint8_t tmp[sizeof(Int128)] = {};
             PackValue(tmp, acc, r);
-
-            if (*has_value == 0) {
-              *has_value = 1;
-              std::memcpy(stored, tmp, sp.value_size);
-            } else {
-              const bool better =
-                  (sp.kind == StateKind::kMin) ? Less(sp.input_type, tmp, stored) : Greater(sp.input_type, tmp, stored);
-              if (better) {
-                std::memcpy(stored, tmp, sp.value_size);
-              }
+            UpdateMinMax(sp, state, tmp);
+            break;
+          }
+          case StateKind::kDistinct: {
+            ASSERT(agg_cols[ai].has_value());
+            ASSERT(!finalized);
+            pair_buf.resize(plan_.key_size + sp.value_size);
+            std::memcpy(pair_buf.data(), key_buf.data(), plan_.key_size);
+            PackValue(pair_buf.data() + plan_.key_size, agg_cols[ai].value(), r);
+            if (distinct_sets_[ai]->Insert(pair_buf.data()).second) {
+              *reinterpret_cast<int64_t*>(value_ptr) += 1;
             }
             break;
           }
@@ -509,112 +760,164 @@ static std::shared_ptr<Batch> EvaluateCompactGeneral(std::shared_ptr<IStream<std
     }
   }
 
-  // Build output schema.
-  std::vector<Field> fields;
-  fields.reserve(aggregation->group_by_expressions.size() + aggregation->aggregations.size());
-  for (const auto& g : aggregation->group_by_expressions) {
-    fields.emplace_back(Field(g.name, GetExpressionType(g.expression)));
+  static int32_t LoadCode(const uint8_t* src) {
+    int32_t code;
+    std::memcpy(&code, src, sizeof(code));
+    return code;
   }
-  for (size_t i = 0; i < aggregation->aggregations.size(); ++i) {
-    const auto& a = aggregation->aggregations[i];
-    Type out_t = Type::kInt64;
-    if (a.type == AggregationType::kCount) {
-      out_t = Type::kInt64;
-    } else if (a.type == AggregationType::kSum) {
-      out_t = plan.state_parts[i].output_type;
-    } else if (a.type == AggregationType::kMin || a.type == AggregationType::kMax) {
-      out_t = plan.state_parts[i].output_type;
-    } else {
-      THROW_NOT_IMPLEMENTED;
+
+  // Replaces the code at `dst`, which indexes `from`, with the code of the same string in `to`.
+  static void TranslateCode(const StringKeyTable& from, StringKeyTable& to, uint8_t* dst) {
+    const int32_t code = LoadCode(dst);
+    const int32_t translated = to.Lookup(from.Decode(code), from.Hash(code));
+    std::memcpy(dst, &translated, sizeof(translated));
+  }
+
+  // Rewrites the string codes of a key packed by `other` into codes of this aggregator.
+  void TranslateKey(const CompactAggregator& other, uint8_t* key) {
+    for (size_t i = 0; i < plan_.key_parts.size(); ++i) {
+      if (plan_.key_parts[i].type == Type::kString) {
+        TranslateCode(other.key_strings_[i], key_strings_[i], key + plan_.key_parts[i].offset);
+      }
     }
-    fields.emplace_back(Field(a.name, out_t));
   }
 
-  std::vector<Column> columns;
-  columns.reserve(fields.size());
-  const size_t n = ht.Size();
-  for (const auto& f : fields) {
-    Dispatch([&]<Type type>(Tag<type>) { columns.emplace_back(Column(ArrayType<type>{})); }, f.type);
-    std::visit([&]<Type type>(ArrayType<type>& arr) { arr.reserve(n); }, columns.back().Values());
+  void UpdateMinMax(const StatePart& sp, uint8_t* state, const uint8_t* candidate) const {
+    uint8_t* has_value = state + sp.has_value_offset;
+    uint8_t* stored = state + sp.value_offset;
+    if (*has_value == 0) {
+      *has_value = 1;
+      std::memcpy(stored, candidate, sp.value_size);
+      return;
+    }
+    const bool better = (sp.kind == StateKind::kMin) ? Less(sp.input_type, candidate, stored)
+                                                     : Greater(sp.input_type, candidate, stored);
+    if (better) {
+      std::memcpy(stored, candidate, sp.value_size);
+    }
   }
 
-  // Helper: append a fixed-width value from bytes to a column.
-  auto append_from_bytes = [&](size_t col_idx, Type type, const uint8_t* src) {
-    Column& col = columns[col_idx];
-    Dispatch(
-        [&]<Type t>(Tag<t>) {
-          auto& arr = std::get<ArrayType<t>>(col.Values());
-          if constexpr (std::is_trivially_copyable_v<PhysicalType<t>>) {
-            PhysicalType<t> v{};
-            std::memcpy(&v, src, sizeof(PhysicalType<t>));
-            arr.emplace_back(v);
-          } else {
-            // e.g. std::string - compact aggregation doesn't support non-trivial types
-            THROW_NOT_IMPLEMENTED;
-          }
-        },
-        type);
-  };
+  // String minimums and maximums are stored as codes. Only candidates that win the comparison are interned.
+  void UpdateMinMaxString(size_t ai, uint8_t* state, std::string_view candidate) {
+    const auto& sp = plan_.state_parts[ai];
+    uint8_t* has_value = state + sp.has_value_offset;
+    uint8_t* stored = state + sp.value_offset;
+    if (*has_value != 0) {
+      const std::string_view current = value_strings_[ai].Decode(LoadCode(stored));
+      const bool better = (sp.kind == StateKind::kMin) ? candidate < current : candidate > current;
+      if (!better) {
+        return;
+      }
+    }
+    *has_value = 1;
+    const int32_t code = value_strings_[ai].Lookup(candidate);
+    std::memcpy(stored, &code, sizeof(code));
+  }
+
+  std::shared_ptr<Aggregation> aggregation_;
+  CompactPlan plan_;
+  FlatHashAggCompact ht_;
+
+  // Codes of string keys, one table per key part (unused for other types).
+  std::vector<StringKeyTable> key_strings_;
+  // Codes of string MIN/MAX/DISTINCT inputs, one table per aggregation (unused for other aggregations).
+  std::vector<StringKeyTable> value_strings_;
+  // For every DISTINCT aggregation, the set of (group key, value) pairs seen so far.
+  std::vector<std::optional<FlatHashAggCompact>> distinct_sets_;
+
+  std::vector<std::shared_ptr<Expression>> group_exprs_;
+  std::vector<std::optional<std::shared_ptr<Expression>>> agg_exprs_;
+};
+
+}  // namespace
 
-  // Materialize output.
-  ht.ForEach([&](const uint8_t* key_bytes, const uint8_t* state_bytes) {
-    size_t out_col = 0;
+bool SupportsCompactAggregation(const Aggregation& aggregation) { return TryBuildCompactPlan(aggregation).has_value(); }
+
+bool SupportsPartialAggregation(const Aggregation& aggregation) {
+  return SupportsCompactAggregation(aggregation) &&
+         std::none_of(aggregation.aggregations.begin(), aggregation.aggregations.end(),
+                      [](const AggregationUnit& unit) { return unit.type == AggregationType::kDistinct; });
+}
 
-    // Group-by key columns.
-    for (const auto& kp : plan.key_parts) {
-      append_from_bytes(out_col, kp.type, key_bytes + kp.offset);
-      ++out_col;
+class CompactAggregationState::Impl {
+ public:
+  Impl(std::shared_ptr<Aggregation> aggregation, size_t initial_groups) {
+    ASSERT(aggregation != nullptr);
+    auto plan = TryBuildCompactPlan(*aggregation);
+    if (plan.has_value()) {
+      compact_.emplace(std::move(aggregation), std::move(plan.value()), initial_groups);
+    } else {
+      fallback_.emplace(std::move(aggregation));
     }
+  }
 
-    // Aggregations.
-    for (size_t ai = 0; ai < plan.state_parts.size(); ++ai) {
-      const auto& sp = plan.state_parts[ai];
-      const uint8_t* value_ptr = state_bytes + sp.value_offset;
+  void Consume(std::shared_ptr<Batch> batch) {
+    if (compact_.has_value()) {
+      compact_->Consume(batch);
+    } else {
+      fallback_->Consume(std::move(batch));
+    }
+  }
 
-      switch (sp.kind) {
-        case StateKind::kCount: {
-          append_from_bytes(out_col, Type::kInt64, value_ptr);
-          break;
-        }
-        case StateKind::kSum: {
-          const Int128 sum = *reinterpret_cast<const Int128*>(value_ptr);
-          if (sp.output_type == Type::kInt64) {
-            const int64_t v = static_cast<int64_t>(sum);
-            append_from_bytes(out_col, Type::kInt64, reinterpret_cast<const uint8_t*>(&v));
-          } else {
-            append_from_bytes(out_col, Type::kInt128, reinterpret_cast<const uint8_t*>(&sum));
-          }
-          break;
-        }
-        case StateKind::kMin:
-        case StateKind::kMax: {
-          const uint8_t has_value = *(state_bytes + sp.has_value_offset);
-          ASSERT(has_value != 0);
-          append_from_bytes(out_col, sp.output_type, value_ptr);
-          break;
-        }
+  void ConsumeFinalized(const std::shared_ptr<Batch>& partial) {
+    ASSERT(compact_.has_value());
+    compact_->ConsumeFinalized(partial);
+  }
+
+  void Merge(std::vector<CompactAggregationState>& others) {
+    if (compact_.has_value()) {
+      for (auto& other : others) {
+        compact_->Merge(other.impl_->compact_.value());
+        other.impl_->compact_.reset();
       }
+      return;
+    }
 
-      ++out_col;
+    std::vector<AggregationState> fallbacks;
+    fallbacks.reserve(others.size());
+    for (auto& other : others) {
+      fallbacks.emplace_back(std::move(other.impl_->fallback_.value()));
     }
-  });
+    fallback_->Merge(std::move(fallbacks));
+  }
+
+  size_t MemoryUsage() const { return compact_.has_value() ? compact_->MemoryUsage() : fallback_->MemoryUsage(); }
+
+  std::shared_ptr<Batch> Finalize() { return compact_.has_value() ? compact_->Finalize() : fallback_->Finalize(); }
+
+ private:
+  std::optional<CompactAggregator> compact_;
+  std::optional<AggregationState> fallback_;
+};
+
+CompactAggregationState::CompactAggregationState(std::shared_ptr<Aggregation> aggregation, size_t initial_groups)
+    : impl_(std::make_unique<Impl>(std::move(aggregation), initial_groups)) {}
+
+CompactAggregationState::CompactAggregationState(CompactAggregationState&&) noexcept = default;
+CompactAggregationState& CompactAggregationState::operator=(CompactAggregationState&&) noexcept = default;
+CompactAggregationState::~CompactAggregationState() = default;
+
+void CompactAggregationState::Consume(std::shared_ptr<Batch> batch) { impl_->Consume(std::move(batch)); }
 
-  return std::make_shared<Batch>(std::move(columns), Schema(fields));
+void CompactAggregationState::ConsumeFinalized(const std::shared_ptr<Batch>& partial) {
+  impl_->ConsumeFinalized(partial);
 }
 
-}  // namespace
+void CompactAggregationState::Merge(std::vector<CompactAggregationState> others) { impl_->Merge(others); }
+
+size_t CompactAggregationState::MemoryUsage() const { return impl_->MemoryUsage(); }
+
+std::shared_ptr<Batch> CompactAggregationState::Finalize() { return impl_->Finalize(); }
 
 std::shared_ptr<Batch> EvaluateCompact(std::shared_ptr<IStream<std::shared_ptr<Batch>>> stream,
                                        std::shared_ptr<Aggregation> aggregation) {
   ASSERT(stream != nullptr);
-  ASSERT(aggregation != nullptr);
 
-  auto plan = TryBuildCompactPlan(*aggregation);
-  if (!plan.has_value()) {
-    return Evaluate(std::move(stream), std::move(aggregation));
+  CompactAggregationState state(std::move(aggregation));
+  while (auto batch = stream->Next()) {
+    state.Consume(std::move(batch.value()));
   }
-
-  return EvaluateCompactGeneral(std::move(stream), std::move(aggregation), plan.value());
+  return state.Finalize();
 }
 
 }  // namespace ngn
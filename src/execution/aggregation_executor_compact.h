@@ -1,16 +1,62 @@
 #pragma once
 
+#include <cstddef>
 #include <memory>
+#include <vector>
 
 #include "src/execution/aggregation.h"
 #include "src/execution/stream.h"
 
 namespace ngn {
 
+// Initial table size of a CompactAggregationState, sized for the very many groups it is meant for.
+inline constexpr size_t kCompactAggregationInitialGroups = size_t{1} << 20;
+
 // A memory-lean aggregation path intended for very high-cardinality GROUP BY.
-// It currently specializes the ClickBench Q32 aggregation shape (two integer keys and simple COUNT/SUMs).
+// Keys of any type are packed into one fixed-width byte string (strings as codes of an arena-backed table) and the
+// states of a group are laid out row-major next to each other. COUNT, SUM, MIN, MAX and DISTINCT are supported;
+// DISTINCT values are kept in a set of (group key, value) pairs.
+//
+// Group-by and aggregation inputs must be variables or constants; otherwise this falls back to the generic
+// AggregationState.
 //
-// If the aggregation is not recognized as supported, it MUST fall back to the generic Evaluate().
+// Like AggregationState, several instances can consume parts of the input and be merged. Each keeps its own table, so
+// merging trades the extra memory of per-thread tables for parallelism.
+class CompactAggregationState {
+ public:
+  // The table starts with room for `initial_groups` groups and doubles whenever it fills up.
+  explicit CompactAggregationState(std::shared_ptr<Aggregation> aggregation,
+                                   size_t initial_groups = kCompactAggregationInitialGroups);
+  CompactAggregationState(CompactAggregationState&&) noexcept;
+  CompactAggregationState& operator=(CompactAggregationState&&) noexcept;
+  ~CompactAggregationState();
+
+  void Consume(std::shared_ptr<Batch> batch);
+
+  // Folds in the result of Finalize() of another state over the same aggregation, e.g. an AggregationState that grew
+  // too large. Requires SupportsCompactAggregation() and no DISTINCT aggregations.
+  void ConsumeFinalized(const std::shared_ptr<Batch>& partial);
+
+  void Merge(std::vector<CompactAggregationState> others);
+
+  // Approximate number of bytes held by the groups and their aggregates.
+  size_t MemoryUsage() const;
+
+  std::shared_ptr<Batch> Finalize();
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+// Whether CompactAggregationState handles `aggregation` itself instead of falling back.
+bool SupportsCompactAggregation(const Aggregation& aggregation);
+
+// Whether finalized partial results of `aggregation` can be folded into a CompactAggregationState with
+// ConsumeFinalized(): the compact state must support it and there must be no DISTINCT aggregations.
+bool SupportsPartialAggregation(const Aggregation& aggregation);
+
+// Consumes the whole stream into a single CompactAggregationState.
 std::shared_ptr<Batch> EvaluateCompact(std::shared_ptr<IStream<std::shared_ptr<Batch>>> stream,
                                        std::shared_ptr<Aggregation> aggregation);
 
@@ -0,0 +1,173 @@
+#include "src/execution/aggregation_spill.h"
+
+#include <atomic>
+#include <iterator>
+#include <optional>
+
+#include "src/core/bloom_filter.h"
+#include "src/execution/thread_pool.h"
+#include "src/util/assert.h"
+
+namespace ngn {
+
+namespace {
+
+// Deeper partitions are combined in memory regardless of the budget: 16^4 partitions of one spilled aggregation are
+// enough for any realistic input, and beyond that the groups are probably too large rather than too many.
+constexpr int kMaxSpillLevels = 4;
+
+// Splits the rows of `batch` by the hash of its first `keys` columns. Partitions of level l are selected by the l-th
+// group of AggregationSpill::kPartitionBits bits from the top of the hash.
+std::vector<std::vector<Column>> PartitionRows(const Batch& batch, size_t keys, int level) {
+  const auto& columns = batch.Columns();
+  const size_t rows = batch.Rows();
+
+  std::vector<uint64_t> hashes(rows, 0);
+  for (size_t j = 0; j < keys; ++j) {
+    std::visit(
+        [&hashes](const auto& values) {
+          for (size_t i = 0; i < hashes.size(); ++i) {
+            hashes[i] = (hashes[i] ^ BloomHash(values[i])) * 0x9e3779b97f4a7c15ULL;
+          }
+        },
+        columns[j].Values());
+  }
+
+  const int shift = 64 - AggregationSpill::kPartitionBits * (level + 1);
+  std::vector<uint8_t> partitions(rows);
+  for (size_t i = 0; i < rows; ++i) {
+    partitions[i] = static_cast<uint8_t>((internal::Mix64(hashes[i]) >> shift) & (AggregationSpill::kPartitions - 1));
+  }
+
+  std::vector<std::vector<Column>> result(AggregationSpill::kPartitions);
+  for (const auto& column : columns) {
+    std::visit(
+        [&]<Type type>(const ArrayType<type>& values) {
+          std::vector<ArrayType<type>> parts(AggregationSpill::kPartitions);
+          for (size_t i = 0; i < rows; ++i) {
+            parts[partitions[i]].emplace_back(values[i]);
+          }
+          for (int p = 0; p < AggregationSpill::kPartitions; ++p) {
+            result[p].emplace_back(Column(std::move(parts[p])));
+          }
+        },
+        column.Values());
+  }
+  return result;
+}
+
+std::shared_ptr<Batch> Concatenate(const std::vector<std::shared_ptr<Batch>>& batches) {
+  ASSERT(!batches.empty());
+  std::vector<Column> columns = batches[0]->Columns();
+  for (size_t b = 1; b < batches.size(); ++b) {
+    for (size_t j = 0; j < columns.size(); ++j) {
+      std::visit(
+          [&]<Type type>(ArrayType<type>& output) {
+            const auto& values = std::get<ArrayType<type>>(batches[b]->Columns()[j].Values());
+            if constexpr (type == Type::kString) {
+              output.AppendRange(values, 0, values.size());
+            } else {
+              output.insert(output.end(), values.begin(), values.end());
+            }
+          },
+          columns[j].Values());
+    }
+  }
+  return std::make_shared<Batch>(std::move(columns), batches[0]->GetSchema());
+}
+
+}  // namespace
+
+AggregationSpill::AggregationSpill(std::shared_ptr<Aggregation> aggregation, int64_t budget, int parallelism,
+                                   int level)
+    : aggregation_(std::move(aggregation)), budget_(budget), parallelism_(parallelism), level_(level) {
+  ASSERT(parallelism_ >= 1);
+  ASSERT(level_ < kMaxSpillLevels);
+}
+
+void AggregationSpill::Spill(const std::shared_ptr<Batch>& partial) {
+  if (partial->Rows() == 0) {
+    return;
+  }
+
+  std::vector<std::vector<Column>> partitions =
+      PartitionRows(*partial, aggregation_->group_by_expressions.size(), level_);
+  File file;
+  FileWriter writer(file.file.Path().string(), partial->GetSchema(), SpillFileOptions());
+  int64_t row_groups = 0;
+  for (auto& columns : partitions) {
+    if (columns[0].Size() == 0) {
+      file.row_groups.push_back(-1);
+      continue;
+    }
+    file.row_groups.push_back(row_groups++);
+    writer.AppendRowGroup(std::move(columns));
+  }
+  std::move(writer).Finalize();
+  files_.push_back(std::move(file));
+}
+
+void AggregationSpill::Merge(std::vector<AggregationSpill> others) {
+  for (auto& other : others) {
+    files_.insert(files_.end(), std::make_move_iterator(other.files_.begin()),
+                  std::make_move_iterator(other.files_.end()));
+    other.files_.clear();
+  }
+}
+
+std::shared_ptr<Batch> AggregationSpill::Finalize(const std::shared_ptr<Batch>& partial) {
+  ASSERT(SupportsPartialAggregation(*aggregation_));
+
+  std::vector<std::vector<Column>> in_memory =
+      PartitionRows(*partial, aggregation_->group_by_expressions.size(), level_);
+  std::vector<std::shared_ptr<Batch>> results(kPartitions);
+
+  // Each worker combines one partition at a time, so at most `parallelism_` of them are in memory at once.
+  std::atomic<int> next_partition = 0;
+  GetThreadPool().ParallelFor(std::min(parallelism_, kPartitions), [&](int) {
+    for (int p = next_partition++; p < kPartitions; p = next_partition++) {
+      results[p] = FinalizePartition(p, std::make_shared<Batch>(std::move(in_memory[p]), partial->GetSchema()));
+    }
+  });
+
+  files_.clear();
+  return Concatenate(results);
+}
+
+std::shared_ptr<Batch> AggregationSpill::FinalizePartition(int partition,
+                                                           const std::shared_ptr<Batch>& in_memory) const {
+  const bool can_spill = budget_ > 0 && level_ + 1 < kMaxSpillLevels;
+  std::optional<AggregationSpill> nested;
+  CompactAggregationState state(aggregation_, kSpillingCompactInitialGroups);
+  // A partition whose input fits in the budget is not spilled again even if the tables exceed it: their fixed size
+  // would not shrink in smaller partitions.
+  int64_t input_bytes = 0;
+  auto consume = [&](const std::shared_ptr<Batch>& batch) {
+    state.ConsumeFinalized(batch);
+    for (const auto& column : batch->Columns()) {
+      input_bytes += static_cast<int64_t>(column.MemoryUsage());
+    }
+    if (can_spill && input_bytes > budget_ && static_cast<int64_t>(state.MemoryUsage()) > budget_) {
+      if (!nested.has_value()) {
+        nested.emplace(aggregation_, budget_, 1, level_ + 1);
+      }
+      nested->Spill(state.Finalize());
+      state = CompactAggregationState(aggregation_, kSpillingCompactInitialGroups);
+    }
+  };
+
+  for (const File& file : files_) {
+    const int64_t row_group = file.row_groups[partition];
+    if (row_group < 0) {
+      continue;
+    }
+    const FileReader reader(file.file.Path().string());
+    consume(std::make_shared<Batch>(reader.ReadRowGroup(row_group), reader.GetSchema()));
+  }
+  consume(in_memory);
+
+  std::shared_ptr<Batch> result = state.Finalize();
+  return nested.has_value() ? nested->Finalize(result) : result;
+}
+
+}  // namespace ngn
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "src/execution/aggregation.h"
+#include "src/execution/aggregation_executor_compact.h"
+#include "src/execution/batch.h"
+#include "src/execution/spill.h"
+
+namespace ngn {
+
+// Partial results of an aggregation (results of Finalize() of its states) written to temporary files. Rows are
+// hash-partitioned by group key: every spill writes one file with one row group per partition, so a partition is later
+// read back on its own and all of its groups fit in memory even if the whole aggregation does not.
+class AggregationSpill {
+ public:
+  static constexpr int kPartitionBits = 4;
+  static constexpr int kPartitions = 1 << kPartitionBits;
+
+  // Finalize() combines up to `parallelism` partitions at a time, each within `budget` bytes. A partition that does
+  // not fit is spilled again, split by the next `kPartitionBits` bits of the key hash; `level` is the depth of that
+  // recursion.
+  AggregationSpill(std::shared_ptr<Aggregation> aggregation, int64_t budget, int parallelism = 1, int level = 0);
+  AggregationSpill(AggregationSpill&&) noexcept = default;
+  AggregationSpill& operator=(AggregationSpill&&) noexcept = default;
+
+  bool Empty() const { return files_.empty(); }
+
+  void Spill(const std::shared_ptr<Batch>& partial);
+
+  // Takes over the files of `others`.
+  void Merge(std::vector<AggregationSpill> others);
+
+  // Combines the spilled results and `partial` partition by partition and removes the files. Requires
+  // SupportsPartialAggregation().
+  std::shared_ptr<Batch> Finalize(const std::shared_ptr<Batch>& partial);
+
+ private:
+  struct File {
+    SpillFile file;
+    // Row group of every partition, -1 if the partition is empty.
+    std::vector<int64_t> row_groups;
+  };
+
+  std::shared_ptr<Batch> FinalizePartition(int partition, const std::shared_ptr<Batch>& in_memory) const;
+
+  std::shared_ptr<Aggregation> aggregation_;
+  int64_t budget_;
+  int parallelism_;
+  int level_;
+  std::vector<File> files_;
+};
+
+// Initial table size of the compact aggregation states of an aggregation with a budget. Tables start small, since the
+// fixed size of an empty table counts against the budget: one larger than the budget would spill after every batch.
+// Partitions combined at the end start small as well, since they may be small.
+inline constexpr size_t kSpillingCompactInitialGroups = size_t{1} << 10;
+
+// Initial table size of the compact aggregation state of each of `workers` pipeline copies, for an estimated `groups`
+// in total. Without a budget, a table gets room for its share of the estimate, up to kCompactAggregationInitialGroups.
+// It starts small if the estimate is unknown. Every slot of a table is zeroed up front and visited again by Merge() and
+// Finalize(), while a table that is too small only doubles a few times.
+inline size_t CompactInitialGroups(int64_t budget, std::optional<int64_t> groups, int workers) {
+  if (budget > 0 || !groups.has_value()) {
+    return kSpillingCompactInitialGroups;
+  }
+  const auto share = static_cast<size_t>((std::max<int64_t>(*groups, 1) + workers - 1) / workers);
+  return std::clamp(std::bit_ceil(share), kSpillingCompactInitialGroups, kCompactAggregationInitialGroups);
+}
+
+// Aggregation state holding at most `budget` bytes of groups (Grace hash aggregation). Once `State` grows beyond that,
+// its partial result is spilled to an AggregationSpill and a fresh State continues with the rest of the input.
+// Finalize() then combines the spilled results with those of the last State one partition at a time.
+//
+// Aggregations that do not SupportsPartialAggregation() are never spilled. Like the wrapped State, several instances
+// can consume parts of the input and be merged; `budget` is shared by the `workers` instances of one aggregation.
+template <typename State>
+class SpillingAggregationState {
+ public:
+  template <typename... Args>
+  SpillingAggregationState(int64_t budget, int workers, std::shared_ptr<Aggregation> aggregation, const Args&... args)
+      : make_state_([aggregation, args...] { return State(aggregation, args...); }),
+        budget_(budget > 0 && SupportsPartialAggregation(*aggregation) ? std::max<int64_t>(budget / workers, 1) : 0),
+        state_(make_state_()),
+        spill_(aggregation, budget_, workers) {}
+
+  // Whether some of the groups were written to disk.
+  bool Spilled() const { return !spill_.Empty(); }
+
+  void Consume(std::shared_ptr<Batch> batch) {
+    state_.Consume(std::move(batch));
+    if (budget_ > 0 && static_cast<int64_t>(state_.MemoryUsage()) > budget_) {
+      spill_.Spill(state_.Finalize());
+      state_ = make_state_();
+    }
+  }
+
+  void Merge(std::vector<SpillingAggregationState> others) {
+    std::vector<State> states;
+    std::vector<AggregationSpill> spills;
+    states.reserve(others.size());
+    spills.reserve(others.size());
+    for (auto& other : others) {
+      states.emplace_back(std::move(other.state_));
+      spills.emplace_back(std::move(other.spill_));
+    }
+    // Every state is within its share of the budget, so together they are within the budget.
+    state_.Merge(std::move(states));
+    spill_.Merge(std::move(spills));
+  }
+
+  std::shared_ptr<Batch> Finalize() {
+    std::shared_ptr<Batch> result = state_.Finalize();
+    return spill_.Empty() ? result : spill_.Finalize(result);
+  }
+
+ private:
+  std::function<State()> make_state_;
+  int64_t budget_;
+  State state_;
+  AggregationSpill spill_;
+};
+
+}  // namespace ngn
@@ -0,0 +1,156 @@
+#include "src/execution/aggregation_strategy.h"
+
+#include <algorithm>
+
+#include "src/execution/aggregation_executor_compact.h"
+#include "src/util/assert.h"
+
+namespace ngn {
+
+std::optional<int64_t> EstimateGroups(const AggregationStatistics& statistics) {
+  ASSERT(statistics.key_domains.size() == statistics.key_ndvs.size());
+
+  int64_t groups = 1;
+  for (size_t j = 0; j < statistics.key_ndvs.size(); ++j) {
+    std::optional<int64_t> distinct = statistics.key_ndvs[j];
+    if (const auto& domain = statistics.key_domains[j]; domain.has_value()) {
+      const auto width = static_cast<int64_t>(
+          std::min<__int128>(static_cast<__int128>(domain->max) - domain->min + 1, int64_t{1} << 62));
+      distinct = distinct.has_value() ? std::min(*distinct, width) : width;
+    }
+    if (!distinct.has_value()) {
+      return std::nullopt;
+    }
+    // Saturate well above every threshold instead of overflowing.
+    groups = static_cast<int64_t>(std::min<__int128>(static_cast<__int128>(groups) * std::max<int64_t>(*distinct, 1),
+                                                     int64_t{1} << 62));
+  }
+  return statistics.rows.has_value() ? std::min(groups, *statistics.rows) : groups;
+}
+
+AggregationStrategy ChooseAggregationStrategy(const Aggregation& aggregation, const AggregationStatistics& statistics,
+                                              int64_t compact_groups) {
+  const auto& domains = statistics.key_domains;
+  if (!domains.empty() && std::all_of(domains.begin(), domains.end(), [](const auto& d) { return d.has_value(); })) {
+    __int128 size = 1;
+    for (const auto& domain : domains) {
+      size *= static_cast<__int128>(domain->max) - domain->min + 1;
+      if (size > static_cast<__int128>(kMaxDirectAggregationGroups)) {
+        break;
+      }
+    }
+    if (size <= static_cast<__int128>(kMaxDirectAggregationGroups)) {
+      return AggregationStrategy::kDirect;
+    }
+  }
+
+  const std::optional<int64_t> groups = EstimateGroups(statistics);
+  if (groups.has_value() && *groups > compact_groups && SupportsCompactAggregation(aggregation)) {
+    return AggregationStrategy::kCompact;
+  }
+  return AggregationStrategy::kHash;
+}
+
+class AdaptiveAggregationState::Impl {
+ public:
+  Impl(std::shared_ptr<Aggregation> aggregation, const AggregationStatistics& statistics, int64_t compact_groups,
+       size_t compact_initial_groups)
+      : aggregation_(std::move(aggregation)),
+        compact_groups_(compact_groups),
+        compact_initial_groups_(compact_initial_groups),
+        strategy_(ChooseAggregationStrategy(*aggregation_, statistics, compact_groups_)) {
+    if (strategy_ == AggregationStrategy::kCompact) {
+      compact_.emplace(aggregation_, compact_initial_groups_);
+      return;
+    }
+
+    hash_.emplace(aggregation_, statistics.key_domains);
+    can_switch_ = strategy_ == AggregationStrategy::kHash && SupportsPartialAggregation(*aggregation_);
+  }
+
+  AggregationStrategy Strategy() const { return strategy_; }
+
+  void Consume(std::shared_ptr<Batch> batch) {
+    if (compact_.has_value()) {
+      compact_->Consume(std::move(batch));
+      return;
+    }
+
+    hash_->Consume(std::move(batch));
+    if (can_switch_ && static_cast<int64_t>(hash_->Groups()) > compact_groups_) {
+      SwitchToCompact();
+    }
+  }
+
+  void Merge(std::vector<AdaptiveAggregationState>& others) {
+    const bool compact = compact_.has_value() || std::any_of(others.begin(), others.end(), [](const auto& other) {
+                           return other.impl_->compact_.has_value();
+                         });
+
+    if (!compact) {
+      std::vector<AggregationState> hashes;
+      hashes.reserve(others.size());
+      for (auto& other : others) {
+        hashes.emplace_back(std::move(other.impl_->hash_.value()));
+      }
+      hash_->Merge(std::move(hashes));
+      return;
+    }
+
+    // Some of the states switched, so all of them continue as compact ones.
+    SwitchToCompact();
+    std::vector<CompactAggregationState> compacts;
+    compacts.reserve(others.size());
+    for (auto& other : others) {
+      other.impl_->SwitchToCompact();
+      compacts.emplace_back(std::move(other.impl_->compact_.value()));
+    }
+    compact_->Merge(std::move(compacts));
+  }
+
+  size_t MemoryUsage() const { return compact_.has_value() ? compact_->MemoryUsage() : hash_->MemoryUsage(); }
+
+  std::shared_ptr<Batch> Finalize() { return compact_.has_value() ? compact_->Finalize() : hash_->Finalize(); }
+
+ private:
+  void SwitchToCompact() {
+    if (compact_.has_value()) {
+      return;
+    }
+    ASSERT(can_switch_);
+    compact_.emplace(aggregation_, compact_initial_groups_);
+    compact_->ConsumeFinalized(hash_->Finalize());
+    hash_.reset();
+    strategy_ = AggregationStrategy::kCompact;
+  }
+
+  std::shared_ptr<Aggregation> aggregation_;
+  int64_t compact_groups_;
+  size_t compact_initial_groups_;
+  AggregationStrategy strategy_;
+  bool can_switch_ = false;
+
+  std::optional<AggregationState> hash_;
+  std::optional<CompactAggregationState> compact_;
+};
+
+AdaptiveAggregationState::AdaptiveAggregationState(std::shared_ptr<Aggregation> aggregation,
+                                                   const AggregationStatistics& statistics, int64_t compact_groups,
+                                                   size_t compact_initial_groups)
+    : impl_(std::make_unique<Impl>(std::move(aggregation), statistics, compact_groups, compact_initial_groups)) {}
+
+AdaptiveAggregationState::AdaptiveAggregationState(AdaptiveAggregationState&&) noexcept = default;
+AdaptiveAggregationState& AdaptiveAggregationState::operator=(AdaptiveAggregationState&&) noexcept = default;
+AdaptiveAggregationState::~AdaptiveAggregationState() = default;
+
+AggregationStrategy AdaptiveAggregationState::Strategy() const { return impl_->Strategy(); }
+
+void AdaptiveAggregationState::Consume(std::shared_ptr<Batch> batch) { impl_->Consume(std::move(batch)); }
+
+void AdaptiveAggregationState::Merge(std::vector<AdaptiveAggregationState> others) { impl_->Merge(others); }
+
+size_t AdaptiveAggregationState::MemoryUsage() const { return impl_->MemoryUsage(); }
+
+std::shared_ptr<Batch> AdaptiveAggregationState::Finalize() { return impl_->Finalize(); }
+
+}  // namespace ngn
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "src/execution/aggregation.h"
+#include "src/execution/aggregation_executor.h"
+#include "src/execution/aggregation_executor_compact.h"
+
+namespace ngn {
+
+enum class AggregationStrategy {
+  // AggregationState indexing a dense array with small integer keys.
+  kDirect,
+  // AggregationState, vectorized hash aggregation.
+  kHash,
+  // CompactAggregationState, row-major flat hash table for very many groups.
+  kCompact,
+};
+
+// What is known about the input of an aggregation before running it, e.g. from the file metadata of the scan below.
+// All numbers are upper bounds: filters between the scan and the aggregation only remove rows.
+struct AggregationStatistics {
+  std::optional<int64_t> rows;
+  // One entry per group-by key.
+  std::vector<std::optional<KeyDomain>> key_domains;
+  std::vector<std::optional<int64_t>> key_ndvs;
+};
+
+// Estimated number of groups: the product of the per-key distinct counts, capped by the number of rows. Unknown if
+// the distinct count of some key is unknown.
+std::optional<int64_t> EstimateGroups(const AggregationStatistics& statistics);
+
+// Aggregations expected to produce more groups than this use the compact strategy by default, and hash aggregations
+// switch to it once they hold more groups than this.
+inline constexpr int64_t kCompactAggregationGroups = int64_t{1} << 23;
+
+AggregationStrategy ChooseAggregationStrategy(const Aggregation& aggregation, const AggregationStatistics& statistics,
+                                              int64_t compact_groups = kCompactAggregationGroups);
+
+// Aggregation state picking its strategy from the statistics. If a hash aggregation ends up with more than
+// `compact_groups` groups after all, because the estimate was missing or too low, it moves its groups into a compact
+// table mid-stream. That is not possible with DISTINCT aggregations, whose partial results cannot be combined.
+// Compact tables, chosen up front or switched to, start with room for `compact_initial_groups` groups.
+//
+// Like AggregationState, several instances can consume parts of the input and be merged.
+class AdaptiveAggregationState {
+ public:
+  AdaptiveAggregationState(std::shared_ptr<Aggregation> aggregation, const AggregationStatistics& statistics,
+                           int64_t compact_groups = kCompactAggregationGroups,
+                           size_t compact_initial_groups = kCompactAggregationInitialGroups);
+  AdaptiveAggregationState(AdaptiveAggregationState&&) noexcept;
+  AdaptiveAggregationState& operator=(AdaptiveAggregationState&&) noexcept;
+  ~AdaptiveAggregationState();
+
+  AggregationStrategy Strategy() const;
+
+  void Consume(std::shared_ptr<Batch> batch);
+
+  void Merge(std::vector<AdaptiveAggregationState> others);
+
+  // Approximate number of bytes held by the groups and their aggregates.
+  size_t MemoryUsage() const;
+
+  std::shared_ptr<Batch> Finalize();
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace ngn
@@ -1,6 +1,11 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
 
 #include "src/core/column.h"
 #include "src/core/schema.h"
@@ -33,18 +38,89 @@ class Batch {
   const Schema& GetSchema() const { return schema_; }
   const std::vector<Column>& Columns() const { return columns_; }
 
-  Column ColumnByName(const std::string& name) const {
+  size_t ColumnIndex(const std::string& name) const {
     const auto& fields = schema_.Fields();
     auto iter = std::find_if(fields.begin(), fields.end(), [&name](const Field& field) { return field.name == name; });
     ASSERT_WITH_MESSAGE(iter != fields.end(), "Column '" + name + "' is not found in batch");
-    size_t index = iter - fields.begin();
-    return columns_[index];
+    return iter - fields.begin();
   }
 
+  const Column& ColumnByName(const std::string& name) const { return columns_[ColumnIndex(name)]; }
+
  private:
   std::vector<Column> columns_;
   Schema schema_;
   int64_t row_count_;
 };
 
+// Rows `selection` (increasing) of `column`. Dictionary-encoded strings keep their dictionary.
+inline Column SelectRows(const Column& column, const std::vector<int32_t>& selection) {
+  return std::visit(
+      [&]<Type type>(const ArrayType<type>& source) {
+        if constexpr (type == Type::kString) {
+          if (source.IsDictionaryEncoded()) {
+            std::vector<int32_t> codes;
+            codes.reserve(selection.size());
+            for (int32_t row : selection) {
+              codes.push_back(source.Codes()[row]);
+            }
+            return Column(ArrayType<type>(source.Dictionary(), std::move(codes)));
+          }
+        }
+        ArrayType<type> selected;
+        selected.reserve(selection.size());
+        for (int32_t row : selection) {
+          selected.emplace_back(source[row]);
+        }
+        return Column(std::move(selected));
+      },
+      column.Values());
+}
+
+// A batch together with the rows of it that passed the filters so far: all of them without a selection, otherwise
+// only the listed ones. Filters pass the selection on instead of copying the rows out, so stacked filters do not copy
+// every surviving value again, and projections copy out only the columns they read.
+struct SelectedBatch {
+  std::shared_ptr<Batch> batch;
+  // Selected rows in increasing order.
+  std::optional<std::vector<int32_t>> selection;
+
+  int64_t Rows() const { return selection.has_value() ? static_cast<int64_t>(selection->size()) : batch->Rows(); }
+
+  // The selected rows as a batch of their own.
+  std::shared_ptr<Batch> Materialize() const {
+    if (!selection.has_value()) {
+      return batch;
+    }
+    if (batch->Columns().empty()) {
+      return std::make_shared<Batch>(Rows(), batch->GetSchema());
+    }
+    std::vector<Column> columns;
+    columns.reserve(batch->Columns().size());
+    for (const auto& column : batch->Columns()) {
+      columns.push_back(SelectRows(column, *selection));
+    }
+    return std::make_shared<Batch>(std::move(columns), batch->GetSchema());
+  }
+
+  // The selected rows of the columns `names` only. Expressions reading just these columns are evaluated on it, so that
+  // they skip the rows dropped by earlier filters.
+  std::shared_ptr<Batch> Materialize(const std::vector<std::string>& names) const {
+    std::vector<Column> columns;
+    std::vector<Field> fields;
+    columns.reserve(names.size());
+    fields.reserve(names.size());
+    for (const auto& name : names) {
+      const size_t index = batch->ColumnIndex(name);
+      const Column& column = batch->Columns()[index];
+      columns.push_back(selection.has_value() ? SelectRows(column, *selection) : column);
+      fields.push_back(batch->GetSchema().Fields()[index]);
+    }
+    if (columns.empty()) {
+      return std::make_shared<Batch>(Rows(), Schema(std::move(fields)));
+    }
+    return std::make_shared<Batch>(std::move(columns), Schema(std::move(fields)));
+  }
+};
+
 }  // namespace ngn
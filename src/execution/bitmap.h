@@ -0,0 +1,122 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+#include "src/core/type.h"
+#include "src/util/assert.h"
+
+namespace ngn {
+
+// Bit-packed booleans: row i is bit i % 64 of word i / 64. Bits past Size() in the last word are always zero, so
+// whole words can be combined and counted without masking.
+class Bitmap {
+ public:
+  static constexpr size_t kWordBits = 64;
+
+  Bitmap() = default;
+
+  explicit Bitmap(size_t size, bool value = false)
+      : size_(size), words_(WordCount(size), value ? ~uint64_t{0} : uint64_t{0}) {
+    ClearTail();
+  }
+
+  explicit Bitmap(const ArrayType<Type::kBool>& values) : Bitmap(values.size()) {
+    for (size_t i = 0; i < values.size(); ++i) {
+      words_[i / kWordBits] |= static_cast<uint64_t>(values[i].value) << (i % kWordBits);
+    }
+  }
+
+  static size_t WordCount(size_t size) { return (size + kWordBits - 1) / kWordBits; }
+
+  size_t Size() const { return size_; }
+
+  bool Get(size_t i) const { return (words_[i / kWordBits] >> (i % kWordBits)) & 1; }
+
+  // Word `w` holds rows [64 * w, 64 * w + 64). Writers must keep the bits past Size() zero.
+  uint64_t* Words() { return words_.data(); }
+  const uint64_t* Words() const { return words_.data(); }
+
+  Bitmap& operator&=(const Bitmap& other) {
+    ASSERT(size_ == other.size_);
+    for (size_t w = 0; w < words_.size(); ++w) {
+      words_[w] &= other.words_[w];
+    }
+    return *this;
+  }
+
+  Bitmap& operator|=(const Bitmap& other) {
+    ASSERT(size_ == other.size_);
+    for (size_t w = 0; w < words_.size(); ++w) {
+      words_[w] |= other.words_[w];
+    }
+    return *this;
+  }
+
+  Bitmap& Flip() {
+    for (auto& word : words_) {
+      word = ~word;
+    }
+    ClearTail();
+    return *this;
+  }
+
+  bool Any() const {
+    return std::any_of(words_.begin(), words_.end(), [](uint64_t word) { return word != 0; });
+  }
+
+  size_t CountSet() const {
+    size_t count = 0;
+    for (uint64_t word : words_) {
+      count += std::popcount(word);
+    }
+    return count;
+  }
+
+  // Rows whose bit is set, in increasing order.
+  std::vector<int32_t> SetRows() const {
+    std::vector<int32_t> rows;
+    rows.reserve(CountSet());
+    for (size_t w = 0; w < words_.size(); ++w) {
+      for (uint64_t word = words_[w]; word != 0; word &= word - 1) {
+        rows.push_back(static_cast<int32_t>(w * kWordBits + std::countr_zero(word)));
+      }
+    }
+    return rows;
+  }
+
+  // For a bitmap over the rows `selection` lists: the entries of `selection` whose bit is set.
+  std::vector<int32_t> SetRows(const std::vector<int32_t>& selection) const {
+    ASSERT(selection.size() == size_);
+    std::vector<int32_t> rows;
+    rows.reserve(CountSet());
+    for (size_t w = 0; w < words_.size(); ++w) {
+      for (uint64_t word = words_[w]; word != 0; word &= word - 1) {
+        rows.push_back(selection[w * kWordBits + std::countr_zero(word)]);
+      }
+    }
+    return rows;
+  }
+
+  ArrayType<Type::kBool> ToBooleans() const {
+    ArrayType<Type::kBool> result(size_);
+    for (size_t i = 0; i < size_; ++i) {
+      result[i] = Boolean{Get(i)};
+    }
+    return result;
+  }
+
+ private:
+  void ClearTail() {
+    if (size_ % kWordBits != 0) {
+      words_.back() &= (uint64_t{1} << (size_ % kWordBits)) - 1;
+    }
+  }
+
+  size_t size_ = 0;
+  std::vector<uint64_t> words_;
+};
+
+}  // namespace ngn
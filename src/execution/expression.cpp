@@ -1,5 +1,8 @@
 #include "src/execution/expression.h"
 
+#include <algorithm>
+#include <optional>
+
 #include "src/core/column.h"
 #include "src/execution/kernel.h"
 #include "src/util/macro.h"
@@ -25,7 +28,9 @@ Column EvaluateConst(int64_t rows, std::shared_ptr<Const> expression) {
         } else if constexpr (std::is_same_v<T, PhysicalType<Type::kInt128>>) {
           return Column(ArrayType<Type::kInt128>(rows, value));
         } else if constexpr (std::is_same_v<T, PhysicalType<Type::kString>>) {
-          return Column(ArrayType<Type::kString>(rows, value));
+          // A one-entry dictionary: string kernels then evaluate the constant once instead of once per row.
+          auto dictionary = std::make_shared<const StringArray>(StringArray{std::string_view(value)});
+          return Column(ArrayType<Type::kString>(std::move(dictionary), std::vector<int32_t>(rows, 0)));
         } else if constexpr (std::is_same_v<T, PhysicalType<Type::kChar>>) {
           return Column(ArrayType<Type::kChar>(rows, value));
         } else {
@@ -35,21 +40,23 @@ Column EvaluateConst(int64_t rows, std::shared_ptr<Const> expression) {
       expression->value.GetValue());
 }
 
+// Shares the values of the column instead of copying them.
 Column EvaluateVariable(std::shared_ptr<Batch> batch, std::shared_ptr<Variable> expression) {
-  std::string name = expression->name;
-  Type type = expression->type;
+  const auto& fields = batch->GetSchema().Fields();
+  size_t index = expression->column_index.load(std::memory_order_relaxed);
+  if (index >= fields.size() || fields[index].name != expression->name) {
+    index = batch->ColumnIndex(expression->name);
+    expression->column_index.store(index, std::memory_order_relaxed);
+  }
 
-  Column result = batch->ColumnByName(name);
-  ASSERT(result.GetType() == type);
+  const Column& result = batch->Columns()[index];
+  ASSERT(result.GetType() == expression->type);
   return result;
 }
 
-Column EvaluateBinary(std::shared_ptr<Batch> batch, std::shared_ptr<Binary> expression) {
-  Column lhs = Evaluate(batch, expression->lhs);
-  Column rhs = Evaluate(batch, expression->rhs);
-
-  BinaryFunction function = expression->function;
-
+// Operands are either both columns, or a column and a scalar.
+template <typename Lhs, typename Rhs>
+Column ApplyBinary(BinaryFunction function, const Lhs& lhs, const Rhs& rhs) {
   switch (function) {
     case BinaryFunction::kAdd:
       return Add(lhs, rhs);
@@ -80,6 +87,22 @@ Column EvaluateBinary(std::shared_ptr<Batch> batch, std::shared_ptr<Binary> expr
   }
 }
 
+// A constant operand is passed to the kernel as a scalar instead of being expanded to a column of the batch size.
+Column EvaluateBinary(std::shared_ptr<Batch> batch, std::shared_ptr<Binary> expression) {
+  const bool lhs_const = expression->lhs->expr_type == ExpressionType::kConst;
+  const bool rhs_const = expression->rhs->expr_type == ExpressionType::kConst;
+
+  if (rhs_const && !lhs_const) {
+    return ApplyBinary(expression->function, Evaluate(batch, expression->lhs),
+                       std::static_pointer_cast<Const>(expression->rhs)->value);
+  }
+  if (lhs_const && !rhs_const) {
+    return ApplyBinary(expression->function, std::static_pointer_cast<Const>(expression->lhs)->value,
+                       Evaluate(batch, expression->rhs));
+  }
+  return ApplyBinary(expression->function, Evaluate(batch, expression->lhs), Evaluate(batch, expression->rhs));
+}
+
 Column EvaluateUnary(std::shared_ptr<Batch> batch, std::shared_ptr<Unary> expression) {
   Column operand = Evaluate(batch, expression->operand);
 
@@ -102,14 +125,17 @@ Column EvaluateContains(std::shared_ptr<Batch> batch, std::shared_ptr<Contains>
   return StrContains(operand, expression->substring, expression->negated);
 }
 
-Column EvaluateIn(std::shared_ptr<Batch>, std::shared_ptr<In>) { THROW_NOT_IMPLEMENTED; }
+Column EvaluateIn(std::shared_ptr<Batch> batch, std::shared_ptr<In> expression) {
+  Column operand = Evaluate(batch, expression->operand);
+  return IsIn(operand, expression->values);
+}
 
 Column EvaluateCase(std::shared_ptr<Batch> batch, std::shared_ptr<Case> expression) {
-  Column cond_col = Evaluate(batch, expression->condition);
+  const Column cond_col = Evaluate(batch, expression->condition);
   ASSERT(cond_col.GetType() == Type::kBool);
 
-  Column then_col = Evaluate(batch, expression->then_expr);
-  Column else_col = Evaluate(batch, expression->else_expr);
+  const Column then_col = Evaluate(batch, expression->then_expr);
+  const Column else_col = Evaluate(batch, expression->else_expr);
   ASSERT(then_col.GetType() == else_col.GetType());
 
   const auto& cond_values = std::get<ArrayType<Type::kBool>>(cond_col.Values());
@@ -119,9 +145,10 @@ Column EvaluateCase(std::shared_ptr<Batch> batch, std::shared_ptr<Case> expressi
         const auto& then_values = std::get<ArrayType<type>>(then_col.Values());
         const auto& else_values = std::get<ArrayType<type>>(else_col.Values());
 
-        ArrayType<type> result(cond_values.size());
+        ArrayType<type> result;
+        result.reserve(cond_values.size());
         for (size_t i = 0; i < cond_values.size(); ++i) {
-          result[i] = cond_values[i].value ? then_values[i] : else_values[i];
+          result.emplace_back(cond_values[i].value ? then_values[i] : else_values[i]);
         }
         return Column(std::move(result));
       },
@@ -133,8 +160,98 @@ Column EvaluateRegexReplace(std::shared_ptr<Batch> batch, std::shared_ptr<RegexR
   return StrRegexReplace(operand, expression->pattern, expression->replacement);
 }
 
+std::optional<Comparison> ToComparison(BinaryFunction function) {
+  switch (function) {
+    case BinaryFunction::kLess:
+      return Comparison::kLess;
+    case BinaryFunction::kGreater:
+      return Comparison::kGreater;
+    case BinaryFunction::kEqual:
+      return Comparison::kEqual;
+    case BinaryFunction::kNotEqual:
+      return Comparison::kNotEqual;
+    case BinaryFunction::kLessOrEqual:
+      return Comparison::kLessOrEqual;
+    case BinaryFunction::kGreaterOrEqual:
+      return Comparison::kGreaterOrEqual;
+    default:
+      return std::nullopt;
+  }
+}
+
+// The comparison with the operands swapped: `c < x` is `x > c`.
+Comparison Mirror(Comparison comparison) {
+  switch (comparison) {
+    case Comparison::kLess:
+      return Comparison::kGreater;
+    case Comparison::kGreater:
+      return Comparison::kLess;
+    case Comparison::kLessOrEqual:
+      return Comparison::kGreaterOrEqual;
+    case Comparison::kGreaterOrEqual:
+      return Comparison::kLessOrEqual;
+    default:
+      return comparison;
+  }
+}
+
+std::optional<Bitmap> EvaluateBinaryPredicate(std::shared_ptr<Batch> batch, std::shared_ptr<Binary> expression) {
+  if (expression->function == BinaryFunction::kAnd || expression->function == BinaryFunction::kOr) {
+    Bitmap result = EvaluatePredicate(batch, expression->lhs);
+    // The other operand cannot change the result.
+    const bool decided = expression->function == BinaryFunction::kAnd
+                             ? !result.Any()
+                             : result.CountSet() == static_cast<size_t>(batch->Rows());
+    if (decided) {
+      return result;
+    }
+    const Bitmap rhs = EvaluatePredicate(batch, expression->rhs);
+    if (expression->function == BinaryFunction::kAnd) {
+      result &= rhs;
+    } else {
+      result |= rhs;
+    }
+    return result;
+  }
+
+  const std::optional<Comparison> comparison = ToComparison(expression->function);
+  if (!comparison.has_value()) {
+    return std::nullopt;
+  }
+  const bool lhs_const = expression->lhs->expr_type == ExpressionType::kConst;
+  const bool rhs_const = expression->rhs->expr_type == ExpressionType::kConst;
+  if (rhs_const && !lhs_const) {
+    return CompareToBitmap(*comparison, Evaluate(batch, expression->lhs),
+                           std::static_pointer_cast<Const>(expression->rhs)->value);
+  }
+  if (lhs_const && !rhs_const) {
+    return CompareToBitmap(Mirror(*comparison), Evaluate(batch, expression->rhs),
+                           std::static_pointer_cast<Const>(expression->lhs)->value);
+  }
+  return CompareToBitmap(*comparison, Evaluate(batch, expression->lhs), Evaluate(batch, expression->rhs));
+}
+
 }  // namespace
 
+Bitmap EvaluatePredicate(std::shared_ptr<Batch> batch, std::shared_ptr<Expression> expression) {
+  if (expression->expr_type == ExpressionType::kBinary) {
+    if (auto result = EvaluateBinaryPredicate(batch, std::static_pointer_cast<Binary>(expression))) {
+      return std::move(*result);
+    }
+  }
+  if (expression->expr_type == ExpressionType::kUnary) {
+    auto unary = std::static_pointer_cast<Unary>(expression);
+    if (unary->function == UnaryFunction::kNot) {
+      return EvaluatePredicate(batch, unary->operand).Flip();
+    }
+  }
+  if (expression->expr_type == ExpressionType::kContains) {
+    auto contains = std::static_pointer_cast<Contains>(expression);
+    return StrContainsToBitmap(Evaluate(batch, contains->operand), contains->substring, contains->negated);
+  }
+  return ToBitmap(Evaluate(batch, expression));
+}
+
 Column Evaluate(std::shared_ptr<Batch> batch, std::shared_ptr<Expression> expression) {
   switch (expression->expr_type) {
     case ExpressionType::kConst:
@@ -158,4 +275,39 @@ Column Evaluate(std::shared_ptr<Batch> batch, std::shared_ptr<Expression> expres
   }
 }
 
+void CollectReferencedColumns(const std::shared_ptr<Expression>& expression, std::vector<std::string>& names) {
+  switch (expression->expr_type) {
+    case ExpressionType::kConst:
+      return;
+    case ExpressionType::kVariable: {
+      const std::string& name = std::static_pointer_cast<Variable>(expression)->name;
+      if (std::find(names.begin(), names.end(), name) == names.end()) {
+        names.push_back(name);
+      }
+      return;
+    }
+    case ExpressionType::kUnary:
+      return CollectReferencedColumns(std::static_pointer_cast<Unary>(expression)->operand, names);
+    case ExpressionType::kBinary: {
+      auto binary = std::static_pointer_cast<Binary>(expression);
+      CollectReferencedColumns(binary->lhs, names);
+      return CollectReferencedColumns(binary->rhs, names);
+    }
+    case ExpressionType::kContains:
+      return CollectReferencedColumns(std::static_pointer_cast<Contains>(expression)->operand, names);
+    case ExpressionType::kIn:
+      return CollectReferencedColumns(std::static_pointer_cast<In>(expression)->operand, names);
+    case ExpressionType::kCase: {
+      auto case_expression = std::static_pointer_cast<Case>(expression);
+      CollectReferencedColumns(case_expression->condition, names);
+      CollectReferencedColumns(case_expression->then_expr, names);
+      return CollectReferencedColumns(case_expression->else_expr, names);
+    }
+    case ExpressionType::kRegexReplace:
+      return CollectReferencedColumns(std::static_pointer_cast<RegexReplace>(expression)->operand, names);
+    default:
+      THROW_NOT_IMPLEMENTED;
+  }
+}
+
 }  // namespace ngn
@@ -1,11 +1,15 @@
 #pragma once
 
+#include <atomic>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "src/core/column.h"
 #include "src/core/type.h"
 #include "src/core/value.h"
 #include "src/execution/batch.h"
+#include "src/execution/bitmap.h"
 
 namespace ngn {
 
@@ -40,6 +44,10 @@ struct Variable : public Expression {
 
   std::string name;
   Type type;
+
+  // Index of the column in the last batch the variable was evaluated on. The batches of a stream share their schema,
+  // so checking the name at this index usually replaces the lookup by name.
+  mutable std::atomic<size_t> column_index = 0;
 };
 
 enum class UnaryFunction {
@@ -159,4 +167,11 @@ inline std::shared_ptr<RegexReplace> MakeRegexReplace(std::shared_ptr<Expression
 
 Column Evaluate(std::shared_ptr<Batch> batch, std::shared_ptr<Expression> expression);
 
+// Evaluates a boolean expression to a bitmap. Comparisons and substring searches produce bitmaps directly, and
+// AND/OR/NOT combine them word by word; other expressions are evaluated to a column first.
+Bitmap EvaluatePredicate(std::shared_ptr<Batch> batch, std::shared_ptr<Expression> expression);
+
+// Appends the names of the columns `expression` reads to `names`, skipping those already in it.
+void CollectReferencedColumns(const std::shared_ptr<Expression>& expression, std::vector<std::string>& names);
+
 }  // namespace ngn
@@ -1,13 +1,19 @@
 #include "src/execution/kernel.h"
 
+#include <algorithm>
 #include <functional>
+#include <iterator>
 #include <limits>
 #include <regex>
+#include <string_view>
+#include <type_traits>
+#include <vector>
 
 #include "simde/x86/avx2.h"
 #include "simde/x86/avx512.h"
 #include "simde/x86/sse2.h"
 #include "src/core/type.h"
+#include "src/execution/string_search.h"
 #include "src/util/assert.h"
 #include "src/util/macro.h"
 
@@ -18,25 +24,25 @@ namespace internal {
 template <Type type>
 PhysicalType<type> Min(const ArrayType<type>& arr) {
   ASSERT(!arr.empty());
-  PhysicalType<type> best = arr[0];
+  auto best = arr[0];
   for (size_t i = 1; i < arr.size(); ++i) {
     if (arr[i] < best) {
       best = arr[i];
     }
   }
-  return best;
+  return PhysicalType<type>(best);
 }
 
 template <Type type>
 PhysicalType<type> Max(const ArrayType<type>& arr) {
   ASSERT(!arr.empty());
-  PhysicalType<type> best = arr[0];
+  auto best = arr[0];
   for (size_t i = 1; i < arr.size(); ++i) {
     if (arr[i] > best) {
       best = arr[i];
     }
   }
-  return best;
+  return PhysicalType<type>(best);
 }
 
 template <Type type>
@@ -118,10 +124,44 @@ ArrayType<Type::kInt128> Div(const ArrayType<Type::kInt64>& lhs, const ArrayType
   return result;
 }
 
+// Evaluates `predicate` once per dictionary entry and maps the results over the codes.
+template <typename Predicate>
+ArrayType<Type::kBool> MapDictionaryPredicate(const StringArray& values, Predicate&& predicate) {
+  const StringArray& dictionary = *values.Dictionary();
+  std::vector<uint8_t> matches(dictionary.size());
+  for (size_t i = 0; i < dictionary.size(); ++i) {
+    matches[i] = predicate(dictionary[i]);
+  }
+
+  const auto& codes = values.Codes();
+  ArrayType<Type::kBool> result(codes.size());
+  for (size_t i = 0; i < codes.size(); ++i) {
+    result[i] = Boolean{matches[codes[i]] != 0};
+  }
+  return result;
+}
+
+// A dictionary with a single entry means that all values are equal (e.g. an evaluated string constant).
+inline const StringArray* SingleEntryDictionary(const StringArray& values) {
+  if (values.IsDictionaryEncoded() && values.Dictionary()->size() == 1) {
+    return values.Dictionary().get();
+  }
+  return nullptr;
+}
+
 template <Type type, typename Comparator>
 ArrayType<Type::kBool> Compare(const ArrayType<type>& lhs, const ArrayType<type>& rhs) {
   ASSERT(lhs.size() == rhs.size());
 
+  if constexpr (type == Type::kString) {
+    if (const StringArray* constant = SingleEntryDictionary(rhs); constant != nullptr && lhs.IsDictionaryEncoded()) {
+      return MapDictionaryPredicate(lhs, [value = (*constant)[0]](std::string_view v) { return Comparator{}(v, value); });
+    }
+    if (const StringArray* constant = SingleEntryDictionary(lhs); constant != nullptr && rhs.IsDictionaryEncoded()) {
+      return MapDictionaryPredicate(rhs, [value = (*constant)[0]](std::string_view v) { return Comparator{}(value, v); });
+    }
+  }
+
   ArrayType<Type::kBool> result(lhs.size());
   for (size_t i = 0; i < lhs.size(); ++i) {
     result[i] = Boolean{Comparator{}(lhs[i], rhs[i])};
@@ -151,32 +191,255 @@ ArrayType<Type::kBool> Or(const ArrayType<Type::kBool>& lhs, const ArrayType<Typ
 
 template <Type type>
 ArrayType<Type::kBool> NotEqual(const ArrayType<type>& lhs, const ArrayType<type>& rhs) {
-  return Compare<type, std::not_equal_to<PhysicalType<type>>>(lhs, rhs);
+  return Compare<type, std::not_equal_to<>>(lhs, rhs);
 }
 
 template <Type type>
 ArrayType<Type::kBool> Equal(const ArrayType<type>& lhs, const ArrayType<type>& rhs) {
-  return Compare<type, std::equal_to<PhysicalType<type>>>(lhs, rhs);
+  return Compare<type, std::equal_to<>>(lhs, rhs);
 }
 
 template <Type type>
 ArrayType<Type::kBool> Less(const ArrayType<type>& lhs, const ArrayType<type>& rhs) {
-  return Compare<type, std::less<PhysicalType<type>>>(lhs, rhs);
+  return Compare<type, std::less<>>(lhs, rhs);
 }
 
 template <Type type>
 ArrayType<Type::kBool> LessOrEqual(const ArrayType<type>& lhs, const ArrayType<type>& rhs) {
-  return Compare<type, std::less_equal<PhysicalType<type>>>(lhs, rhs);
+  return Compare<type, std::less_equal<>>(lhs, rhs);
 }
 
 template <Type type>
 ArrayType<Type::kBool> Greater(const ArrayType<type>& lhs, const ArrayType<type>& rhs) {
-  return Compare<type, std::greater<PhysicalType<type>>>(lhs, rhs);
+  return Compare<type, std::greater<>>(lhs, rhs);
 }
 
 template <Type type>
 ArrayType<Type::kBool> GreaterOrEqual(const ArrayType<type>& lhs, const ArrayType<type>& rhs) {
-  return Compare<type, std::greater_equal<PhysicalType<type>>>(lhs, rhs);
+  return Compare<type, std::greater_equal<>>(lhs, rhs);
+}
+
+// Applies `operation` to every value, e.g. a binary operation whose other operand is a scalar.
+template <Type output, Type input, typename Operation>
+ArrayType<output> Map(const ArrayType<input>& values, Operation&& operation) {
+  ArrayType<output> result(values.size());
+  for (size_t i = 0; i < values.size(); ++i) {
+    result[i] = operation(values[i]);
+  }
+  return result;
+}
+
+template <Type type, typename Predicate>
+ArrayType<Type::kBool> MapPredicate(const ArrayType<type>& values, Predicate&& predicate) {
+  if constexpr (type == Type::kString) {
+    if (values.IsDictionaryEncoded()) {
+      return MapDictionaryPredicate(values, predicate);
+    }
+  }
+
+  ArrayType<Type::kBool> result(values.size());
+  for (size_t i = 0; i < values.size(); ++i) {
+    result[i] = Boolean{predicate(values[i])};
+  }
+  return result;
+}
+
+// `operation(value, scalar)` for every value of an integer column.
+template <typename Operation>
+Column ArithmeticScalar(const Column& column, const Value& scalar, Operation&& operation) {
+  ASSERT(column.GetType() == scalar.GetType());
+
+  return Dispatch(
+      [&]<Type type>(Tag<type>) -> Column {
+        if constexpr (type == Type::kInt16 || type == Type::kInt32 || type == Type::kInt64 || type == Type::kInt128) {
+          const auto value = std::get<PhysicalType<type>>(scalar.GetValue());
+          return Column(Map<type>(std::get<ArrayType<type>>(column.Values()),
+                                  [&](PhysicalType<type> v) { return operation(v, value); }));
+        } else {
+          THROW_NOT_IMPLEMENTED;
+        }
+      },
+      column.GetType());
+}
+
+template <typename Comparator>
+Column CompareScalar(const Column& lhs, const Value& rhs) {
+  ASSERT(lhs.GetType() == rhs.GetType());
+
+  return Column(Dispatch(
+      [&]<Type type>(Tag<type>) {
+        const auto& values = std::get<ArrayType<type>>(lhs.Values());
+        if constexpr (type == Type::kString) {
+          const std::string_view value = std::get<PhysicalType<type>>(rhs.GetValue());
+          return MapPredicate(values, [value](std::string_view v) { return Comparator{}(v, value); });
+        } else {
+          const auto value = std::get<PhysicalType<type>>(rhs.GetValue());
+          return MapPredicate(values, [value](const PhysicalType<type>& v) { return Comparator{}(v, value); });
+        }
+      },
+      lhs.GetType()));
+}
+
+// The comparisons done with vector instructions. The others are their negations.
+enum class VectorComparison {
+  kEqual,
+  kGreater,
+  kLess,
+};
+
+template <typename T>
+simde__m256i LoadVector(const T* values) {
+  return simde_mm256_loadu_si256(reinterpret_cast<const simde__m256i*>(values));
+}
+
+template <typename T>
+simde__m256i BroadcastVector(T value) {
+  if constexpr (sizeof(T) == 1) {
+    return simde_mm256_set1_epi8(value);
+  } else if constexpr (sizeof(T) == 2) {
+    return simde_mm256_set1_epi16(value);
+  } else if constexpr (sizeof(T) == 4) {
+    return simde_mm256_set1_epi32(value);
+  } else {
+    return simde_mm256_set1_epi64x(value);
+  }
+}
+
+// Lanes of the result are all ones where the comparison holds.
+template <typename T, VectorComparison comparison>
+simde__m256i CompareVectors(simde__m256i lhs, simde__m256i rhs) {
+  if constexpr (comparison == VectorComparison::kLess) {
+    return CompareVectors<T, VectorComparison::kGreater>(rhs, lhs);
+  } else if constexpr (comparison == VectorComparison::kEqual) {
+    if constexpr (sizeof(T) == 1) {
+      return simde_mm256_cmpeq_epi8(lhs, rhs);
+    } else if constexpr (sizeof(T) == 2) {
+      return simde_mm256_cmpeq_epi16(lhs, rhs);
+    } else if constexpr (sizeof(T) == 4) {
+      return simde_mm256_cmpeq_epi32(lhs, rhs);
+    } else {
+      return simde_mm256_cmpeq_epi64(lhs, rhs);
+    }
+  } else {
+    if constexpr (sizeof(T) == 1) {
+      return simde_mm256_cmpgt_epi8(lhs, rhs);
+    } else if constexpr (sizeof(T) == 2) {
+      return simde_mm256_cmpgt_epi16(lhs, rhs);
+    } else if constexpr (sizeof(T) == 4) {
+      return simde_mm256_cmpgt_epi32(lhs, rhs);
+    } else {
+      return simde_mm256_cmpgt_epi64(lhs, rhs);
+    }
+  }
+}
+
+// Results of comparing 64 values of `lhs` with `rhs`, or with `scalar` if `kBroadcast`, as the bits of a word.
+template <typename T, VectorComparison comparison, bool kBroadcast>
+uint64_t CompareWord(const T* lhs, const T* rhs, simde__m256i scalar) {
+  constexpr size_t kLanes = sizeof(simde__m256i) / sizeof(T);
+  auto compare = [&](size_t i) {
+    if constexpr (kBroadcast) {
+      return CompareVectors<T, comparison>(LoadVector(lhs + i), scalar);
+    } else {
+      return CompareVectors<T, comparison>(LoadVector(lhs + i), LoadVector(rhs + i));
+    }
+  };
+
+  uint64_t word = 0;
+  for (size_t i = 0; i < Bitmap::kWordBits; i += kLanes) {
+    if constexpr (sizeof(T) == 1) {
+      word |= static_cast<uint64_t>(static_cast<uint32_t>(simde_mm256_movemask_epi8(compare(i)))) << i;
+    } else if constexpr (sizeof(T) == 2) {
+      // Narrow two results to bytes. packs works within 128-bit halves, so the halves are put back in order.
+      const simde__m256i packed = simde_mm256_packs_epi16(compare(i), compare(i + kLanes));
+      const simde__m256i ordered = simde_mm256_permute4x64_epi64(packed, 0xD8);
+      word |= static_cast<uint64_t>(static_cast<uint32_t>(simde_mm256_movemask_epi8(ordered))) << i;
+      i += kLanes;
+    } else if constexpr (sizeof(T) == 4) {
+      word |= static_cast<uint64_t>(simde_mm256_movemask_ps(simde_mm256_castsi256_ps(compare(i)))) << i;
+    } else {
+      word |= static_cast<uint64_t>(simde_mm256_movemask_pd(simde_mm256_castsi256_pd(compare(i)))) << i;
+    }
+  }
+  return word;
+}
+
+template <typename T, VectorComparison comparison, bool kBroadcast>
+Bitmap CompareWords(const T* lhs, const T* rhs, T scalar, size_t size, bool negated) {
+  Bitmap result(size);
+  uint64_t* words = result.Words();
+  const simde__m256i scalar_vector = BroadcastVector(scalar);
+
+  const size_t full_words = size / Bitmap::kWordBits;
+  for (size_t w = 0; w < full_words; ++w) {
+    const size_t offset = w * Bitmap::kWordBits;
+    const T* rhs_word = kBroadcast ? nullptr : rhs + offset;
+    const uint64_t word = CompareWord<T, comparison, kBroadcast>(lhs + offset, rhs_word, scalar_vector);
+    words[w] = negated ? ~word : word;
+  }
+
+  for (size_t i = full_words * Bitmap::kWordBits; i < size; ++i) {
+    T value = scalar;
+    if constexpr (!kBroadcast) {
+      value = rhs[i];
+    }
+    bool matches = false;
+    if constexpr (comparison == VectorComparison::kEqual) {
+      matches = lhs[i] == value;
+    } else if constexpr (comparison == VectorComparison::kGreater) {
+      matches = lhs[i] > value;
+    } else {
+      matches = lhs[i] < value;
+    }
+    words[full_words] |= static_cast<uint64_t>(matches != negated) << (i % Bitmap::kWordBits);
+  }
+  return result;
+}
+
+// Element type of the vector comparisons of `type`, or void if its values are not compared as vectors. Dates and
+// timestamps are compared as their int64 values; char only if it is signed, as the vector comparisons are.
+template <Type type>
+auto VectorElement() {
+  if constexpr (type == Type::kInt16 || type == Type::kInt32 || type == Type::kInt64) {
+    return PhysicalType<type>{};
+  } else if constexpr (type == Type::kDate || type == Type::kTimestamp) {
+    static_assert(sizeof(PhysicalType<type>) == sizeof(int64_t));
+    return int64_t{};
+  } else if constexpr (type == Type::kChar && std::is_signed_v<char>) {
+    return char{};
+  }
+}
+
+template <Type type>
+using VectorElementType = decltype(VectorElement<type>());
+
+template <typename T, VectorComparison comparison>
+Bitmap CompareToBitmap(const T* lhs, const T* rhs, T scalar, size_t size, bool negated) {
+  if (rhs == nullptr) {
+    return CompareWords<T, comparison, true>(lhs, rhs, scalar, size, negated);
+  }
+  return CompareWords<T, comparison, false>(lhs, rhs, scalar, size, negated);
+}
+
+// Compares `lhs` with `rhs`, or with `scalar` if `rhs` is nullptr.
+template <typename T>
+Bitmap CompareValuesToBitmap(Comparison comparison, const T* lhs, const T* rhs, T scalar, size_t size) {
+  switch (comparison) {
+    case Comparison::kEqual:
+      return CompareToBitmap<T, VectorComparison::kEqual>(lhs, rhs, scalar, size, false);
+    case Comparison::kNotEqual:
+      return CompareToBitmap<T, VectorComparison::kEqual>(lhs, rhs, scalar, size, true);
+    case Comparison::kGreater:
+      return CompareToBitmap<T, VectorComparison::kGreater>(lhs, rhs, scalar, size, false);
+    case Comparison::kLessOrEqual:
+      return CompareToBitmap<T, VectorComparison::kGreater>(lhs, rhs, scalar, size, true);
+    case Comparison::kLess:
+      return CompareToBitmap<T, VectorComparison::kLess>(lhs, rhs, scalar, size, false);
+    case Comparison::kGreaterOrEqual:
+      return CompareToBitmap<T, VectorComparison::kLess>(lhs, rhs, scalar, size, true);
+    default:
+      THROW_NOT_IMPLEMENTED;
+  }
 }
 
 }  // namespace internal
@@ -432,16 +695,210 @@ Column GreaterOrEqual(const Column& lhs, const Column& rhs) {
       lhs.GetType()));
 }
 
-Column StrContains(const Column& operand, const std::string& substring, bool negated) {
+Column Add(const Column& lhs, const Value& rhs) { return internal::ArithmeticScalar(lhs, rhs, std::plus<>{}); }
+
+Column Add(const Value& lhs, const Column& rhs) { return Add(rhs, lhs); }
+
+Column Sub(const Column& lhs, const Value& rhs) { return internal::ArithmeticScalar(lhs, rhs, std::minus<>{}); }
+
+Column Sub(const Value& lhs, const Column& rhs) {
+  return internal::ArithmeticScalar(rhs, lhs, [](auto value, auto scalar) { return scalar - value; });
+}
+
+Column Mult(const Column& lhs, const Value& rhs) { return internal::ArithmeticScalar(lhs, rhs, std::multiplies<>{}); }
+
+Column Mult(const Value& lhs, const Column& rhs) { return Mult(rhs, lhs); }
+
+Column Div(const Column& lhs, const Value& rhs) {
+  if (lhs.GetType() == Type::kInt128 && rhs.GetType() == Type::kInt64) {
+    return Div(lhs, Value(static_cast<Int128>(std::get<int64_t>(rhs.GetValue()))));
+  }
+  if (lhs.GetType() == Type::kInt64 && rhs.GetType() == Type::kInt128) {
+    const auto divisor = std::get<Int128>(rhs.GetValue());
+    return Column(internal::Map<Type::kInt128>(std::get<ArrayType<Type::kInt64>>(lhs.Values()),
+                                               [divisor](int64_t v) { return static_cast<Int128>(v) / divisor; }));
+  }
+  return internal::ArithmeticScalar(lhs, rhs, std::divides<>{});
+}
+
+Column Div(const Value& lhs, const Column& rhs) {
+  if (lhs.GetType() == Type::kInt64 && rhs.GetType() == Type::kInt128) {
+    return Div(Value(static_cast<Int128>(std::get<int64_t>(lhs.GetValue()))), rhs);
+  }
+  if (lhs.GetType() == Type::kInt128 && rhs.GetType() == Type::kInt64) {
+    const auto dividend = std::get<Int128>(lhs.GetValue());
+    return Column(internal::Map<Type::kInt128>(std::get<ArrayType<Type::kInt64>>(rhs.Values()),
+                                               [dividend](int64_t v) { return dividend / static_cast<Int128>(v); }));
+  }
+  return internal::ArithmeticScalar(rhs, lhs, [](auto value, auto scalar) { return scalar / value; });
+}
+
+// With a scalar operand the result is either the other operand, which is shared, or a constant.
+Column And(const Column& lhs, const Value& rhs) {
+  ASSERT(lhs.GetType() == Type::kBool);
+  ASSERT(rhs.GetType() == Type::kBool);
+
+  if (std::get<Boolean>(rhs.GetValue()).value) {
+    return lhs;
+  }
+  return Column(ArrayType<Type::kBool>(lhs.Size(), Boolean{false}));
+}
+
+Column And(const Value& lhs, const Column& rhs) { return And(rhs, lhs); }
+
+Column Or(const Column& lhs, const Value& rhs) {
+  ASSERT(lhs.GetType() == Type::kBool);
+  ASSERT(rhs.GetType() == Type::kBool);
+
+  if (std::get<Boolean>(rhs.GetValue()).value) {
+    return Column(ArrayType<Type::kBool>(lhs.Size(), Boolean{true}));
+  }
+  return lhs;
+}
+
+Column Or(const Value& lhs, const Column& rhs) { return Or(rhs, lhs); }
+
+Column Less(const Column& lhs, const Value& rhs) { return internal::CompareScalar<std::less<>>(lhs, rhs); }
+
+Column Less(const Value& lhs, const Column& rhs) { return Greater(rhs, lhs); }
+
+Column Greater(const Column& lhs, const Value& rhs) { return internal::CompareScalar<std::greater<>>(lhs, rhs); }
+
+Column Greater(const Value& lhs, const Column& rhs) { return Less(rhs, lhs); }
+
+Column Equal(const Column& lhs, const Value& rhs) { return internal::CompareScalar<std::equal_to<>>(lhs, rhs); }
+
+Column Equal(const Value& lhs, const Column& rhs) { return Equal(rhs, lhs); }
+
+Column NotEqual(const Column& lhs, const Value& rhs) { return internal::CompareScalar<std::not_equal_to<>>(lhs, rhs); }
+
+Column NotEqual(const Value& lhs, const Column& rhs) { return NotEqual(rhs, lhs); }
+
+Column LessOrEqual(const Column& lhs, const Value& rhs) { return internal::CompareScalar<std::less_equal<>>(lhs, rhs); }
+
+Column LessOrEqual(const Value& lhs, const Column& rhs) { return GreaterOrEqual(rhs, lhs); }
+
+Column GreaterOrEqual(const Column& lhs, const Value& rhs) {
+  return internal::CompareScalar<std::greater_equal<>>(lhs, rhs);
+}
+
+Column GreaterOrEqual(const Value& lhs, const Column& rhs) { return LessOrEqual(rhs, lhs); }
+
+namespace internal {
+
+template <typename Rhs>
+Column CompareToColumn(Comparison comparison, const Column& lhs, const Rhs& rhs) {
+  switch (comparison) {
+    case Comparison::kLess:
+      return Less(lhs, rhs);
+    case Comparison::kGreater:
+      return Greater(lhs, rhs);
+    case Comparison::kEqual:
+      return Equal(lhs, rhs);
+    case Comparison::kNotEqual:
+      return NotEqual(lhs, rhs);
+    case Comparison::kLessOrEqual:
+      return LessOrEqual(lhs, rhs);
+    case Comparison::kGreaterOrEqual:
+      return GreaterOrEqual(lhs, rhs);
+    default:
+      THROW_NOT_IMPLEMENTED;
+  }
+}
+
+template <Type type>
+const VectorElementType<type>* VectorElements(const Column& column) {
+  return reinterpret_cast<const VectorElementType<type>*>(std::get<ArrayType<type>>(column.Values()).data());
+}
+
+}  // namespace internal
+
+Bitmap CompareToBitmap(Comparison comparison, const Column& lhs, const Column& rhs) {
+  ASSERT(lhs.GetType() == rhs.GetType());
+  ASSERT(lhs.Size() == rhs.Size());
+
+  return Dispatch(
+      [&]<Type type>(Tag<type>) -> Bitmap {
+        using T = internal::VectorElementType<type>;
+        if constexpr (!std::is_void_v<T>) {
+          return internal::CompareValuesToBitmap<T>(comparison, internal::VectorElements<type>(lhs),
+                                                    internal::VectorElements<type>(rhs), T{}, lhs.Size());
+        } else {
+          return ToBitmap(internal::CompareToColumn(comparison, lhs, rhs));
+        }
+      },
+      lhs.GetType());
+}
+
+Bitmap CompareToBitmap(Comparison comparison, const Column& lhs, const Value& rhs) {
+  ASSERT(lhs.GetType() == rhs.GetType());
+
+  return Dispatch(
+      [&]<Type type>(Tag<type>) -> Bitmap {
+        using T = internal::VectorElementType<type>;
+        if constexpr (!std::is_void_v<T>) {
+          const auto& value = std::get<PhysicalType<type>>(rhs.GetValue());
+          T scalar{};
+          if constexpr (type == Type::kDate || type == Type::kTimestamp) {
+            scalar = value.value;
+          } else {
+            scalar = value;
+          }
+          return internal::CompareValuesToBitmap<T>(comparison, internal::VectorElements<type>(lhs), nullptr, scalar,
+                                                    lhs.Size());
+        } else {
+          return ToBitmap(internal::CompareToColumn(comparison, lhs, rhs));
+        }
+      },
+      lhs.GetType());
+}
+
+Bitmap ToBitmap(const Column& operand) {
+  ASSERT(operand.GetType() == Type::kBool);
+  return Bitmap(std::get<ArrayType<Type::kBool>>(operand.Values()));
+}
+
+Bitmap StrContainsToBitmap(const Column& operand, const std::string& substring, bool negated) {
   ASSERT(operand.GetType() == Type::kString);
-  const auto& values = std::get<ArrayType<Type::kString>>(operand.Values());
 
-  ArrayType<Type::kBool> result(values.size());
-  for (size_t i = 0; i < values.size(); ++i) {
-    bool found = values[i].find(substring) != std::string::npos;
-    result[i] = Boolean{negated ? !found : found};
+  Bitmap result = FindRowsContaining(std::get<ArrayType<Type::kString>>(operand.Values()), substring);
+  if (negated) {
+    result.Flip();
   }
-  return Column(std::move(result));
+  return result;
+}
+
+Column StrContains(const Column& operand, const std::string& substring, bool negated) {
+  return Column(StrContainsToBitmap(operand, substring, negated).ToBooleans());
+}
+
+Column IsIn(const Column& operand, const std::vector<Value>& values) {
+  return Column(Dispatch(
+      [&]<Type type>(Tag<type>) {
+        std::vector<PhysicalType<type>> candidates;
+        candidates.reserve(values.size());
+        for (const auto& value : values) {
+          ASSERT(value.GetType() == type);
+          candidates.emplace_back(std::get<PhysicalType<type>>(value.GetValue()));
+        }
+        const auto contains = [&candidates](const auto& value) {
+          return std::find(candidates.begin(), candidates.end(), value) != candidates.end();
+        };
+
+        const auto& operand_values = std::get<ArrayType<type>>(operand.Values());
+        if constexpr (type == Type::kString) {
+          if (operand_values.IsDictionaryEncoded()) {
+            return internal::MapDictionaryPredicate(operand_values, contains);
+          }
+        }
+
+        ArrayType<Type::kBool> result(operand_values.size());
+        for (size_t i = 0; i < operand_values.size(); ++i) {
+          result[i] = Boolean{contains(operand_values[i])};
+        }
+        return result;
+      },
+      operand.GetType()));
 }
 
 Column Not(const Column& operand) {
@@ -478,10 +935,20 @@ Column ExtractMinute(const Column& operand) {
 Column StrLen(const Column& operand) {
   ASSERT(operand.GetType() == Type::kString);
   const auto& values = std::get<ArrayType<Type::kString>>(operand.Values());
+  if (values.IsDictionaryEncoded()) {
+    const auto& dictionary_offsets = values.Dictionary()->Offsets();
+    const auto& codes = values.Codes();
+    ArrayType<Type::kInt64> result(codes.size());
+    for (size_t i = 0; i < codes.size(); ++i) {
+      result[i] = dictionary_offsets[codes[i] + 1] - dictionary_offsets[codes[i]];
+    }
+    return Column(std::move(result));
+  }
+  const auto& offsets = values.Offsets();
 
-  ArrayType<Type::kInt64> result(values.size());
-  for (size_t i = 0; i < values.size(); ++i) {
-    result[i] = static_cast<int64_t>(values[i].size());
+  ArrayType<Type::kInt64> result(offsets.size() - 1);
+  for (size_t i = 0; i + 1 < offsets.size(); ++i) {
+    result[i] = offsets[i + 1] - offsets[i];
   }
   return Column(std::move(result));
 }
@@ -511,9 +978,13 @@ Column StrRegexReplace(const Column& operand, const std::string& pattern, const
 
   std::regex re(pattern);
 
-  ArrayType<Type::kString> result(values.size());
-  for (size_t i = 0; i < values.size(); ++i) {
-    result[i] = std::regex_replace(values[i], re, replacement);
+  ArrayType<Type::kString> result;
+  result.reserve(values.size());
+  std::string replaced;
+  for (std::string_view value : values) {
+    replaced.clear();
+    std::regex_replace(std::back_inserter(replaced), value.begin(), value.end(), re, replacement);
+    result.emplace_back(replaced);
   }
   return Column(std::move(result));
 }
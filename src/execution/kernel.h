@@ -1,10 +1,12 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include "src/core/column.h"
 #include "src/core/type.h"
 #include "src/core/value.h"
+#include "src/execution/bitmap.h"
 
 namespace ngn {
 
@@ -27,7 +29,50 @@ Column Equal(const Column& lhs, const Column& rhs);
 Column NotEqual(const Column& lhs, const Column& rhs);
 Column LessOrEqual(const Column& lhs, const Column& rhs);
 Column GreaterOrEqual(const Column& lhs, const Column& rhs);
+
+// Binary kernels with a scalar operand, which stands for a column of equal values without materializing it.
+Column Add(const Column& lhs, const Value& rhs);
+Column Add(const Value& lhs, const Column& rhs);
+Column Sub(const Column& lhs, const Value& rhs);
+Column Sub(const Value& lhs, const Column& rhs);
+Column Mult(const Column& lhs, const Value& rhs);
+Column Mult(const Value& lhs, const Column& rhs);
+Column Div(const Column& lhs, const Value& rhs);
+Column Div(const Value& lhs, const Column& rhs);
+Column And(const Column& lhs, const Value& rhs);
+Column And(const Value& lhs, const Column& rhs);
+Column Or(const Column& lhs, const Value& rhs);
+Column Or(const Value& lhs, const Column& rhs);
+Column Less(const Column& lhs, const Value& rhs);
+Column Less(const Value& lhs, const Column& rhs);
+Column Greater(const Column& lhs, const Value& rhs);
+Column Greater(const Value& lhs, const Column& rhs);
+Column Equal(const Column& lhs, const Value& rhs);
+Column Equal(const Value& lhs, const Column& rhs);
+Column NotEqual(const Column& lhs, const Value& rhs);
+Column NotEqual(const Value& lhs, const Column& rhs);
+Column LessOrEqual(const Column& lhs, const Value& rhs);
+Column LessOrEqual(const Value& lhs, const Column& rhs);
+Column GreaterOrEqual(const Column& lhs, const Value& rhs);
+Column GreaterOrEqual(const Value& lhs, const Column& rhs);
+enum class Comparison {
+  kLess,
+  kGreater,
+  kEqual,
+  kNotEqual,
+  kLessOrEqual,
+  kGreaterOrEqual,
+};
+
+// Comparison kernels producing bitmaps. Integer (except Int128), temporal and char values are compared 256 bits at
+// a time and the results are moved to the bitmap as masks; other types go through the Boolean kernels.
+Bitmap CompareToBitmap(Comparison comparison, const Column& lhs, const Column& rhs);
+Bitmap CompareToBitmap(Comparison comparison, const Column& lhs, const Value& rhs);
+Bitmap ToBitmap(const Column& operand);
+
 Column StrContains(const Column& operand, const std::string& substring, bool negated);
+Bitmap StrContainsToBitmap(const Column& operand, const std::string& substring, bool negated);
+Column IsIn(const Column& operand, const std::vector<Value>& values);
 
 // Unary operations
 Column Not(const Column& operand);
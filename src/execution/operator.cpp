@@ -1,22 +1,284 @@
 #include "src/execution/operator.h"
 
 #include <algorithm>
-#include <numeric>
-#include <queue>
+#include <atomic>
+#include <limits>
+#include <mutex>
 #include <unordered_map>
 #include <unordered_set>
 
 #include "src/core/columnar.h"
 #include "src/execution/aggregation_executor.h"
 #include "src/execution/aggregation_executor_compact.h"
+#include "src/execution/aggregation_spill.h"
+#include "src/execution/aggregation_strategy.h"
 #include "src/execution/batch.h"
 #include "src/execution/kernel.h"
+#include "src/execution/sort_key.h"
+#include "src/execution/spill.h"
 #include "src/execution/stream.h"
+#include "src/execution/thread_pool.h"
+#include "src/execution/top_k.h"
 #include "src/util/assert.h"
 #include "src/util/macro.h"
 
 namespace ngn {
 
+namespace {
+
+// Row groups of a scan shared by the copies of one pipeline running on different workers. Every row group is a
+// morsel read by exactly one of the copies, so faster workers simply take more of them.
+struct MorselQueue {
+  std::atomic<uint64_t> next_row_group = 0;
+};
+
+// Bound on a column of a scan published while the query runs: the first sort key of the last row a TopK over the
+// scan currently keeps. Rows after the bound in the sort order cannot make it into the result, so the scan skips row
+// groups whose zone maps show that all of their rows are after it.
+class ScanThreshold {
+ public:
+  ScanThreshold(std::string column_name, bool ascending)
+      : column_name_(std::move(column_name)), ascending_(ascending) {}
+
+  const std::string& ColumnName() const { return column_name_; }
+
+  // Replaces the bound if `bound` is tighter.
+  void Tighten(const Value& bound) {
+    std::lock_guard lock(mutex_);
+    if (!bound_.has_value() || (ascending_ ? bound < *bound_ : bound > *bound_)) {
+      bound_ = bound;
+    }
+  }
+
+  // Whether no row of a row group with zone map `entry` can come before the bound. Rows equal to it on the column may
+  // still win on the following sort keys, so they are kept.
+  bool CanSkip(const ZoneMapEntry& entry) const {
+    if (!entry.has_stats) {
+      return false;
+    }
+    std::lock_guard lock(mutex_);
+    if (!bound_.has_value()) {
+      return false;
+    }
+    return ascending_ ? *entry.min_value > *bound_ : *entry.max_value < *bound_;
+  }
+
+ private:
+  const std::string column_name_;
+  const bool ascending_;
+
+  mutable std::mutex mutex_;
+  std::optional<Value> bound_;
+};
+
+// Stream of batches whose rows may be limited by a selection. Next() returns the selected rows only; stages that can
+// skip unselected rows themselves call NextSelected() to avoid copying them out.
+class ISelectionStream : public IStream<std::shared_ptr<Batch>> {
+ public:
+  virtual std::optional<SelectedBatch> NextSelected() = 0;
+
+  std::optional<std::shared_ptr<Batch>> Next() final {
+    std::optional<SelectedBatch> selected = NextSelected();
+    if (!selected) {
+      return std::nullopt;
+    }
+    return selected->Materialize();
+  }
+};
+
+// All rows of the batches of another stream.
+class SelectAllStream : public ISelectionStream {
+ public:
+  explicit SelectAllStream(std::shared_ptr<IStream<std::shared_ptr<Batch>>> stream) : stream_(std::move(stream)) {}
+
+  std::optional<SelectedBatch> NextSelected() override {
+    std::optional<std::shared_ptr<Batch>> batch = stream_->Next();
+    if (!batch) {
+      return std::nullopt;
+    }
+    return SelectedBatch{.batch = std::move(batch.value()), .selection = std::nullopt};
+  }
+
+ private:
+  std::shared_ptr<IStream<std::shared_ptr<Batch>>> stream_;
+};
+
+// Number of copies to run the pipeline `op` with: ExecutionThreads() if it is a chain of filters and projections over
+// a scan, 1 otherwise.
+int PipelineWorkers(std::shared_ptr<Operator> op);
+
+// Executes a copy of the pipeline `op` whose scan takes its row groups from `morsels` and skips those that cannot pass
+// `threshold`, if any.
+std::shared_ptr<ISelectionStream> ExecutePipeline(std::shared_ptr<Operator> op, std::shared_ptr<MorselQueue> morsels,
+                                                  std::shared_ptr<ScanThreshold> threshold = nullptr);
+
+// Executes `op` keeping the selections of its filters and projections; other operators select all rows.
+std::shared_ptr<ISelectionStream> ExecuteSelecting(std::shared_ptr<Operator> op);
+
+// Calls consume(worker, stream) for every worker on the thread pool, each with its own copy of the pipeline `op`. A
+// `threshold` requires `op` to be a chain of filters and projections over a scan.
+template <typename Consume>
+void RunPipeline(std::shared_ptr<Operator> op, int workers, Consume&& consume,
+                 std::shared_ptr<ScanThreshold> threshold = nullptr) {
+  if (workers == 1 && threshold == nullptr) {
+    consume(0, ExecuteSelecting(op));
+    return;
+  }
+
+  auto morsels = std::make_shared<MorselQueue>();
+  GetThreadPool().ParallelFor(workers, [&](int worker) { consume(worker, ExecutePipeline(op, morsels, threshold)); });
+}
+
+// The part of `input` a consumer reading only the columns `names` needs: the batch itself without a selection,
+// otherwise the selected rows of just those columns.
+std::shared_ptr<Batch> SelectedColumns(const SelectedBatch& input, const std::vector<std::string>& names) {
+  return input.selection.has_value() ? input.Materialize(names) : input.batch;
+}
+
+// Columns read by the aggregated expressions and the group-by keys.
+std::vector<std::string> AggregationColumns(const std::vector<AggregationUnit>& aggregations,
+                                            const std::vector<GroupByUnit>& group_by = {}) {
+  std::vector<std::string> names;
+  for (const auto& unit : aggregations) {
+    if (unit.expression != nullptr) {
+      CollectReferencedColumns(unit.expression, names);
+    }
+  }
+  for (const auto& unit : group_by) {
+    CollectReferencedColumns(unit.expression, names);
+  }
+  return names;
+}
+
+// Aggregates the output of `child` into one State per worker, constructed from `args`, and merges them. The states
+// see only the selected rows of the columns `aggregation` reads.
+template <typename State, typename... Args>
+std::shared_ptr<Batch> AggregateInParallel(std::shared_ptr<Operator> child, const Aggregation& aggregation,
+                                           const Args&... args) {
+  const int workers = PipelineWorkers(child);
+  const std::vector<std::string> columns =
+      AggregationColumns(aggregation.aggregations, aggregation.group_by_expressions);
+
+  std::vector<State> states;
+  states.reserve(workers);
+  for (int i = 0; i < workers; ++i) {
+    states.emplace_back(args...);
+  }
+
+  RunPipeline(child, workers, [&](int worker, std::shared_ptr<ISelectionStream> stream) {
+    while (auto input = stream->NextSelected()) {
+      states[worker].Consume(SelectedColumns(*input, columns));
+    }
+  });
+
+  State result = std::move(states[0]);
+  states.erase(states.begin());
+  result.Merge(std::move(states));
+  return result.Finalize();
+}
+
+int64_t IntegerValue(const Value& value) {
+  return std::visit(
+      []<typename T>(const T& v) -> int64_t {
+        if constexpr (std::is_same_v<T, int16_t> || std::is_same_v<T, int32_t> || std::is_same_v<T, int64_t>) {
+          return v;
+        } else {
+          THROW_NOT_IMPLEMENTED;
+        }
+      },
+      value.GetValue());
+}
+
+// The scan at the bottom of the pipeline `op` if it is a chain of filters and projections over a scan, nullptr
+// otherwise. Replaces `names` of columns in the output of `op` by the names of the scanned columns they are copies of,
+// or by nullopt if they are computed.
+std::shared_ptr<ScanOperator> PipelineScan(std::shared_ptr<Operator> op,
+                                           std::vector<std::optional<std::string>>& names) {
+  while (op->type != OperatorType::kScan) {
+    if (op->type == OperatorType::kFilter) {
+      op = std::static_pointer_cast<FilterOperator>(op)->child;
+      continue;
+    }
+    if (op->type != OperatorType::kProject) {
+      return nullptr;
+    }
+
+    auto project = std::static_pointer_cast<ProjectOperator>(op);
+    for (auto& name : names) {
+      if (!name.has_value()) {
+        continue;
+      }
+      auto it = std::find_if(project->projections.begin(), project->projections.end(),
+                             [&name](const ProjectionUnit& projection) { return projection.name == *name; });
+      if (it != project->projections.end() && it->expression->expr_type == ExpressionType::kVariable) {
+        name = std::static_pointer_cast<Variable>(it->expression)->name;
+      } else {
+        name.reset();
+      }
+    }
+    op = project->child;
+  }
+  return std::static_pointer_cast<ScanOperator>(op);
+}
+
+// Statistics of the input of `aggregation` taken from the metadata of the file scanned at the bottom of the pipeline
+// `op`: its row count, the distinct value estimates of the group-by keys that are columns of the scan and, for integer
+// keys, their domains from the zone maps.
+AggregationStatistics AggregationInputStatistics(std::shared_ptr<Operator> op, const Aggregation& aggregation) {
+  // Names of the key columns in the output of `op`.
+  std::vector<std::optional<std::string>> names;
+  for (const auto& group_by : aggregation.group_by_expressions) {
+    if (group_by.expression->expr_type == ExpressionType::kVariable) {
+      names.emplace_back(std::static_pointer_cast<Variable>(group_by.expression)->name);
+    } else {
+      names.emplace_back(std::nullopt);
+    }
+  }
+
+  AggregationStatistics statistics;
+  statistics.key_domains.resize(names.size());
+  statistics.key_ndvs.resize(names.size());
+  const std::shared_ptr<ScanOperator> scan = PipelineScan(std::move(op), names);
+  if (scan == nullptr) {
+    return statistics;
+  }
+
+  const FileReader reader(scan->input_path);
+  statistics.rows = reader.RowCount();
+  const auto& fields = reader.GetSchema().Fields();
+  for (size_t j = 0; j < names.size(); ++j) {
+    auto field = std::find_if(fields.begin(), fields.end(),
+                              [&](const Field& f) { return names[j].has_value() && f.name == *names[j]; });
+    if (field == fields.end()) {
+      continue;
+    }
+
+    const size_t column = field - fields.begin();
+    statistics.key_ndvs[j] = reader.GetNdvEstimate(column);
+    if (!reader.HasZoneMaps() || reader.RowGroupCount() == 0 ||
+        (field->type != Type::kInt16 && field->type != Type::kInt32 && field->type != Type::kInt64)) {
+      continue;
+    }
+
+    std::optional<KeyDomain> domain;
+    for (const auto& zone_map : reader.GetZoneMaps()) {
+      const ZoneMapEntry& entry = zone_map.columns[column];
+      if (!entry.has_stats) {
+        domain.reset();
+        break;
+      }
+      const int64_t min = IntegerValue(*entry.min_value);
+      const int64_t max = IntegerValue(*entry.max_value);
+      domain = domain.has_value() ? KeyDomain{std::min(domain->min, min), std::max(domain->max, max)}
+                                  : KeyDomain{min, max};
+    }
+    statistics.key_domains[j] = domain;
+  }
+  return statistics;
+}
+
+}  // namespace
+
 class AggregationStream : public IStream<std::shared_ptr<Batch>> {
  public:
   AggregationStream(std::shared_ptr<AggregateOperator> aggregation) : op_(std::move(aggregation)) {}
@@ -25,8 +287,12 @@ class AggregationStream : public IStream<std::shared_ptr<Batch>> {
     if (first_) {
       first_ = false;
 
-      auto stream = Execute(op_->child);
-      return Evaluate(stream, op_->aggregation);
+      const int64_t budget = AggregationMemoryBudget();
+      const int workers = PipelineWorkers(op_->child);
+      const AggregationStatistics statistics = AggregationInputStatistics(op_->child, *op_->aggregation);
+      return AggregateInParallel<SpillingAggregationState<AdaptiveAggregationState>>(
+          op_->child, *op_->aggregation, budget, workers, op_->aggregation, statistics, kCompactAggregationGroups,
+          CompactInitialGroups(budget, EstimateGroups(statistics), workers));
     }
 
     return std::nullopt;
@@ -46,8 +312,11 @@ class CompactAggregationStream : public IStream<std::shared_ptr<Batch>> {
     if (first_) {
       first_ = false;
 
-      auto stream = Execute(op_->child);
-      return EvaluateCompact(stream, op_->aggregation);
+      const int64_t budget = AggregationMemoryBudget();
+      const int workers = PipelineWorkers(op_->child);
+      const std::optional<int64_t> groups = EstimateGroups(AggregationInputStatistics(op_->child, *op_->aggregation));
+      return AggregateInParallel<SpillingAggregationState<CompactAggregationState>>(
+          op_->child, *op_->aggregation, budget, workers, op_->aggregation, CompactInitialGroups(budget, groups, workers));
     }
 
     return std::nullopt;
@@ -60,7 +329,13 @@ class CompactAggregationStream : public IStream<std::shared_ptr<Batch>> {
 
 class ScanStream : public IStream<std::shared_ptr<Batch>> {
  public:
-  ScanStream(std::shared_ptr<ScanOperator> scan) : reader_(scan->input_path), op_(std::move(scan)) {
+  // Copies of a scan sharing `morsels` split the row groups between them; without it the scan reads all of them.
+  explicit ScanStream(std::shared_ptr<ScanOperator> scan, std::shared_ptr<MorselQueue> morsels = nullptr,
+                      std::shared_ptr<ScanThreshold> threshold = nullptr)
+      : reader_(scan->input_path, MappedReaderOptions()),
+        op_(std::move(scan)),
+        morsels_(std::move(morsels)),
+        threshold_(std::move(threshold)) {
     // Build mapping from column name to index in file schema
     const auto& file_fields = reader_.GetSchema().Fields();
     for (size_t i = 0; i < file_fields.size(); ++i) {
@@ -80,45 +355,76 @@ class ScanStream : public IStream<std::shared_ptr<Batch>> {
         resolved_predicates_.push_back({it->second, pred});
       }
     }
+
+    if (threshold_ != nullptr && reader_.HasZoneMaps()) {
+      auto it = column_name_to_index_.find(threshold_->ColumnName());
+      if (it != column_name_to_index_.end()) {
+        threshold_column_ = it->second;
+      }
+    }
   }
 
   std::optional<std::shared_ptr<Batch>> Next() override {
-    while (row_group_index_ < reader_.RowGroupCount()) {
+    std::vector<RowRange> ranges;
+    while (true) {
+      row_group_index_ = morsels_ != nullptr ? morsels_->next_row_group.fetch_add(1) : next_row_group_++;
+      if (row_group_index_ >= reader_.RowGroupCount()) {
+        return std::nullopt;
+      }
       if (CanSkipCurrentRowGroup()) {
-        ++row_group_index_;
         continue;
       }
-      break;
+      ranges = SurvivingRanges();
+      if (!ranges.empty()) {
+        break;
+      }
     }
 
-    if (row_group_index_ >= reader_.RowGroupCount()) {
-      return std::nullopt;
-    }
+    const bool whole_row_group =
+        ranges.size() == 1 && ranges[0] == RowRange{0, reader_.RowGroupRowCount(row_group_index_)};
 
     if (columns_to_read_.empty()) {
-      int64_t row_count = reader_.RowGroupRowCount(row_group_index_);
-      ++row_group_index_;
+      int64_t row_count = 0;
+      for (const auto& range : ranges) {
+        row_count += range.Size();
+      }
       return std::make_shared<Batch>(row_count, op_->schema);
     }
 
     std::vector<Column> columns;
     columns.reserve(columns_to_read_.size());
     for (size_t col_idx : columns_to_read_) {
-      columns.push_back(reader_.ReadRowGroupColumn(row_group_index_, col_idx));
+      columns.push_back(whole_row_group ? reader_.ReadRowGroupColumn(row_group_index_, col_idx)
+                                        : reader_.ReadRowGroupColumnRanges(row_group_index_, col_idx, ranges));
     }
-    ++row_group_index_;
 
     return std::make_shared<Batch>(std::move(columns), op_->schema);
   }
 
  private:
+  static FileReader::Options MappedReaderOptions() {
+    FileReader::Options options;
+    options.use_mmap = true;
+    return options;
+  }
+
   bool CanSkipCurrentRowGroup() const {
-    if (!reader_.HasZoneMaps() || resolved_predicates_.empty()) {
-      return false;
+    if (threshold_column_.has_value() &&
+        threshold_->CanSkip(reader_.GetZoneMaps()[row_group_index_].columns[*threshold_column_])) {
+      return true;
     }
 
     for (const auto& [col_idx, pred] : resolved_predicates_) {
-      if (reader_.CanSkipRowGroupForRange(row_group_index_, col_idx, *pred.range_min, *pred.range_max)) {
+      if (pred.substring.has_value()) {
+        if (reader_.CanSkipRowGroupForContains(row_group_index_, col_idx, *pred.substring)) {
+          return true;
+        }
+      } else if (*pred.range_min == *pred.range_max) {
+        // Equality predicates can also be answered by a Bloom filter.
+        if (reader_.CanSkipRowGroupForEqual(row_group_index_, col_idx, *pred.range_min)) {
+          return true;
+        }
+      } else if (reader_.CanSkipRowGroupForRange(row_group_index_, col_idx, *pred.range_min, *pred.range_max)) {
         return true;
       }
     }
@@ -126,6 +432,51 @@ class ScanStream : public IStream<std::shared_ptr<Batch>> {
     return false;
   }
 
+  // Row ranges of the current row group whose pages may contain rows matching all predicates. Without a page index
+  // this is the whole row group.
+  std::vector<RowRange> SurvivingRanges() const {
+    const int64_t row_count = reader_.RowGroupRowCount(row_group_index_);
+    if (resolved_predicates_.empty() || !reader_.HasPageIndex(row_group_index_)) {
+      return {RowRange{0, row_count}};
+    }
+
+    int64_t page_rows = 0;
+    std::vector<bool> keep;
+    for (const auto& [col_idx, pred] : resolved_predicates_) {
+      if (!pred.range_min.has_value()) {
+        continue;
+      }
+      PageZoneMap page_zone_map = reader_.ReadPageZoneMap(row_group_index_, col_idx);
+      page_rows = page_zone_map.page_rows;
+      keep.resize(page_zone_map.pages.size(), true);
+      ASSERT(keep.size() == page_zone_map.pages.size());
+      for (size_t page = 0; page < keep.size(); ++page) {
+        if (keep[page] && page_zone_map.pages[page].CanSkipForRange(*pred.range_min, *pred.range_max)) {
+          keep[page] = false;
+        }
+      }
+    }
+
+    if (keep.empty()) {
+      return {RowRange{0, row_count}};
+    }
+
+    std::vector<RowRange> ranges;
+    for (size_t page = 0; page < keep.size(); ++page) {
+      if (!keep[page]) {
+        continue;
+      }
+      const int64_t begin = static_cast<int64_t>(page) * page_rows;
+      const int64_t end = std::min(row_count, begin + page_rows);
+      if (!ranges.empty() && ranges.back().end == begin) {
+        ranges.back().end = end;
+      } else {
+        ranges.push_back(RowRange{begin, end});
+      }
+    }
+    return ranges;
+  }
+
   FileReader reader_;
 
   std::shared_ptr<ScanOperator> op_;
@@ -135,7 +486,14 @@ class ScanStream : public IStream<std::shared_ptr<Batch>> {
 
   std::vector<std::pair<size_t, ZoneMapPredicate>> resolved_predicates_;
 
-  size_t row_group_index_ = 0;
+  std::shared_ptr<MorselQueue> morsels_;
+  uint64_t next_row_group_ = 0;
+  // Row group returned by the last call to Next().
+  uint64_t row_group_index_ = 0;
+
+  std::shared_ptr<ScanThreshold> threshold_;
+  // Index of the column of `threshold_` if the file has zone maps for it.
+  std::optional<size_t> threshold_column_;
 };
 
 class CountTableStream : public IStream<std::shared_ptr<Batch>> {
@@ -297,9 +655,7 @@ Type GetAggregationOutputType(const AggregationUnit& unit) {
 
 class GlobalAggregationStream : public IStream<std::shared_ptr<Batch>> {
  public:
-  explicit GlobalAggregationStream(std::shared_ptr<GlobalAggregationOperator> op) : op_(std::move(op)) {
-    stream_ = Execute(op_->child);
-  }
+  explicit GlobalAggregationStream(std::shared_ptr<GlobalAggregationOperator> op) : op_(std::move(op)) {}
 
   std::optional<std::shared_ptr<Batch>> Next() override {
     if (returned_) {
@@ -315,65 +671,24 @@ class GlobalAggregationStream : public IStream<std::shared_ptr<Batch>> {
       out_types.emplace_back(GetAggregationOutputType(a));
     }
 
-    std::vector<int64_t> counts(n, 0);
-    std::vector<Int128> sum_acc(n, static_cast<Int128>(0));
-    std::vector<std::optional<Value>> minmax_acc(n);
-    std::vector<std::unordered_set<Value, ValueHash>> distinct_sets(n);
-
-    bool saw_any_rows = false;
+    const int workers = PipelineWorkers(op_->child);
+    std::vector<Accumulators> partial;
+    partial.reserve(workers);
+    for (int i = 0; i < workers; ++i) {
+      partial.emplace_back(n);
+    }
 
-    while (auto batch_opt = stream_->Next()) {
-      std::shared_ptr<Batch> batch = batch_opt.value();
-      if (batch->Rows() == 0) {
-        continue;
+    const std::vector<std::string> input_columns = AggregationColumns(op_->aggregations);
+    RunPipeline(op_->child, workers, [&](int worker, std::shared_ptr<ISelectionStream> stream) {
+      while (auto input = stream->NextSelected()) {
+        partial[worker].Consume(op_->aggregations, out_types, SelectedColumns(*input, input_columns));
       }
-      saw_any_rows = true;
+    });
 
-      for (size_t i = 0; i < n; ++i) {
-        const auto& unit = op_->aggregations[i];
-        switch (unit.type) {
-          case AggregationType::kCount: {
-            counts[i] += batch->Rows();
-            break;
-          }
-          case AggregationType::kSum: {
-            Column col = Evaluate(batch, unit.expression);
-            Value part = ReduceSumSimd256(col, out_types[i]);
-            if (out_types[i] == Type::kInt128) {
-              sum_acc[i] += std::get<Int128>(part.GetValue());
-            } else {
-              sum_acc[i] += static_cast<Int128>(std::get<int64_t>(part.GetValue()));
-            }
-            break;
-          }
-          case AggregationType::kMin: {
-            Column col = Evaluate(batch, unit.expression);
-            Value part = ReduceMin(col);
-            if (!minmax_acc[i].has_value() || part < *minmax_acc[i]) {
-              minmax_acc[i] = part;
-            }
-            break;
-          }
-          case AggregationType::kMax: {
-            Column col = Evaluate(batch, unit.expression);
-            Value part = ReduceMax(col);
-            if (!minmax_acc[i].has_value() || part > *minmax_acc[i]) {
-              minmax_acc[i] = part;
-            }
-            break;
-          }
-          case AggregationType::kDistinct: {
-            Column col = Evaluate(batch, unit.expression);
-            for (size_t r = 0; r < col.Size(); ++r) {
-              distinct_sets[i].insert(col[r]);
-            }
-            break;
-          }
-          default:
-            THROW_NOT_IMPLEMENTED;
-        }
-      }
+    for (int i = 1; i < workers; ++i) {
+      partial[0].Merge(op_->aggregations, std::move(partial[i]));
     }
+    const auto& [counts, sum_acc, minmax_acc, distinct_sets, saw_any_rows] = partial[0];
 
     std::vector<Field> fields;
     fields.reserve(n);
@@ -433,140 +748,402 @@ class GlobalAggregationStream : public IStream<std::shared_ptr<Batch>> {
   }
 
  private:
+  // Partial results of all aggregations over part of the input.
+  struct Accumulators {
+    explicit Accumulators(size_t n)
+        : counts(n, 0), sum_acc(n, static_cast<Int128>(0)), minmax_acc(n), distinct_sets(n) {}
+
+    void Consume(const std::vector<AggregationUnit>& aggregations, const std::vector<Type>& out_types,
+                 const std::shared_ptr<Batch>& batch) {
+      if (batch->Rows() == 0) {
+        return;
+      }
+      saw_any_rows = true;
+
+      for (size_t i = 0; i < aggregations.size(); ++i) {
+        const auto& unit = aggregations[i];
+        switch (unit.type) {
+          case AggregationType::kCount: {
+            counts[i] += batch->Rows();
+            break;
+          }
+          case AggregationType::kSum: {
+            Column col = Evaluate(batch, unit.expression);
+            Value part = ReduceSumSimd256(col, out_types[i]);
+            if (out_types[i] == Type::kInt128) {
+              sum_acc[i] += std::get<Int128>(part.GetValue());
+            } else {
+              sum_acc[i] += static_cast<Int128>(std::get<int64_t>(part.GetValue()));
+            }
+            break;
+          }
+          case AggregationType::kMin: {
+            Column col = Evaluate(batch, unit.expression);
+            UpdateMin(i, ReduceMin(col));
+            break;
+          }
+          case AggregationType::kMax: {
+            Column col = Evaluate(batch, unit.expression);
+            UpdateMax(i, ReduceMax(col));
+            break;
+          }
+          case AggregationType::kDistinct: {
+            Column col = Evaluate(batch, unit.expression);
+            for (size_t r = 0; r < col.Size(); ++r) {
+              distinct_sets[i].insert(col[r]);
+            }
+            break;
+          }
+          default:
+            THROW_NOT_IMPLEMENTED;
+        }
+      }
+    }
+
+    void Merge(const std::vector<AggregationUnit>& aggregations, Accumulators&& other) {
+      saw_any_rows = saw_any_rows || other.saw_any_rows;
+      for (size_t i = 0; i < aggregations.size(); ++i) {
+        counts[i] += other.counts[i];
+        sum_acc[i] += other.sum_acc[i];
+        if (other.minmax_acc[i].has_value()) {
+          if (aggregations[i].type == AggregationType::kMin) {
+            UpdateMin(i, std::move(*other.minmax_acc[i]));
+          } else {
+            UpdateMax(i, std::move(*other.minmax_acc[i]));
+          }
+        }
+        distinct_sets[i].merge(other.distinct_sets[i]);
+      }
+    }
+
+    void UpdateMin(size_t i, Value part) {
+      if (!minmax_acc[i].has_value() || part < *minmax_acc[i]) {
+        minmax_acc[i] = std::move(part);
+      }
+    }
+
+    void UpdateMax(size_t i, Value part) {
+      if (!minmax_acc[i].has_value() || part > *minmax_acc[i]) {
+        minmax_acc[i] = std::move(part);
+      }
+    }
+
+    std::vector<int64_t> counts;
+    std::vector<Int128> sum_acc;
+    std::vector<std::optional<Value>> minmax_acc;
+    std::vector<std::unordered_set<Value, ValueHash>> distinct_sets;
+
+    bool saw_any_rows = false;
+  };
+
   bool returned_ = false;
   std::shared_ptr<GlobalAggregationOperator> op_;
-  std::shared_ptr<IStream<std::shared_ptr<Batch>>> stream_;
 };
 
-class FilterStream : public IStream<std::shared_ptr<Batch>> {
+// Filter over SelectedBatches: rows failing the condition are dropped from the selection and stay in the batch.
+// The condition is evaluated on the selected rows of the columns it reads only. Batches are only compacted once few of
+// their rows are left, since then copying them out is cheaper than evaluating the stages above on all rows.
+class FilterStream : public ISelectionStream {
  public:
-  FilterStream(std::shared_ptr<FilterOperator> filter) : op_(std::move(filter)) { stream_ = Execute(op_->child); }
-
-  std::optional<std::shared_ptr<Batch>> Next() override {
-    std::optional<std::shared_ptr<Batch>> batch = stream_->Next();
-    if (batch) {
-      Column condition_result = Evaluate(batch.value(), op_->condition);
-      ASSERT(condition_result.GetType() == Type::kBool);
+  FilterStream(std::shared_ptr<FilterOperator> filter, std::shared_ptr<ISelectionStream> child)
+      : op_(std::move(filter)), stream_(std::move(child)) {
+    CollectReferencedColumns(op_->condition, columns_);
+  }
 
-      return ApplyFilterColumn(batch.value(), std::get<ArrayType<Type::kBool>>(condition_result.Values()));
+  std::optional<SelectedBatch> NextSelected() override {
+    std::optional<SelectedBatch> input = stream_->NextSelected();
+    if (!input) {
+      return std::nullopt;
     }
-    return std::nullopt;
-  }
 
- private:
-  std::shared_ptr<Batch> ApplyFilterColumn(std::shared_ptr<Batch> batch, ArrayType<Type::kBool> filter) {
-    ASSERT(batch->Rows() == static_cast<int64_t>(filter.size()));
-
-    std::vector<Column> filtered_columns;
-
-    filtered_columns.reserve(batch->Columns().size());
-    for (const auto& column : batch->Columns()) {
-      std::visit([&filtered_columns]<typename T>(const T&) -> void { filtered_columns.emplace_back(T{}); },
-                 column.Values());
-    }
-
-    for (int64_t i = 0; i < batch->Rows(); ++i) {
-      if (filter[i].value) {
-        for (size_t j = 0; j < batch->Columns().size(); ++j) {
-          Column::GenericColumn& column = filtered_columns.at(j).Values();
-          Value::GenericValue value = batch->Columns().at(j)[i].GetValue();
-
-          std::visit(
-              [&value]<Type type>(ArrayType<type>& column) -> void {
-                if (std::holds_alternative<PhysicalType<type>>(value)) {
-                  column.emplace_back(std::get<PhysicalType<type>>(value));
-                } else {
-                  THROW_RUNTIME_ERROR("Type mismatch, type = " + std::to_string(static_cast<int>(type)) +
-                                      ", vs index " + std::to_string(value.index()));
-                }
-              },
-              column);
-        }
-      }
+    std::vector<int32_t> selection;
+    if (input->selection.has_value()) {
+      const Bitmap condition = EvaluatePredicate(input->Materialize(columns_), op_->condition);
+      selection = condition.SetRows(*input->selection);
+    } else {
+      const Bitmap condition = EvaluatePredicate(input->batch, op_->condition);
+      ASSERT(input->batch->Rows() == static_cast<int64_t>(condition.Size()));
+      selection = condition.SetRows();
     }
 
-    return std::make_shared<Batch>(std::move(filtered_columns), batch->GetSchema());
+    SelectedBatch output{.batch = std::move(input->batch), .selection = std::move(selection)};
+    if (output.Rows() * kCompactionRatio < output.batch->Rows()) {
+      return SelectedBatch{.batch = output.Materialize(), .selection = std::nullopt};
+    }
+    return output;
   }
 
+ private:
+  // Batches with fewer than 1 / kCompactionRatio of their rows selected are compacted.
+  static constexpr int64_t kCompactionRatio = 4;
+
   std::shared_ptr<FilterOperator> op_;
-  std::shared_ptr<IStream<std::shared_ptr<Batch>>> stream_;
+  std::shared_ptr<ISelectionStream> stream_;
+  // Columns the condition reads.
+  std::vector<std::string> columns_;
 };
 
-class ProjectStream : public IStream<std::shared_ptr<Batch>> {
+// Projection over SelectedBatches. The expressions are evaluated on the selected rows of the columns they read, so the
+// result has no selection.
+class ProjectStream : public ISelectionStream {
  public:
-  ProjectStream(std::shared_ptr<ProjectOperator> project) : op_(std::move(project)) { stream_ = Execute(op_->child); }
+  ProjectStream(std::shared_ptr<ProjectOperator> project, std::shared_ptr<ISelectionStream> child)
+      : op_(std::move(project)), stream_(std::move(child)) {
+    for (const auto& projection : op_->projections) {
+      CollectReferencedColumns(projection.expression, columns_);
+    }
+  }
 
-  std::optional<std::shared_ptr<Batch>> Next() override {
-    std::optional<std::shared_ptr<Batch>> batch = stream_->Next();
-    if (batch) {
-      std::vector<Column> projected_columns;
-      projected_columns.reserve(op_->projections.size());
+  std::optional<SelectedBatch> NextSelected() override {
+    std::optional<SelectedBatch> input = stream_->NextSelected();
+    if (!input) {
+      return std::nullopt;
+    }
 
-      std::vector<Field> fields;
-      for (const auto& projection : op_->projections) {
-        projected_columns.emplace_back(Evaluate(batch.value(), projection.expression));
+    const std::shared_ptr<Batch> batch = SelectedColumns(*input, columns_);
+    std::vector<Column> projected_columns;
+    projected_columns.reserve(op_->projections.size());
 
-        fields.emplace_back(Field(projection.name, projected_columns.back().GetType()));
-      }
-      return std::make_shared<Batch>(std::move(projected_columns), Schema(fields));
+    std::vector<Field> fields;
+    for (const auto& projection : op_->projections) {
+      projected_columns.emplace_back(Evaluate(batch, projection.expression));
+
+      fields.emplace_back(Field(projection.name, projected_columns.back().GetType()));
     }
-    return std::nullopt;
+    return SelectedBatch{.batch = std::make_shared<Batch>(std::move(projected_columns), Schema(fields)),
+                         .selection = std::nullopt};
   }
 
  private:
   std::shared_ptr<ProjectOperator> op_;
-  std::shared_ptr<IStream<std::shared_ptr<Batch>>> stream_;
+  std::shared_ptr<ISelectionStream> stream_;
+  // Columns the projections read.
+  std::vector<std::string> columns_;
 };
 
+// Sorts its whole input. Every worker sorts the rows it reads in runs of at most its share of SortMemoryBudget(), and
+// runs that reach the budget are spilled to temporary files. The runs are then merged: into a single batch if all of
+// them are in memory, otherwise streaming, with one row group of every spilled run in memory at a time.
 class SortStream : public IStream<std::shared_ptr<Batch>> {
  public:
-  SortStream(std::shared_ptr<SortOperator> sort) : op_(sort) { stream_ = Execute(sort->child); }
+  SortStream(std::shared_ptr<SortOperator> sort) : op_(sort) {}
 
   std::optional<std::shared_ptr<Batch>> Next() override {
-    if (returned_) {
-      return std::nullopt;
+    if (!started_) {
+      started_ = true;
+      SortRuns();
+      if (cursors_.size() == 1 && !cursors_[0].file.has_value()) {
+        return std::move(cursors_[0].batch);
+      }
+      StartMerge();
     }
-    returned_ = true;
+    return MergeNext();
+  }
 
-    std::vector<std::shared_ptr<Batch>> batches;
-    while (auto batch = stream_->Next()) {
-      batches.emplace_back(batch.value());
-    }
+ private:
+  // Spilled runs are written and read back in row groups of this many rows.
+  static constexpr int64_t kSpillRowGroupRows = int64_t{1} << 16;
+  // Rows per output batch when merging spilled runs.
+  static constexpr size_t kMergeBatchRows = size_t{1} << 16;
+
+  // Position in a sorted run. In-memory runs are a single chunk; spilled runs are read one row group at a time.
+  struct RunCursor {
+    std::shared_ptr<Batch> batch;
+    std::vector<Column> keys;
+    int64_t row = 0;
+    // Index of `batch` in chunks_.
+    size_t chunk = 0;
+
+    std::optional<SpillFile> file;
+    std::unique_ptr<FileReader> reader;
+    uint64_t next_row_group = 0;
+  };
 
-    if (batches.empty()) {
-      return std::nullopt;
+  void SortRuns() {
+    const int workers = PipelineWorkers(op_->child);
+    const int64_t budget = SortMemoryBudget() > 0 ? std::max<int64_t>(SortMemoryBudget() / workers, 1) : 0;
+
+    std::vector<std::vector<RunCursor>> runs(workers);
+    RunPipeline(op_->child, workers, [&](int worker, std::shared_ptr<IStream<std::shared_ptr<Batch>>> stream) {
+      std::vector<std::shared_ptr<Batch>> batches;
+      int64_t bytes = 0;
+      while (auto batch = stream->Next()) {
+        for (const auto& column : batch.value()->Columns()) {
+          bytes += static_cast<int64_t>(column.MemoryUsage());
+        }
+        batches.emplace_back(std::move(batch.value()));
+        if (budget > 0 && bytes > budget) {
+          runs[worker].emplace_back(SpillRun(MergeBatches(batches)));
+          batches.clear();
+          bytes = 0;
+        }
+      }
+      if (!batches.empty()) {
+        runs[worker].emplace_back(SortRun(MergeBatches(batches)));
+      }
+    });
+
+    for (auto& worker_runs : runs) {
+      for (auto& run : worker_runs) {
+        cursors_.emplace_back(std::move(run));
+      }
     }
+  }
 
-    std::shared_ptr<Batch> merged = MergeBatches(batches);
-    const int64_t num_rows = merged->Rows();
+  // Whether row `a` of `a_keys` goes before row `b` of `b_keys`.
+  bool Precedes(const std::vector<Column>& a_keys, int64_t a, const std::vector<Column>& b_keys, int64_t b) const {
+    for (size_t k = 0; k < a_keys.size(); ++k) {
+      const std::strong_ordering cmp = CompareRows(a_keys[k], a, b_keys[k], b);
+      if (cmp != 0) {
+        return op_->sort_keys[k].is_ascending ? (cmp < 0) : (cmp > 0);
+      }
+    }
+    return false;
+  }
 
-    if (num_rows == 0) {
-      return merged;
+  std::vector<Column> EvaluateKeys(const std::shared_ptr<Batch>& batch) const {
+    std::vector<Column> keys;
+    keys.reserve(op_->sort_keys.size());
+    for (const auto& sort_key : op_->sort_keys) {
+      keys.emplace_back(Evaluate(batch, sort_key.expression));
     }
+    return keys;
+  }
 
-    std::vector<Column> sort_columns;
-    sort_columns.reserve(op_->sort_keys.size());
+  std::vector<int64_t> SortIndices(const std::vector<Column>& keys) const {
+    std::vector<bool> ascending;
+    ascending.reserve(op_->sort_keys.size());
     for (const auto& sort_key : op_->sort_keys) {
-      sort_columns.emplace_back(Evaluate(merged, sort_key.expression));
+      ascending.push_back(sort_key.is_ascending);
+    }
+    return SortRows(keys, ascending);
+  }
+
+  RunCursor SortRun(std::shared_ptr<Batch> merged) const {
+    const std::vector<Column> keys = EvaluateKeys(merged);
+    const std::vector<int64_t> indices = SortIndices(keys);
+
+    RunCursor run;
+    run.batch = std::make_shared<Batch>(ReorderColumns(merged->Columns(), indices), merged->GetSchema());
+    run.keys = ReorderColumns(keys, indices);
+    return run;
+  }
+
+  // Sorts `merged` and writes it to a spill file. The rows are read back when the merge starts.
+  RunCursor SpillRun(std::shared_ptr<Batch> merged) const {
+    const std::vector<int64_t> indices = SortIndices(EvaluateKeys(merged));
+
+    RunCursor run;
+    run.file.emplace();
+    FileWriter writer(run.file->Path().string(), merged->GetSchema(), SpillFileOptions());
+    for (size_t begin = 0; begin < indices.size(); begin += kSpillRowGroupRows) {
+      const size_t end = std::min(indices.size(), begin + kSpillRowGroupRows);
+      writer.AppendRowGroup(ReorderColumns(
+          merged->Columns(), std::vector<int64_t>(indices.begin() + begin, indices.begin() + end)));
+    }
+    std::move(writer).Finalize();
+    return run;
+  }
+
+  // Replaces the chunk of a spilled run by its next row group. Returns false at the end of the run.
+  bool LoadNextRowGroup(RunCursor& cursor) {
+    if (cursor.reader == nullptr || cursor.next_row_group == cursor.reader->RowGroupCount()) {
+      return false;
+    }
+    cursor.batch = std::make_shared<Batch>(cursor.reader->ReadRowGroup(cursor.next_row_group++),
+                                           cursor.reader->GetSchema());
+    cursor.keys = EvaluateKeys(cursor.batch);
+    cursor.row = 0;
+    cursor.chunk = chunks_.size();
+    chunks_.push_back(cursor.batch);
+    return true;
+  }
+
+  // Moves to the next row of the run. Returns false at the end of the run, whose memory and file are then released.
+  bool Advance(RunCursor& cursor) {
+    if (++cursor.row < cursor.batch->Rows() || LoadNextRowGroup(cursor)) {
+      return true;
     }
+    cursor.batch.reset();
+    cursor.keys.clear();
+    cursor.reader.reset();
+    cursor.file.reset();
+    return false;
+  }
 
-    std::vector<int64_t> indices(num_rows);
-    std::iota(indices.begin(), indices.end(), 0);
+  bool After(size_t a, size_t b) const {
+    return Precedes(cursors_[b].keys, cursors_[b].row, cursors_[a].keys, cursors_[a].row);
+  }
 
-    std::sort(indices.begin(), indices.end(), [&](int64_t a, int64_t b) {
-      for (size_t k = 0; k < sort_columns.size(); ++k) {
-        std::strong_ordering cmp = sort_columns[k][a] <=> sort_columns[k][b];
-        if (cmp != 0) {
-          return op_->sort_keys[k].is_ascending ? (cmp < 0) : (cmp > 0);
+  void StartMerge() {
+    for (size_t i = 0; i < cursors_.size(); ++i) {
+      RunCursor& cursor = cursors_[i];
+      if (cursor.file.has_value()) {
+        spilled_ = true;
+        cursor.reader = std::make_unique<FileReader>(cursor.file->Path().string());
+        schema_ = cursor.reader->GetSchema();
+        if (!LoadNextRowGroup(cursor)) {
+          continue;
         }
+      } else {
+        schema_ = cursor.batch->GetSchema();
+        cursor.chunk = chunks_.size();
+        chunks_.push_back(cursor.batch);
       }
-      return false;
-    });
+      if (cursor.batch->Rows() > 0) {
+        heap_.push_back(i);
+      }
+    }
+    std::make_heap(heap_.begin(), heap_.end(), [this](size_t a, size_t b) { return After(a, b); });
+  }
+
+  // Next rows of the k-way merge of the runs: all of them if every run is in memory, otherwise at most
+  // kMergeBatchRows.
+  std::optional<std::shared_ptr<Batch>> MergeNext() {
+    auto after = [this](size_t a, size_t b) { return After(a, b); };
+    const size_t limit = spilled_ ? kMergeBatchRows : std::numeric_limits<size_t>::max();
+
+    std::vector<std::pair<size_t, int64_t>> order;  // chunk, row
+    while (!heap_.empty() && order.size() < limit) {
+      std::pop_heap(heap_.begin(), heap_.end(), after);
+      RunCursor& cursor = cursors_[heap_.back()];
+      order.emplace_back(cursor.chunk, cursor.row);
+      if (Advance(cursor)) {
+        std::push_heap(heap_.begin(), heap_.end(), after);
+      } else {
+        heap_.pop_back();
+      }
+    }
+
+    if (order.empty() && (returned_ || !schema_.has_value())) {
+      return std::nullopt;
+    }
+    returned_ = true;
+
+    std::vector<Column> result;
+    for (size_t col_idx = 0; col_idx < schema_->Fields().size(); ++col_idx) {
+      Dispatch(
+          [&]<Type type>(Tag<type>) {
+            ArrayType<type> dest;
+            dest.reserve(order.size());
+            for (const auto& [chunk, row] : order) {
+              dest.emplace_back(std::get<ArrayType<type>>(chunks_[chunk]->Columns()[col_idx].Values())[row]);
+            }
+            result.emplace_back(std::move(dest));
+          },
+          schema_->Fields()[col_idx].type);
+    }
+
+    // Only the current chunks of the runs are needed from now on.
+    chunks_.clear();
+    for (size_t i : heap_) {
+      cursors_[i].chunk = chunks_.size();
+      chunks_.push_back(cursors_[i].batch);
+    }
 
-    return std::make_shared<Batch>(ReorderColumns(merged->Columns(), indices), merged->GetSchema());
+    return std::make_shared<Batch>(std::move(result), *schema_);
   }
 
- private:
   static std::shared_ptr<Batch> MergeBatches(const std::vector<std::shared_ptr<Batch>>& batches) {
     ASSERT(!batches.empty());
 
@@ -624,20 +1201,26 @@ class SortStream : public IStream<std::shared_ptr<Batch>> {
     return result;
   }
 
+  bool started_ = false;
   bool returned_ = false;
+  bool spilled_ = false;
   std::shared_ptr<SortOperator> op_;
-  std::shared_ptr<IStream<std::shared_ptr<Batch>>> stream_;
+
+  std::vector<RunCursor> cursors_;
+  // Heap of the cursors that have rows left, by their current row.
+  std::vector<size_t> heap_;
+  // Chunks referenced by the rows merged since the last output batch.
+  std::vector<std::shared_ptr<Batch>> chunks_;
+  std::optional<Schema> schema_;
 };
 
 class TopKStream : public IStream<std::shared_ptr<Batch>> {
- private:
-  struct HeapEntry {
-    std::vector<Value> row_data;
-    std::vector<Value> sort_keys;
-  };
-
  public:
-  TopKStream(std::shared_ptr<TopKOperator> topk) : op_(topk) { stream_ = Execute(topk->child); }
+  TopKStream(std::shared_ptr<TopKOperator> topk) : op_(topk) {
+    for (const auto& sort_key : op_->sort_keys) {
+      ascending_.push_back(sort_key.is_ascending);
+    }
+  }
 
   std::optional<std::shared_ptr<Batch>> Next() override {
     if (returned_) {
@@ -645,109 +1228,119 @@ class TopKStream : public IStream<std::shared_ptr<Batch>> {
     }
     returned_ = true;
 
-    auto is_better = [this](const HeapEntry& a, const HeapEntry& b) -> bool {
-      for (size_t i = 0; i < a.sort_keys.size(); ++i) {
-        std::strong_ordering cmp = a.sort_keys[i] <=> b.sort_keys[i];
-        if (cmp != 0) {
-          return op_->sort_keys[i].is_ascending ? (cmp < 0) : (cmp > 0);
-        }
-      }
-      return false;
-    };
-
-    auto heap_cmp = [&is_better](const HeapEntry& a, const HeapEntry& b) -> bool { return is_better(a, b); };
-
-    std::priority_queue<HeapEntry, std::vector<HeapEntry>, decltype(heap_cmp)> heap(heap_cmp);
-
-    const uint32_t k = op_->limit;
-    std::optional<Schema> schema;
-
-    while (auto batch_opt = stream_->Next()) {
-      std::shared_ptr<Batch> batch = batch_opt.value();
-      if (!schema.has_value()) {
-        schema = batch->GetSchema();
-      }
-
-      std::vector<Column> sort_columns;
-      sort_columns.reserve(op_->sort_keys.size());
-      for (const auto& sort_key : op_->sort_keys) {
-        sort_columns.emplace_back(Evaluate(batch, sort_key.expression));
-      }
-
-      for (int64_t row_idx = 0; row_idx < batch->Rows(); ++row_idx) {
-        std::vector<Value> sort_keys;
-        sort_keys.reserve(sort_columns.size());
-        for (const auto& col : sort_columns) {
-          sort_keys.emplace_back(col[row_idx]);
-        }
-
-        bool should_insert = false;
-        if (heap.size() < k) {
-          should_insert = true;
-        } else {
-          HeapEntry candidate{.row_data = {}, .sort_keys = std::move(sort_keys)};
-          if (is_better(candidate, heap.top())) {
-            should_insert = true;
-            heap.pop();
-          }
-          sort_keys = std::move(candidate.sort_keys);
-        }
-
-        if (should_insert) {
-          std::vector<Value> row_data;
-          row_data.reserve(batch->Columns().size());
-          for (const auto& col : batch->Columns()) {
-            row_data.emplace_back(col[row_idx]);
+    // Every worker keeps the top rows of its own input; the overall top is among them. The last row a worker keeps
+    // already bounds the overall top, so it is published to the scan as soon as the worker has `limit` rows.
+    const int workers = PipelineWorkers(op_->child);
+    const std::shared_ptr<ScanThreshold> threshold = MakeThreshold();
+    std::vector<std::shared_ptr<Batch>> partial(workers);
+    RunPipeline(
+        op_->child, workers,
+        [&](int worker, std::shared_ptr<ISelectionStream> stream) {
+          TopKRows rows(op_->limit, ascending_);
+          // TopKRows skips the unselected rows itself, so they are never copied out of the batches.
+          while (auto selected = stream->NextSelected()) {
+            std::vector<Column> keys = EvaluateKeys(selected->batch);
+            rows.Consume(std::move(selected->batch), std::move(keys), selected->selection);
+            if (threshold != nullptr && rows.Full()) {
+              threshold->Tighten(rows.LastFirstKey());
+            }
           }
+          partial[worker] = rows.Finalize();
+        },
+        threshold);
 
-          heap.push(HeapEntry{.row_data = std::move(row_data), .sort_keys = std::move(sort_keys)});
-        }
+    TopKRows top(op_->limit, ascending_);
+    for (auto& batch : partial) {
+      if (batch != nullptr) {
+        std::vector<Column> keys = EvaluateKeys(batch);
+        top.Consume(std::move(batch), std::move(keys));
       }
     }
-
-    if (!schema.has_value() || heap.empty()) {
+    std::shared_ptr<Batch> result = top.Finalize();
+    if (result == nullptr || result->Rows() == 0) {
       return std::nullopt;
     }
-
-    std::vector<HeapEntry> entries;
-    entries.reserve(heap.size());
-    while (!heap.empty()) {
-      entries.emplace_back(heap.top());
-      heap.pop();
-    }
-
-    std::sort(entries.begin(), entries.end(), is_better);
-
-    return std::make_shared<Batch>(BuildColumns(schema.value(), entries), schema.value());
+    return result;
   }
 
  private:
-  static std::vector<Column> BuildColumns(const Schema& schema, const std::vector<HeapEntry>& entries) {
-    std::vector<Column> columns;
-    columns.reserve(schema.Fields().size());
-
-    for (size_t col_idx = 0; col_idx < schema.Fields().size(); ++col_idx) {
-      Type type = schema.Fields()[col_idx].type;
-      Dispatch(
-          [&]<Type type>(Tag<type>) {
-            ArrayType<type> arr;
-            arr.reserve(entries.size());
-            for (const auto& entry : entries) {
-              arr.emplace_back(std::get<PhysicalType<type>>(entry.row_data[col_idx].GetValue()));
-            }
-            columns.emplace_back(std::move(arr));
-          },
-          type);
+  std::vector<Column> EvaluateKeys(const std::shared_ptr<Batch>& batch) const {
+    std::vector<Column> keys;
+    keys.reserve(op_->sort_keys.size());
+    for (const auto& sort_key : op_->sort_keys) {
+      keys.emplace_back(Evaluate(batch, sort_key.expression));
     }
+    return keys;
+  }
 
-    return columns;
+  // A threshold on the scanned column the first sort key is a copy of, or nullptr if there is none.
+  std::shared_ptr<ScanThreshold> MakeThreshold() const {
+    const SortUnit& first = op_->sort_keys[0];
+    if (op_->limit == 0 || first.expression->expr_type != ExpressionType::kVariable) {
+      return nullptr;
+    }
+    std::vector<std::optional<std::string>> names = {std::static_pointer_cast<Variable>(first.expression)->name};
+    if (PipelineScan(op_->child, names) == nullptr || !names[0].has_value()) {
+      return nullptr;
+    }
+    return std::make_shared<ScanThreshold>(*names[0], first.is_ascending);
   }
 
   bool returned_ = false;
   std::shared_ptr<TopKOperator> op_;
-  std::shared_ptr<IStream<std::shared_ptr<Batch>>> stream_;
+  std::vector<bool> ascending_;
 };
 
+namespace {
+
+int PipelineWorkers(std::shared_ptr<Operator> op) {
+  while (op->type == OperatorType::kFilter || op->type == OperatorType::kProject) {
+    op = op->type == OperatorType::kFilter ? std::static_pointer_cast<FilterOperator>(op)->child
+                                           : std::static_pointer_cast<ProjectOperator>(op)->child;
+  }
+  return op->type == OperatorType::kScan ? ExecutionThreads() : 1;
+}
+
+std::shared_ptr<ISelectionStream> ExecutePipeline(std::shared_ptr<Operator> op, std::shared_ptr<MorselQueue> morsels,
+                                                  std::shared_ptr<ScanThreshold> threshold) {
+  switch (op->type) {
+    case OperatorType::kScan:
+      return std::make_shared<SelectAllStream>(std::make_shared<ScanStream>(
+          std::static_pointer_cast<ScanOperator>(op), std::move(morsels), std::move(threshold)));
+    case OperatorType::kFilter: {
+      auto filter = std::static_pointer_cast<FilterOperator>(op);
+      auto child = ExecutePipeline(filter->child, std::move(morsels), std::move(threshold));
+      return std::make_shared<FilterStream>(std::move(filter), std::move(child));
+    }
+    case OperatorType::kProject: {
+      auto project = std::static_pointer_cast<ProjectOperator>(op);
+      auto child = ExecutePipeline(project->child, std::move(morsels), std::move(threshold));
+      return std::make_shared<ProjectStream>(std::move(project), std::move(child));
+    }
+    default:
+      THROW_NOT_IMPLEMENTED;
+  }
+}
+
+std::shared_ptr<ISelectionStream> ExecuteSelecting(std::shared_ptr<Operator> op) {
+  switch (op->type) {
+    case OperatorType::kFilter: {
+      auto filter = std::static_pointer_cast<FilterOperator>(op);
+      auto child = ExecuteSelecting(filter->child);
+      return std::make_shared<FilterStream>(std::move(filter), std::move(child));
+    }
+    case OperatorType::kProject: {
+      auto project = std::static_pointer_cast<ProjectOperator>(op);
+      auto child = ExecuteSelecting(project->child);
+      return std::make_shared<ProjectStream>(std::move(project), std::move(child));
+    }
+    default:
+      return std::make_shared<SelectAllStream>(Execute(op));
+  }
+}
+
+}  // namespace
+
 std::shared_ptr<IStream<std::shared_ptr<Batch>>> Execute(std::shared_ptr<Operator> op) {
   ASSERT(op != nullptr);
 
@@ -765,9 +1358,8 @@ std::shared_ptr<IStream<std::shared_ptr<Batch>>> Execute(std::shared_ptr<Operato
     case OperatorType::kConcat:
       return std::make_shared<ConcatStream>(std::static_pointer_cast<ConcatOperator>(op));
     case OperatorType::kFilter:
-      return std::make_shared<FilterStream>(std::static_pointer_cast<FilterOperator>(op));
     case OperatorType::kProject:
-      return std::make_shared<ProjectStream>(std::static_pointer_cast<ProjectOperator>(op));
+      return ExecuteSelecting(op);
     case OperatorType::kSort:
       return std::make_shared<SortStream>(std::static_pointer_cast<SortOperator>(op));
     case OperatorType::kTopK:
@@ -24,18 +24,26 @@ enum class OperatorType {
   kTopK,
 };
 
+// Predicate the scan uses to skip row groups and pages. Either a value range or, for string columns with n-gram
+// filters, a substring that every matching value contains.
 struct ZoneMapPredicate {
   std::string column_name;
 
   std::optional<Value> range_min;
   std::optional<Value> range_max;
 
+  std::optional<std::string> substring;
+
   static ZoneMapPredicate Equal(std::string col, const Value& val) {
-    return ZoneMapPredicate{std::move(col), val, val};
+    return ZoneMapPredicate{std::move(col), val, val, std::nullopt};
   }
 
   static ZoneMapPredicate Range(std::string col, const Value& min_val, const Value& max_val) {
-    return ZoneMapPredicate{std::move(col), min_val, max_val};
+    return ZoneMapPredicate{std::move(col), min_val, max_val, std::nullopt};
+  }
+
+  static ZoneMapPredicate Contains(std::string col, std::string substring) {
+    return ZoneMapPredicate{std::move(col), std::nullopt, std::nullopt, std::move(substring)};
   }
 };
 
@@ -131,6 +139,9 @@ struct ProjectOperator : public Operator {
   std::vector<ProjectionUnit> projections;
 };
 
+// Picks the aggregation strategy (dense array, hash table or compact table) from the key types and the statistics in
+// the metadata of the scanned file, and switches to the compact table if there turn out to be too many groups. Groups
+// beyond AggregationMemoryBudget() are spilled to disk.
 struct AggregateOperator : public Operator {
   AggregateOperator(std::shared_ptr<Operator> chi, std::shared_ptr<Aggregation> aggr)
       : Operator(OperatorType::kAggregate), child(std::move(chi)), aggregation(std::move(aggr)) {
@@ -143,8 +154,8 @@ struct AggregateOperator : public Operator {
   std::shared_ptr<Aggregation> aggregation;
 };
 
-// Memory-lean alternative to AggregateOperator. Intended to be used selectively for
-// very high-cardinality aggregations (e.g. ClickBench Q32).
+// Forces the memory-lean compact strategy that AggregateOperator only picks for very high-cardinality aggregations.
+// Spills like AggregateOperator.
 struct CompactAggregateOperator : public Operator {
   CompactAggregateOperator(std::shared_ptr<Operator> chi, std::shared_ptr<Aggregation> aggr)
       : Operator(OperatorType::kAggregateCompact), child(std::move(chi)), aggregation(std::move(aggr)) {
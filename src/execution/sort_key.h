@@ -0,0 +1,245 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <compare>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "src/core/column.h"
+#include "src/core/type.h"
+#include "src/util/assert.h"
+
+namespace ngn {
+
+// Three-way comparison of row i of `a` with row j of `b`, which must have the same type. Unlike comparing
+// Column::operator[] results, this does not build a Value per row.
+inline std::strong_ordering CompareRows(const Column& a, size_t i, const Column& b, size_t j) {
+  return std::visit(
+      [&]<Type type>(const ArrayType<type>& left) -> std::strong_ordering {
+        const auto& right = std::get<ArrayType<type>>(b.Values());
+        return left[i] <=> right[j];
+      },
+      a.Values());
+}
+
+// Sort keys encoded as fixed-width byte strings whose memcmp order is the sort order. Integers and temporal values
+// are stored big-endian with the sign bit flipped, strings as their first kStringPrefix bytes padded with zeros, and
+// the bytes of descending keys are inverted.
+//
+// Encoding stops after the first string key: rows whose normalized keys are equal may still differ in the rest of
+// that string and in the keys after it, so ExactKeys() tells how many keys the encoding fully decides.
+class NormalizedKeys {
+ public:
+  static constexpr size_t kStringPrefix = 8;
+
+  NormalizedKeys(const std::vector<Column>& keys, const std::vector<bool>& ascending) {
+    ASSERT(keys.size() == ascending.size());
+    rows_ = keys.empty() ? 0 : keys[0].Size();
+
+    for (const auto& key : keys) {
+      ASSERT(key.Size() == rows_);
+      const Type type = key.GetType();
+      width_ += EncodedWidth(type);
+      ++encoded_keys_;
+      if (type == Type::kString) {
+        break;
+      }
+    }
+    exact_keys_ = keys.empty() || keys[encoded_keys_ - 1].GetType() != Type::kString ? encoded_keys_
+                                                                                      : encoded_keys_ - 1;
+
+    bytes_.resize(rows_ * width_);
+    size_t offset = 0;
+    for (size_t k = 0; k < encoded_keys_; ++k) {
+      Encode(keys[k], offset, ascending[k]);
+      offset += EncodedWidth(keys[k].GetType());
+    }
+  }
+
+  size_t Rows() const { return rows_; }
+  size_t Width() const { return width_; }
+  const uint8_t* Row(size_t i) const { return bytes_.data() + i * width_; }
+
+  // Number of leading keys whose order is fully decided by the normalized keys.
+  size_t ExactKeys() const { return exact_keys_; }
+
+ private:
+  static size_t EncodedWidth(Type type) {
+    if (type == Type::kString) {
+      return kStringPrefix;
+    }
+    return Dispatch([]<Type t>(Tag<t>) { return sizeof(PhysicalType<t>); }, type);
+  }
+
+  template <typename U>
+  static void StoreBigEndian(U value, uint8_t* out) {
+    for (size_t b = 0; b < sizeof(U); ++b) {
+      out[b] = static_cast<uint8_t>(value >> (8 * (sizeof(U) - 1 - b)));
+    }
+  }
+
+  // Order preserving unsigned image of a signed integer.
+  template <typename T>
+  static auto FlipSign(T value) {
+    if constexpr (std::is_same_v<T, Int128>) {
+      using U = unsigned __int128;
+      return static_cast<U>(value) ^ (U{1} << 127);
+    } else {
+      using U = std::make_unsigned_t<T>;
+      return static_cast<U>(static_cast<U>(value) ^ (U{1} << (8 * sizeof(T) - 1)));
+    }
+  }
+
+  void Encode(const Column& key, size_t offset, bool ascending) {
+    std::visit(
+        [&]<Type type>(const ArrayType<type>& values) {
+          for (size_t i = 0; i < rows_; ++i) {
+            uint8_t* out = bytes_.data() + i * width_ + offset;
+            if constexpr (type == Type::kString) {
+              const std::string_view value = values[i];
+              const size_t size = std::min(value.size(), kStringPrefix);
+              if (size != 0) {
+                std::memcpy(out, value.data(), size);
+              }
+              std::memset(out + size, 0, kStringPrefix - size);
+            } else if constexpr (type == Type::kBool) {
+              out[0] = values[i].value ? 1 : 0;
+            } else if constexpr (type == Type::kDate || type == Type::kTimestamp) {
+              StoreBigEndian(FlipSign(values[i].value), out);
+            } else if constexpr (type == Type::kChar) {
+              // char is signed here, and so is its comparison.
+              StoreBigEndian(FlipSign(static_cast<signed char>(values[i])), out);
+            } else {
+              StoreBigEndian(FlipSign(values[i]), out);
+            }
+          }
+        },
+        key.Values());
+
+    if (!ascending) {
+      const size_t width = EncodedWidth(key.GetType());
+      for (size_t i = 0; i < rows_; ++i) {
+        uint8_t* out = bytes_.data() + i * width_ + offset;
+        for (size_t b = 0; b < width; ++b) {
+          out[b] = static_cast<uint8_t>(~out[b]);
+        }
+      }
+    }
+  }
+
+  size_t rows_ = 0;
+  size_t width_ = 0;
+  size_t encoded_keys_ = 0;
+  size_t exact_keys_ = 0;
+  std::vector<uint8_t> bytes_;
+};
+
+namespace internal {
+
+// Buckets smaller than this are insertion sorted.
+inline constexpr size_t kRadixSortInsertionThreshold = 24;
+
+// MSD radix sort of `count` entries of `stride` bytes by their first `width` bytes, starting at byte `byte`. Entries
+// are moved as a whole, so the keys are read sequentially. `scratch` must have room for `count` entries.
+inline void RadixSortEntries(uint8_t* entries, uint8_t* scratch, size_t count, size_t stride, size_t width,
+                             size_t byte) {
+  while (count > 1 && byte < width) {
+    if (count <= kRadixSortInsertionThreshold) {
+      std::array<uint8_t, 256> stack_entry;
+      std::vector<uint8_t> heap_entry(stride > stack_entry.size() ? stride : 0);
+      uint8_t* entry = stride > stack_entry.size() ? heap_entry.data() : stack_entry.data();
+      for (size_t i = 1; i < count; ++i) {
+        std::memcpy(entry, entries + i * stride, stride);
+        size_t j = i;
+        for (; j > 0 && std::memcmp(entries + (j - 1) * stride + byte, entry + byte, width - byte) > 0; --j) {
+          std::memcpy(entries + j * stride, entries + (j - 1) * stride, stride);
+        }
+        std::memcpy(entries + j * stride, entry, stride);
+      }
+      return;
+    }
+
+    std::array<size_t, 257> offsets = {};
+    for (size_t i = 0; i < count; ++i) {
+      ++offsets[entries[i * stride + byte] + 1];
+    }
+    // All entries share this byte: move on to the next one without moving them.
+    if (offsets[entries[byte] + 1] == count) {
+      ++byte;
+      continue;
+    }
+
+    for (size_t b = 1; b < offsets.size(); ++b) {
+      offsets[b] += offsets[b - 1];
+    }
+    std::array<size_t, 256> next;
+    std::copy(offsets.begin(), offsets.end() - 1, next.begin());
+    for (size_t i = 0; i < count; ++i) {
+      std::memcpy(scratch + next[entries[i * stride + byte]]++ * stride, entries + i * stride, stride);
+    }
+    std::memcpy(entries, scratch, count * stride);
+
+    for (size_t b = 0; b < 256; ++b) {
+      RadixSortEntries(entries + offsets[b] * stride, scratch, offsets[b + 1] - offsets[b], stride, width, byte + 1);
+    }
+    return;
+  }
+}
+
+}  // namespace internal
+
+// Row indices of `keys` in sort order. The normalized keys are radix sorted; rows whose normalized keys are equal are
+// then ordered by the full values of the remaining keys, which is only needed for long strings.
+inline std::vector<int64_t> SortRows(const std::vector<Column>& keys, const std::vector<bool>& ascending) {
+  const NormalizedKeys normalized(keys, ascending);
+  const size_t rows = normalized.Rows();
+  const size_t width = normalized.Width();
+  const size_t stride = width + sizeof(int64_t);
+
+  // Every entry is the normalized key followed by the row index.
+  std::vector<uint8_t> entries(rows * stride);
+  for (size_t i = 0; i < rows; ++i) {
+    std::memcpy(entries.data() + i * stride, normalized.Row(i), width);
+    const auto row = static_cast<int64_t>(i);
+    std::memcpy(entries.data() + i * stride + width, &row, sizeof(row));
+  }
+  {
+    std::vector<uint8_t> scratch(entries.size());
+    internal::RadixSortEntries(entries.data(), scratch.data(), rows, stride, width, 0);
+  }
+
+  std::vector<int64_t> indices(rows);
+  for (size_t i = 0; i < rows; ++i) {
+    std::memcpy(&indices[i], entries.data() + i * stride + width, sizeof(int64_t));
+  }
+  if (normalized.ExactKeys() == keys.size()) {
+    return indices;
+  }
+
+  const size_t first = normalized.ExactKeys();
+  auto precedes = [&](int64_t a, int64_t b) {
+    for (size_t k = first; k < keys.size(); ++k) {
+      const std::strong_ordering cmp = CompareRows(keys[k], a, keys[k], b);
+      if (cmp != 0) {
+        return ascending[k] ? cmp < 0 : cmp > 0;
+      }
+    }
+    return false;
+  };
+  for (size_t begin = 0; begin < rows;) {
+    size_t end = begin + 1;
+    while (end < rows && std::memcmp(entries.data() + begin * stride, entries.data() + end * stride, width) == 0) {
+      ++end;
+    }
+    if (end - begin > 1) {
+      std::sort(indices.begin() + begin, indices.begin() + end, precedes);
+    }
+    begin = end;
+  }
+  return indices;
+}
+
+}  // namespace ngn
@@ -0,0 +1,78 @@
+#include "src/execution/spill.h"
+
+#include <unistd.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include "src/util/assert.h"
+
+namespace ngn {
+
+namespace {
+
+std::atomic<int64_t> aggregation_memory_budget = 0;
+std::atomic<int64_t> sort_memory_budget = 0;
+
+std::mutex spill_directory_mutex;
+std::filesystem::path spill_directory;
+
+std::atomic<uint64_t> spill_file_counter = 0;
+
+}  // namespace
+
+int64_t AggregationMemoryBudget() { return aggregation_memory_budget.load(); }
+
+void SetAggregationMemoryBudget(int64_t bytes) {
+  ASSERT(bytes >= 0);
+  aggregation_memory_budget.store(bytes);
+}
+
+int64_t SortMemoryBudget() { return sort_memory_budget.load(); }
+
+void SetSortMemoryBudget(int64_t bytes) {
+  ASSERT(bytes >= 0);
+  sort_memory_budget.store(bytes);
+}
+
+std::filesystem::path SpillDirectory() {
+  std::lock_guard lock(spill_directory_mutex);
+  return spill_directory.empty() ? std::filesystem::temp_directory_path() : spill_directory;
+}
+
+void SetSpillDirectory(std::filesystem::path directory) {
+  std::lock_guard lock(spill_directory_mutex);
+  spill_directory = std::move(directory);
+}
+
+SpillFile::SpillFile()
+    : path_(SpillDirectory() / ("ngn-spill-" + std::to_string(getpid()) + "-" +
+                                std::to_string(spill_file_counter.fetch_add(1)) + ".clmnr")) {}
+
+SpillFile::SpillFile(SpillFile&& other) noexcept : path_(std::exchange(other.path_, {})) {}
+
+SpillFile& SpillFile::operator=(SpillFile&& other) noexcept {
+  std::swap(path_, other.path_);
+  return *this;
+}
+
+SpillFile::~SpillFile() {
+  if (!path_.empty()) {
+    std::error_code error;
+    std::filesystem::remove(path_, error);
+  }
+}
+
+FileWriter::Options SpillFileOptions() {
+  FileWriter::Options options;
+  options.encoding.dictionary_max_distinct = 0;
+  options.encoding.integer_compression = false;
+  options.page_index_rows = 0;
+  options.ndv_estimates = false;
+  return options;
+}
+
+}  // namespace ngn
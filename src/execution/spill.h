@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+#include "src/core/columnar.h"
+
+namespace ngn {
+
+// Bytes the groups of one aggregation may take in memory, shared by all workers running it. Larger aggregations spill
+// partial results to temporary files. 0, the default, means no limit.
+int64_t AggregationMemoryBudget();
+void SetAggregationMemoryBudget(int64_t bytes);
+
+// Bytes of input rows one sort may hold in memory, shared by all workers running it. Larger inputs are sorted in runs
+// that are spilled to temporary files and merged. 0, the default, means no limit.
+int64_t SortMemoryBudget();
+void SetSortMemoryBudget(int64_t bytes);
+
+// Directory of temporary spill files. Defaults to std::filesystem::temp_directory_path().
+std::filesystem::path SpillDirectory();
+void SetSpillDirectory(std::filesystem::path directory);
+
+// Unique path in SpillDirectory(). The file is removed when the object is destroyed.
+class SpillFile {
+ public:
+  SpillFile();
+  SpillFile(SpillFile&& other) noexcept;
+  SpillFile& operator=(SpillFile&& other) noexcept;
+  ~SpillFile();
+
+  const std::filesystem::path& Path() const { return path_; }
+
+ private:
+  std::filesystem::path path_;
+};
+
+// Spill files are read back once, so they are written as fast as possible rather than as small as possible.
+FileWriter::Options SpillFileOptions();
+
+}  // namespace ngn
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "src/core/string_array.h"
+#include "src/util/assert.h"
+
+namespace ngn {
+
+// Fast non-cryptographic hash of a string, eight bytes per step. Not stable across versions: only use it for in-memory
+// tables.
+inline uint64_t HashString(std::string_view value) {
+  constexpr uint64_t kMul1 = 0x9e3779b97f4a7c15ULL;
+  constexpr uint64_t kMul2 = 0xc2b2ae3d27d4eb4fULL;
+
+  uint64_t hash = value.size() * kMul1;
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= value.size(); i += sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, value.data() + i, sizeof(word));
+    hash = std::rotl(hash ^ (word * kMul1), 31) * kMul2;
+  }
+  if (i < value.size()) {
+    uint64_t word = 0;
+    std::memcpy(&word, value.data() + i, value.size() - i);
+    hash = std::rotl(hash ^ (word * kMul1), 31) * kMul2;
+  }
+
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+// Interns strings into dense int32 codes. Key bytes are copied once into an append-only arena, so there is no
+// allocation per key. Every slot caches the full hash, the length and the first bytes of its key, so almost all
+// mismatches are rejected without touching the arena.
+class StringKeyTable {
+ public:
+  int32_t Lookup(std::string_view value) { return Lookup(value, HashString(value)); }
+
+  // `hash` must be HashString(value).
+  int32_t Lookup(std::string_view value, uint64_t hash) {
+    if ((Size() + 1) * 10 > slots_.size() * 7) {
+      Grow();
+    }
+
+    const uint32_t prefix = Prefix(value);
+    const size_t mask = slots_.size() - 1;
+    for (size_t index = hash & mask;; index = (index + 1) & mask) {
+      Slot& slot = slots_[index];
+      if (slot.code == kEmpty) {
+        slot = Slot{.hash = hash,
+                    .length = static_cast<uint32_t>(value.size()),
+                    .prefix = prefix,
+                    .code = static_cast<int32_t>(Size())};
+        values_.push_back(Store(value));
+        hashes_.push_back(hash);
+        return slot.code;
+      }
+      if (slot.hash == hash && slot.length == value.size() && slot.prefix == prefix &&
+          (value.empty() || std::memcmp(values_[slot.code].data(), value.data(), value.size()) == 0)) {
+        return slot.code;
+      }
+    }
+  }
+
+  // Codes of all values of `values`. Dictionary encoded arrays are looked up once per dictionary entry.
+  std::vector<int32_t> Encode(const StringArray& values) {
+    std::vector<int32_t> result(values.size());
+    if (values.IsDictionaryEncoded()) {
+      const StringArray& dictionary = *values.Dictionary();
+      std::vector<int32_t> translation(dictionary.size());
+      for (size_t i = 0; i < dictionary.size(); ++i) {
+        translation[i] = Lookup(dictionary[i]);
+      }
+      const auto& codes = values.Codes();
+      for (size_t i = 0; i < codes.size(); ++i) {
+        result[i] = translation[codes[i]];
+      }
+    } else {
+      for (size_t i = 0; i < values.size(); ++i) {
+        result[i] = Lookup(values[i]);
+      }
+    }
+    return result;
+  }
+
+  // The view stays valid for the lifetime of the table.
+  std::string_view Decode(int32_t code) const { return values_[code]; }
+
+  uint64_t Hash(int32_t code) const { return hashes_[code]; }
+
+  size_t Size() const { return values_.size(); }
+
+  // Bytes held by the table, including the arena.
+  size_t MemoryUsage() const {
+    return slots_.capacity() * sizeof(Slot) + values_.capacity() * sizeof(std::string_view) +
+           hashes_.capacity() * sizeof(uint64_t) + arena_bytes_;
+  }
+
+ private:
+  static constexpr int32_t kEmpty = -1;
+  static constexpr size_t kChunkBytes = size_t{1} << 16;
+
+  struct Slot {
+    uint64_t hash = 0;
+    uint32_t length = 0;
+    uint32_t prefix = 0;
+    int32_t code = kEmpty;
+  };
+
+  static uint32_t Prefix(std::string_view value) {
+    uint32_t prefix = 0;
+    if (!value.empty()) {
+      std::memcpy(&prefix, value.data(), std::min(value.size(), sizeof(prefix)));
+    }
+    return prefix;
+  }
+
+  void Grow() {
+    std::vector<Slot> old = std::move(slots_);
+    slots_.assign(std::max<size_t>(16, old.size() * 2), Slot{});
+    const size_t mask = slots_.size() - 1;
+    for (const Slot& slot : old) {
+      if (slot.code == kEmpty) {
+        continue;
+      }
+      size_t index = slot.hash & mask;
+      while (slots_[index].code != kEmpty) {
+        index = (index + 1) & mask;
+      }
+      slots_[index] = slot;
+    }
+  }
+
+  // Copies `value` into the arena.
+  std::string_view Store(std::string_view value) {
+    ASSERT(value.size() <= std::numeric_limits<uint32_t>::max());
+    if (value.size() > chunk_free_) {
+      const size_t size = std::max(kChunkBytes, value.size());
+      chunks_.push_back(std::make_unique<char[]>(size));
+      arena_bytes_ += size;
+      chunk_end_ = chunks_.back().get();
+      chunk_free_ = size;
+    }
+    if (!value.empty()) {
+      std::memcpy(chunk_end_, value.data(), value.size());
+    }
+    std::string_view stored(chunk_end_, value.size());
+    chunk_end_ += value.size();
+    chunk_free_ -= value.size();
+    return stored;
+  }
+
+  std::vector<Slot> slots_;
+  std::vector<std::string_view> values_;
+  std::vector<uint64_t> hashes_;
+
+  std::vector<std::unique_ptr<char[]>> chunks_;
+  char* chunk_end_ = nullptr;
+  size_t chunk_free_ = 0;
+  size_t arena_bytes_ = 0;
+};
+
+}  // namespace ngn
@@ -0,0 +1,151 @@
+#include "src/execution/string_search.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "src/util/assert.h"
+
+namespace ngn {
+
+namespace internal {
+
+size_t FindScalar(std::string_view haystack, std::string_view needle) { return haystack.find(needle); }
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// The vector implementations are compiled for their instruction sets regardless of the flags of the build, so they
+// use the intrinsics directly instead of simde, and only run after SelectFind() checked the CPU.
+
+namespace {
+
+// Whether the candidate at `position`, whose first and last bytes already match, is an occurrence.
+inline bool MatchesAt(const char* position, std::string_view needle) {
+  return needle.size() <= 2 || std::memcmp(position + 1, needle.data() + 1, needle.size() - 2) == 0;
+}
+
+}  // namespace
+
+size_t FindSse2(std::string_view haystack, std::string_view needle) {
+  constexpr size_t kBlock = sizeof(__m128i);
+  if (needle.empty() || haystack.size() < needle.size() + kBlock) {
+    return FindScalar(haystack, needle);
+  }
+
+  const __m128i first = _mm_set1_epi8(needle.front());
+  const __m128i last = _mm_set1_epi8(needle.back());
+  const char* data = haystack.data();
+  size_t i = 0;
+  for (; i + needle.size() - 1 + kBlock <= haystack.size(); i += kBlock) {
+    const __m128i block_first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    const __m128i block_last = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + needle.size() - 1));
+    const __m128i candidates = _mm_and_si128(_mm_cmpeq_epi8(block_first, first), _mm_cmpeq_epi8(block_last, last));
+    for (auto mask = static_cast<uint32_t>(_mm_movemask_epi8(candidates)); mask != 0; mask &= mask - 1) {
+      const size_t position = i + std::countr_zero(mask);
+      if (MatchesAt(data + position, needle)) {
+        return position;
+      }
+    }
+  }
+
+  const size_t rest = FindScalar(haystack.substr(i), needle);
+  return rest == std::string_view::npos ? rest : i + rest;
+}
+
+__attribute__((target("avx2"))) size_t FindAvx2(std::string_view haystack, std::string_view needle) {
+  constexpr size_t kBlock = sizeof(__m256i);
+  if (needle.empty() || haystack.size() < needle.size() + kBlock) {
+    return FindSse2(haystack, needle);
+  }
+
+  const __m256i first = _mm256_set1_epi8(needle.front());
+  const __m256i last = _mm256_set1_epi8(needle.back());
+  const char* data = haystack.data();
+  size_t i = 0;
+  for (; i + needle.size() - 1 + kBlock <= haystack.size(); i += kBlock) {
+    const __m256i block_first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+    const __m256i block_last = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + needle.size() - 1));
+    const __m256i candidates =
+        _mm256_and_si256(_mm256_cmpeq_epi8(block_first, first), _mm256_cmpeq_epi8(block_last, last));
+    for (auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(candidates)); mask != 0; mask &= mask - 1) {
+      const size_t position = i + std::countr_zero(mask);
+      if (MatchesAt(data + position, needle)) {
+        return position;
+      }
+    }
+  }
+
+  const size_t rest = FindSse2(haystack.substr(i), needle);
+  return rest == std::string_view::npos ? rest : i + rest;
+}
+
+bool CpuSupportsAvx2() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+}
+
+FindFunction SelectFind() {
+  static const FindFunction find = CpuSupportsAvx2() ? FindAvx2 : FindSse2;
+  return find;
+}
+
+#else
+
+FindFunction SelectFind() { return FindScalar; }
+
+#endif
+
+}  // namespace internal
+
+Bitmap FindRowsContaining(const StringArray& values, std::string_view needle) {
+  if (values.IsDictionaryEncoded()) {
+    const Bitmap matches = FindRowsContaining(*values.Dictionary(), needle);
+    const auto& codes = values.Codes();
+    Bitmap result(codes.size());
+    uint64_t* words = result.Words();
+    for (size_t i = 0; i < codes.size(); ++i) {
+      words[i / Bitmap::kWordBits] |= static_cast<uint64_t>(matches.Get(codes[i])) << (i % Bitmap::kWordBits);
+    }
+    return result;
+  }
+
+  const size_t rows = values.size();
+  if (needle.empty()) {
+    return Bitmap(rows, true);
+  }
+
+  Bitmap result(rows);
+  uint64_t* words = result.Words();
+  const std::vector<int64_t>& offsets = values.Offsets();
+  const std::string_view bytes(values.Bytes().data(), values.Bytes().size());
+  const internal::FindFunction find = internal::SelectFind();
+
+  // Occurrences are searched in the whole buffer. One that crosses the end of its row is skipped, and the rest of a
+  // row is skipped once it matched.
+  size_t row = 0;
+  size_t position = 0;
+  while (position < bytes.size()) {
+    const size_t found = find(bytes.substr(position), needle);
+    if (found == std::string_view::npos) {
+      break;
+    }
+    const auto start = static_cast<int64_t>(position + found);
+    row = std::upper_bound(offsets.begin() + row + 1, offsets.end(), start) - offsets.begin() - 1;
+    ASSERT(row < rows);
+    if (start + static_cast<int64_t>(needle.size()) <= offsets[row + 1]) {
+      words[row / Bitmap::kWordBits] |= uint64_t{1} << (row % Bitmap::kWordBits);
+      position = offsets[row + 1];
+    } else {
+      position = start + 1;
+    }
+  }
+  return result;
+}
+
+}  // namespace ngn
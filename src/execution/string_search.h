@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+#include "src/core/string_array.h"
+#include "src/execution/bitmap.h"
+
+namespace ngn {
+
+// Rows of `values` that contain `needle`. A contiguous array is searched in one pass over its byte buffer, and a
+// match is then attributed to the row it starts in; a dictionary encoded array searches its dictionary once.
+Bitmap FindRowsContaining(const StringArray& values, std::string_view needle);
+
+namespace internal {
+
+// Offset of the first occurrence of `needle` in `haystack`, or std::string_view::npos.
+using FindFunction = size_t (*)(std::string_view haystack, std::string_view needle);
+
+// The widest implementation the CPU supports, chosen once at run time.
+FindFunction SelectFind();
+
+size_t FindScalar(std::string_view haystack, std::string_view needle);
+
+#if defined(__x86_64__) || defined(__i386__)
+// Compare the first and the last byte of the needle with 16 or 32 positions at a time and verify the candidates.
+size_t FindSse2(std::string_view haystack, std::string_view needle);
+size_t FindAvx2(std::string_view haystack, std::string_view needle);
+bool CpuSupportsAvx2();
+#endif
+
+}  // namespace internal
+
+}  // namespace ngn
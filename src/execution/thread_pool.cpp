@@ -0,0 +1,147 @@
+#include "src/execution/thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+#include "src/util/assert.h"
+
+namespace ngn {
+
+ThreadPool::ThreadPool(int threads) {
+  ASSERT(threads >= 0);
+  workers_.reserve(threads);
+  for (int i = 0; i < threads; ++i) {
+    workers_.emplace_back([this] { WorkerLoop(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard lock(mutex_);
+    stopping_ = true;
+  }
+  has_tasks_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+  {
+    std::lock_guard lock(mutex_);
+    tasks_.push_back(std::move(task));
+  }
+  has_tasks_.notify_one();
+}
+
+void ThreadPool::ParallelFor(int count, const std::function<void(int)>& fn) {
+  ASSERT(count >= 0);
+  if (count == 0) {
+    return;
+  }
+
+  struct Group {
+    std::mutex mutex;
+    std::condition_variable done;
+    int remaining = 0;
+    std::exception_ptr error;
+  };
+  auto group = std::make_shared<Group>();
+  group->remaining = count;
+
+  auto run = [group, &fn](int index) {
+    std::exception_ptr error;
+    try {
+      fn(index);
+    } catch (...) {
+      error = std::current_exception();
+    }
+    std::lock_guard lock(group->mutex);
+    if (error != nullptr && group->error == nullptr) {
+      group->error = error;
+    }
+    if (--group->remaining == 0) {
+      group->done.notify_all();
+    }
+  };
+
+  for (int i = 1; i < count; ++i) {
+    Submit([run, i] { run(i); });
+  }
+  run(0);
+
+  while (true) {
+    {
+      std::unique_lock lock(group->mutex);
+      if (group->remaining == 0) {
+        break;
+      }
+    }
+    if (RunPendingTask()) {
+      continue;
+    }
+    // The queue is empty, so the rest of the group is running on other threads.
+    std::unique_lock lock(group->mutex);
+    group->done.wait(lock, [&group] { return group->remaining == 0; });
+    break;
+  }
+
+  if (group->error != nullptr) {
+    std::rethrow_exception(group->error);
+  }
+}
+
+bool ThreadPool::RunPendingTask() {
+  std::function<void()> task;
+  {
+    std::lock_guard lock(mutex_);
+    if (tasks_.empty()) {
+      return false;
+    }
+    task = std::move(tasks_.front());
+    tasks_.pop_front();
+  }
+  task();
+  return true;
+}
+
+void ThreadPool::WorkerLoop() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock lock(mutex_);
+      has_tasks_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+      if (tasks_.empty()) {
+        return;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    task();
+  }
+}
+
+namespace {
+
+int HardwareThreads() { return std::max(1, static_cast<int>(std::thread::hardware_concurrency())); }
+
+std::atomic<int> execution_threads = HardwareThreads();
+
+}  // namespace
+
+int ExecutionThreads() { return execution_threads.load(); }
+
+void SetExecutionThreads(int threads) {
+  ASSERT(threads >= 1);
+  execution_threads.store(threads);
+}
+
+ThreadPool& GetThreadPool() {
+  // The calling thread always takes part in ParallelFor, so one worker fewer than cores keeps every core busy.
+  static ThreadPool pool(HardwareThreads() - 1);
+  return pool;
+}
+
+}  // namespace ngn
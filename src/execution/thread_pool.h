@@ -0,0 +1,52 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ngn {
+
+// Fixed set of worker threads executing queued tasks.
+class ThreadPool {
+ public:
+  explicit ThreadPool(int threads);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  int Size() const { return static_cast<int>(workers_.size()); }
+
+  void Submit(std::function<void()> task);
+
+  // Runs fn(0), ..., fn(count - 1) and waits for all of them. fn(0) runs on the calling thread, which also executes
+  // queued tasks while waiting, so nested calls cannot deadlock and a pool without workers runs everything inline.
+  // The first exception thrown by any of the calls is rethrown.
+  void ParallelFor(int count, const std::function<void(int)>& fn);
+
+ private:
+  // Pops one queued task and runs it on the calling thread. Returns false if the queue is empty.
+  bool RunPendingTask();
+
+  void WorkerLoop();
+
+  std::mutex mutex_;
+  std::condition_variable has_tasks_;
+  std::deque<std::function<void()>> tasks_;
+  bool stopping_ = false;
+
+  std::vector<std::thread> workers_;
+};
+
+// Number of workers pipeline breakers use to run their input pipelines. Defaults to the hardware concurrency; 1
+// disables parallel execution.
+int ExecutionThreads();
+void SetExecutionThreads(int threads);
+
+// Process-wide pool shared by all queries.
+ThreadPool& GetThreadPool();
+
+}  // namespace ngn
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "src/core/column.h"
+#include "src/execution/batch.h"
+#include "src/execution/sort_key.h"
+#include "src/util/assert.h"
+
+namespace ngn {
+
+// The first k rows of a sequence of batches in the order given by their sort keys. Candidates are compared by their
+// normalized keys, and a kept row is only referenced by its batch and position until Finalize() copies it, so rows
+// that are evicted later are never copied.
+class TopKRows {
+ public:
+  TopKRows(size_t k, std::vector<bool> ascending) : k_(k), ascending_(std::move(ascending)) {}
+
+  // Offers the rows of `batch`, or only the rows in `selection` if there is one. `keys` are the sort keys of all rows
+  // of the batch.
+  void Consume(std::shared_ptr<Batch> batch, std::vector<Column> keys,
+               const std::optional<std::vector<int32_t>>& selection = std::nullopt) {
+    ASSERT(keys.size() == ascending_.size());
+    if (!schema_.has_value()) {
+      schema_ = batch->GetSchema();
+    }
+    const int64_t rows = selection.has_value() ? static_cast<int64_t>(selection->size()) : batch->Rows();
+    if (k_ == 0 || rows == 0) {
+      return;
+    }
+
+    const NormalizedKeys normalized(keys, ascending_);
+    width_ = normalized.Width();
+    exact_keys_ = normalized.ExactKeys();
+    normalized_.resize(k_ * width_);
+
+    const size_t source = sources_.size();
+    sources_.push_back(Source{.batch = std::move(batch), .keys = std::move(keys), .references = 0});
+    ++live_sources_;
+
+    auto heap_order = [this](uint32_t a, uint32_t b) { return Precedes(Key(a), slots_[a].source, slots_[a].row, b); };
+    for (int64_t i = 0; i < rows; ++i) {
+      const int64_t row = selection.has_value() ? (*selection)[i] : i;
+      const uint8_t* key = normalized.Row(row);
+      if (heap_.size() < k_) {
+        const auto slot = static_cast<uint32_t>(slots_.size());
+        slots_.emplace_back();
+        Store(slot, key, source, row);
+        heap_.push_back(slot);
+        std::push_heap(heap_.begin(), heap_.end(), heap_order);
+        continue;
+      }
+
+      // The top of the heap is the last of the kept rows.
+      if (!Precedes(key, source, row, heap_.front())) {
+        continue;
+      }
+      std::pop_heap(heap_.begin(), heap_.end(), heap_order);
+      const uint32_t slot = heap_.back();
+      const size_t evicted = slots_[slot].source;
+      Store(slot, key, source, row);
+      Release(evicted);
+      std::push_heap(heap_.begin(), heap_.end(), heap_order);
+    }
+
+    if (sources_[source].references == 0) {
+      Release(source);
+      sources_.pop_back();
+    } else if (live_sources_ > kMaxLiveSources) {
+      Compact();
+    }
+  }
+
+  // Whether k rows are kept, so that rows after the last of them can no longer get in.
+  bool Full() const { return k_ > 0 && heap_.size() == k_; }
+
+  // First sort key of the last kept row. Requires Full().
+  Value LastFirstKey() const {
+    ASSERT(Full());
+    const Slot& slot = slots_[heap_.front()];
+    return sources_[slot.source].keys[0][slot.row];
+  }
+
+  // The kept rows in sort order, or nullptr if no batch was consumed.
+  std::shared_ptr<Batch> Finalize() const {
+    if (!schema_.has_value()) {
+      return nullptr;
+    }
+    std::vector<uint32_t> order = heap_;
+    std::sort(order.begin(), order.end(),
+              [this](uint32_t a, uint32_t b) { return Precedes(Key(a), slots_[a].source, slots_[a].row, b); });
+    return GatherBatch(order);
+  }
+
+ private:
+  // Batches referenced by more slots than this are copied together, so that one kept row does not pin a whole batch.
+  static constexpr size_t kMaxLiveSources = 4;
+
+  struct Source {
+    std::shared_ptr<Batch> batch;
+    std::vector<Column> keys;
+    // Number of slots referencing the batch.
+    int64_t references;
+  };
+
+  struct Slot {
+    size_t source = 0;
+    int64_t row = 0;
+  };
+
+  const uint8_t* Key(uint32_t slot) const { return normalized_.data() + slot * width_; }
+
+  void Store(uint32_t slot, const uint8_t* key, size_t source, int64_t row) {
+    if (width_ != 0) {
+      std::memcpy(normalized_.data() + slot * width_, key, width_);
+    }
+    slots_[slot] = Slot{.source = source, .row = row};
+    ++sources_[source].references;
+  }
+
+  void Release(size_t source) {
+    Source& released = sources_[source];
+    if (released.references > 0 && --released.references > 0) {
+      return;
+    }
+    released.batch.reset();
+    released.keys.clear();
+    --live_sources_;
+  }
+
+  // Whether the row with normalized key `key` at `row` of `source` comes before the row kept in `slot`.
+  bool Precedes(const uint8_t* key, size_t source, int64_t row, uint32_t slot) const {
+    const int cmp = width_ == 0 ? 0 : std::memcmp(key, Key(slot), width_);
+    if (cmp != 0) {
+      return cmp < 0;
+    }
+    const Slot& other = slots_[slot];
+    for (size_t k = exact_keys_; k < ascending_.size(); ++k) {
+      const std::strong_ordering order =
+          CompareRows(sources_[source].keys[k], row, sources_[other.source].keys[k], other.row);
+      if (order != 0) {
+        return ascending_[k] ? order < 0 : order > 0;
+      }
+    }
+    return false;
+  }
+
+  template <typename ColumnOf>
+  Column GatherColumn(Type column_type, const std::vector<uint32_t>& slots, ColumnOf&& column_of) const {
+    return Dispatch(
+        [&]<Type type>(Tag<type>) {
+          ArrayType<type> result;
+          result.reserve(slots.size());
+          for (uint32_t slot : slots) {
+            const Slot& kept = slots_[slot];
+            result.emplace_back(std::get<ArrayType<type>>(column_of(sources_[kept.source]).Values())[kept.row]);
+          }
+          return Column(std::move(result));
+        },
+        column_type);
+  }
+
+  std::shared_ptr<Batch> GatherBatch(const std::vector<uint32_t>& slots) const {
+    const auto& fields = schema_->Fields();
+    if (fields.empty()) {
+      return std::make_shared<Batch>(static_cast<int64_t>(slots.size()), *schema_);
+    }
+    std::vector<Column> columns;
+    columns.reserve(fields.size());
+    for (size_t j = 0; j < fields.size(); ++j) {
+      columns.push_back(
+          GatherColumn(fields[j].type, slots, [j](const Source& source) -> const Column& {
+            return source.batch->Columns()[j];
+          }));
+    }
+    return std::make_shared<Batch>(std::move(columns), *schema_);
+  }
+
+  // Copies the kept rows into a single batch and releases the batches they came from.
+  void Compact() {
+    std::vector<Column> keys;
+    keys.reserve(ascending_.size());
+    for (size_t k = 0; k < ascending_.size(); ++k) {
+      const Type type = sources_[slots_[heap_.front()].source].keys[k].GetType();
+      keys.push_back(GatherColumn(type, heap_, [k](const Source& source) -> const Column& { return source.keys[k]; }));
+    }
+    Source compacted{.batch = GatherBatch(heap_), .keys = std::move(keys), .references = 0};
+
+    sources_.clear();
+    sources_.push_back(std::move(compacted));
+    live_sources_ = 1;
+    for (size_t i = 0; i < heap_.size(); ++i) {
+      slots_[heap_[i]] = Slot{.source = 0, .row = static_cast<int64_t>(i)};
+    }
+    sources_[0].references = static_cast<int64_t>(heap_.size());
+  }
+
+  size_t k_;
+  std::vector<bool> ascending_;
+  std::optional<Schema> schema_;
+
+  size_t width_ = 0;
+  size_t exact_keys_ = 0;
+  // Normalized keys of the slots, `width_` bytes each.
+  std::vector<uint8_t> normalized_;
+  std::vector<Slot> slots_;
+  // Max-heap of slots: the last of the kept rows is at the front.
+  std::vector<uint32_t> heap_;
+
+  std::vector<Source> sources_;
+  size_t live_sources_ = 0;
+};
+
+}  // namespace ngn
@@ -0,0 +1,183 @@
+#include "src/execution/aggregation_spill.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/execution/aggregation_executor.h"
+#include "src/execution/aggregation_strategy.h"
+
+namespace ngn {
+
+namespace {
+
+std::vector<std::vector<Value>> SortedRows(const std::shared_ptr<Batch>& batch) {
+  std::vector<std::vector<Value>> rows(batch->Rows());
+  for (const auto& column : batch->Columns()) {
+    for (int64_t i = 0; i < batch->Rows(); ++i) {
+      rows[i].emplace_back(column[i]);
+    }
+  }
+  std::sort(rows.begin(), rows.end());
+  return rows;
+}
+
+std::vector<std::shared_ptr<Batch>> MakeBatches(int batches, int rows, int groups) {
+  Schema schema({Field{"key", Type::kString}, Field{"id", Type::kInt64}, Field{"value", Type::kInt32}});
+  std::vector<std::shared_ptr<Batch>> result;
+  for (int b = 0; b < batches; ++b) {
+    std::vector<std::string> keys;
+    std::vector<int64_t> ids;
+    std::vector<int32_t> values;
+    for (int i = 0; i < rows; ++i) {
+      const int group = (i * 7919 + b * 104729) % groups;
+      keys.push_back("k" + std::to_string(group % 97));
+      ids.push_back(group);
+      values.push_back(i - b * 100);
+    }
+    result.push_back(std::make_shared<Batch>(
+        std::vector<Column>{Column(ArrayType<Type::kString>(keys)), Column(std::move(ids)), Column(std::move(values))},
+        schema));
+  }
+  return result;
+}
+
+std::shared_ptr<Aggregation> MakeTestAggregation() {
+  return MakeAggregation({AggregationUnit{AggregationType::kCount, MakeConst(Value(int64_t{0})), "count"},
+                          AggregationUnit{AggregationType::kSum, MakeVariable("value", Type::kInt32), "sum"},
+                          AggregationUnit{AggregationType::kMin, MakeVariable("key", Type::kString), "min"},
+                          AggregationUnit{AggregationType::kMax, MakeVariable("value", Type::kInt32), "max"}},
+                         {GroupByUnit{MakeVariable("key", Type::kString), "key"},
+                          GroupByUnit{MakeVariable("id", Type::kInt64), "id"}});
+}
+
+std::vector<std::vector<Value>> Expected(const std::shared_ptr<Aggregation>& aggregation,
+                                         const std::vector<std::shared_ptr<Batch>>& batches) {
+  AggregationState state(aggregation);
+  for (const auto& batch : batches) {
+    state.Consume(batch);
+  }
+  return SortedRows(state.Finalize());
+}
+
+// Consumes the batches round robin into `workers` states and merges them.
+template <typename State>
+std::shared_ptr<Batch> AggregateSpilling(std::vector<State> states, const std::vector<std::shared_ptr<Batch>>& batches,
+                                         bool expect_spilled) {
+  for (size_t b = 0; b < batches.size(); ++b) {
+    states[b % states.size()].Consume(batches[b]);
+  }
+  for (const auto& state : states) {
+    EXPECT_EQ(state.Spilled(), expect_spilled);
+  }
+  State result = std::move(states[0]);
+  states.erase(states.begin());
+  result.Merge(std::move(states));
+  return result.Finalize();
+}
+
+class AggregationSpillTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    std::mt19937 rnd(std::random_device{}());
+    directory_ = std::filesystem::temp_directory_path() / ("spill_test_" + std::to_string(rnd()));
+    std::filesystem::create_directories(directory_);
+    SetSpillDirectory(directory_);
+  }
+
+  void TearDown() override {
+    // Spill files are removed as soon as they are combined.
+    EXPECT_TRUE(std::filesystem::is_empty(directory_));
+    SetSpillDirectory({});
+    std::filesystem::remove_all(directory_);
+  }
+
+  std::filesystem::path directory_;
+};
+
+}  // namespace
+
+TEST_F(AggregationSpillTest, MatchesInMemory) {
+  const auto batches = MakeBatches(8, 5000, 20000);
+  const auto aggregation = MakeTestAggregation();
+  const auto expected = Expected(aggregation, batches);
+  const AggregationStatistics unknown{
+      .rows = std::nullopt, .key_domains = {std::nullopt, std::nullopt}, .key_ndvs = {std::nullopt, std::nullopt}};
+  constexpr int64_t kBudget = 2 << 20;
+
+  std::vector<SpillingAggregationState<AdaptiveAggregationState>> adaptive;
+  std::vector<SpillingAggregationState<CompactAggregationState>> compact;
+  for (int i = 0; i < 2; ++i) {
+    adaptive.emplace_back(kBudget, 2, aggregation, unknown);
+    compact.emplace_back(kBudget, 2, aggregation, size_t{1} << 10);
+  }
+  EXPECT_EQ(SortedRows(AggregateSpilling(std::move(adaptive), batches, true)), expected);
+  EXPECT_EQ(SortedRows(AggregateSpilling(std::move(compact), batches, true)), expected);
+
+  // Without a budget nothing is spilled.
+  std::vector<SpillingAggregationState<AdaptiveAggregationState>> unlimited;
+  unlimited.emplace_back(0, 1, aggregation, unknown);
+  EXPECT_EQ(SortedRows(AggregateSpilling(std::move(unlimited), batches, false)), expected);
+}
+
+TEST_F(AggregationSpillTest, RespillsLargePartitions) {
+  // With a budget of one byte every batch is spilled, and so is every partition when it is combined, down to the
+  // deepest level.
+  const auto batches = MakeBatches(4, 300, 1000);
+  const auto aggregation = MakeTestAggregation();
+
+  std::vector<SpillingAggregationState<CompactAggregationState>> states;
+  states.emplace_back(1, 1, aggregation, size_t{1} << 10);
+  EXPECT_EQ(SortedRows(AggregateSpilling(std::move(states), batches, true)), Expected(aggregation, batches));
+}
+
+TEST_F(AggregationSpillTest, CompactFitsSmallBudget) {
+  // Few groups under a budget far below the size of a default compact table: the tables start small, so nothing
+  // spills, whether the compact strategy is used directly, chosen from the statistics or switched to mid-stream.
+  const auto batches = MakeBatches(16, 2000, 500);
+  const auto aggregation = MakeTestAggregation();
+  const auto expected = Expected(aggregation, batches);
+  constexpr int64_t kBudget = 4 << 20;
+  const AggregationStatistics many{
+      .rows = std::nullopt, .key_domains = {std::nullopt, std::nullopt}, .key_ndvs = {int64_t{1} << 20, 1 << 20}};
+  const AggregationStatistics unknown{
+      .rows = std::nullopt, .key_domains = {std::nullopt, std::nullopt}, .key_ndvs = {std::nullopt, std::nullopt}};
+  ASSERT_EQ(ChooseAggregationStrategy(*aggregation, many), AggregationStrategy::kCompact);
+
+  std::vector<SpillingAggregationState<CompactAggregationState>> compact;
+  std::vector<SpillingAggregationState<AdaptiveAggregationState>> chosen;
+  std::vector<SpillingAggregationState<AdaptiveAggregationState>> switched;
+  for (int i = 0; i < 2; ++i) {
+    compact.emplace_back(kBudget, 2, aggregation, CompactInitialGroups(kBudget, std::nullopt, 2));
+    chosen.emplace_back(kBudget, 2, aggregation, many, kCompactAggregationGroups, CompactInitialGroups(kBudget, std::nullopt, 2));
+    switched.emplace_back(kBudget, 2, aggregation, unknown, int64_t{100}, CompactInitialGroups(kBudget, std::nullopt, 2));
+  }
+  EXPECT_EQ(SortedRows(AggregateSpilling(std::move(compact), batches, false)), expected);
+  EXPECT_EQ(SortedRows(AggregateSpilling(std::move(chosen), batches, false)), expected);
+  EXPECT_EQ(SortedRows(AggregateSpilling(std::move(switched), batches, false)), expected);
+}
+
+TEST_F(AggregationSpillTest, CompactInitialGroups) {
+  EXPECT_EQ(CompactInitialGroups(4 << 20, int64_t{1} << 30, 4), kSpillingCompactInitialGroups);
+  EXPECT_EQ(CompactInitialGroups(0, std::nullopt, 4), kSpillingCompactInitialGroups);
+  EXPECT_EQ(CompactInitialGroups(0, 10, 4), kSpillingCompactInitialGroups);
+  EXPECT_EQ(CompactInitialGroups(0, 3000, 2), 2048);
+  EXPECT_EQ(CompactInitialGroups(0, int64_t{1} << 30, 64), kCompactAggregationInitialGroups);
+}
+
+TEST_F(AggregationSpillTest, DistinctIsNotSpilled) {
+  const auto batches = MakeBatches(4, 1000, 1000);
+  const auto aggregation =
+      MakeAggregation({AggregationUnit{AggregationType::kDistinct, MakeVariable("value", Type::kInt32), "distinct"}},
+                      {GroupByUnit{MakeVariable("key", Type::kString), "key"}});
+
+  std::vector<SpillingAggregationState<AggregationState>> states;
+  states.emplace_back(1, 1, aggregation);
+  EXPECT_EQ(SortedRows(AggregateSpilling(std::move(states), batches, false)), Expected(aggregation, batches));
+}
+
+}  // namespace ngn
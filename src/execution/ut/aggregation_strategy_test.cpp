@@ -0,0 +1,138 @@
+#include "src/execution/aggregation_strategy.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace ngn {
+
+namespace {
+
+std::vector<std::vector<Value>> SortedRows(const std::shared_ptr<Batch>& batch) {
+  std::vector<std::vector<Value>> rows(batch->Rows());
+  for (const auto& column : batch->Columns()) {
+    for (int64_t i = 0; i < batch->Rows(); ++i) {
+      rows[i].emplace_back(column[i]);
+    }
+  }
+  std::sort(rows.begin(), rows.end());
+  return rows;
+}
+
+}  // namespace
+
+TEST(AggregationStrategy, EstimateGroups) {
+  EXPECT_EQ(EstimateGroups(AggregationStatistics{.rows = std::nullopt, .key_domains = {}, .key_ndvs = {}}), 1);
+  EXPECT_EQ(EstimateGroups(AggregationStatistics{.rows = 1000,
+                                                 .key_domains = {KeyDomain{0, 9}, std::nullopt},
+                                                 .key_ndvs = {std::nullopt, 20}}),
+            200);
+  // Capped by the number of rows.
+  EXPECT_EQ(EstimateGroups(AggregationStatistics{.rows = 150, .key_domains = {std::nullopt}, .key_ndvs = {1000}}), 150);
+  EXPECT_EQ(EstimateGroups(AggregationStatistics{
+                .rows = 150, .key_domains = {std::nullopt, std::nullopt}, .key_ndvs = {1000, std::nullopt}}),
+            std::nullopt);
+}
+
+TEST(AggregationStrategy, Choose) {
+  auto aggregation =
+      MakeAggregation({AggregationUnit{AggregationType::kSum, MakeVariable("value", Type::kInt64), "sum"}},
+                      {GroupByUnit{MakeVariable("key", Type::kInt64), "key"}});
+
+  EXPECT_EQ(ChooseAggregationStrategy(*aggregation, AggregationStatistics{.rows = 1 << 30,
+                                                                          .key_domains = {KeyDomain{-5, 1000}},
+                                                                          .key_ndvs = {std::nullopt}}),
+            AggregationStrategy::kDirect);
+  EXPECT_EQ(ChooseAggregationStrategy(*aggregation, AggregationStatistics{.rows = 1 << 30,
+                                                                          .key_domains = {std::nullopt},
+                                                                          .key_ndvs = {int64_t{1} << 25}}),
+            AggregationStrategy::kCompact);
+  EXPECT_EQ(ChooseAggregationStrategy(*aggregation, AggregationStatistics{.rows = 1 << 30,
+                                                                          .key_domains = {std::nullopt},
+                                                                          .key_ndvs = {int64_t{1} << 25}},
+                                      int64_t{1} << 26),
+            AggregationStrategy::kHash);
+  // Unknown group counts start with a hash table.
+  EXPECT_EQ(ChooseAggregationStrategy(*aggregation, AggregationStatistics{.rows = 1 << 30,
+                                                                          .key_domains = {std::nullopt},
+                                                                          .key_ndvs = {std::nullopt}}),
+            AggregationStrategy::kHash);
+
+  // Keys that are not plain columns are not supported by the compact strategy.
+  auto computed = MakeAggregation(
+      {AggregationUnit{AggregationType::kSum, MakeVariable("value", Type::kInt64), "sum"}},
+      {GroupByUnit{MakeBinary(BinaryFunction::kSub, MakeVariable("key", Type::kInt64),
+                              MakeConst(Value(int64_t{1}))),
+                   "key"}});
+  EXPECT_EQ(ChooseAggregationStrategy(*computed, AggregationStatistics{.rows = 1 << 30,
+                                                                       .key_domains = {std::nullopt},
+                                                                       .key_ndvs = {int64_t{1} << 25}}),
+            AggregationStrategy::kHash);
+}
+
+TEST(AdaptiveAggregationState, SwitchesToCompact) {
+  Schema schema({Field{"key", Type::kString}, Field{"id", Type::kInt32}, Field{"value", Type::kInt32}});
+  std::vector<std::shared_ptr<Batch>> batches;
+  for (int b = 0; b < 6; ++b) {
+    std::vector<std::string> keys;
+    std::vector<int32_t> ids;
+    std::vector<int32_t> values;
+    // The first states see few groups, the later ones many.
+    const int groups = b < 3 ? 10 : 1000;
+    for (int i = 0; i < 2000; ++i) {
+      keys.push_back("k" + std::to_string(i % groups));
+      ids.push_back((i * 7 + b) % 3);
+      values.push_back(i - b * 100);
+    }
+    batches.push_back(std::make_shared<Batch>(
+        std::vector<Column>{Column(ArrayType<Type::kString>(keys)), Column(std::move(ids)), Column(std::move(values))},
+        schema));
+  }
+
+  auto aggregation =
+      MakeAggregation({AggregationUnit{AggregationType::kCount, MakeConst(Value(int64_t{0})), "count"},
+                       AggregationUnit{AggregationType::kSum, MakeVariable("value", Type::kInt32), "sum"},
+                       AggregationUnit{AggregationType::kMin, MakeVariable("value", Type::kInt32), "min"},
+                       AggregationUnit{AggregationType::kMax, MakeVariable("key", Type::kString), "max"}},
+                      {GroupByUnit{MakeVariable("key", Type::kString), "key"},
+                       GroupByUnit{MakeVariable("id", Type::kInt32), "id"}});
+  const AggregationStatistics unknown{
+      .rows = std::nullopt, .key_domains = {std::nullopt, std::nullopt}, .key_ndvs = {std::nullopt, std::nullopt}};
+
+  AggregationState expected_state(aggregation);
+  for (const auto& batch : batches) {
+    expected_state.Consume(batch);
+  }
+  const auto expected = SortedRows(expected_state.Finalize());
+
+  // The first state stays below the threshold, the second one switches mid-stream.
+  AdaptiveAggregationState state(aggregation, unknown, 100);
+  std::vector<AdaptiveAggregationState> others;
+  others.emplace_back(aggregation, unknown, 100);
+  for (size_t b = 0; b < batches.size(); ++b) {
+    (b < 3 ? state : others.back()).Consume(batches[b]);
+  }
+  EXPECT_EQ(state.Strategy(), AggregationStrategy::kHash);
+  EXPECT_EQ(others.back().Strategy(), AggregationStrategy::kCompact);
+
+  state.Merge(std::move(others));
+  EXPECT_EQ(state.Strategy(), AggregationStrategy::kCompact);
+  EXPECT_EQ(SortedRows(state.Finalize()), expected);
+
+  // Partial DISTINCT results cannot be combined, so such aggregations keep their hash table.
+  auto distinct = MakeAggregation({AggregationUnit{AggregationType::kDistinct, MakeVariable("id", Type::kInt32), "d"}},
+                                  {GroupByUnit{MakeVariable("key", Type::kString), "key"}});
+  AdaptiveAggregationState distinct_state(
+      distinct, AggregationStatistics{.rows = std::nullopt, .key_domains = {std::nullopt}, .key_ndvs = {std::nullopt}},
+      100);
+  for (const auto& batch : batches) {
+    distinct_state.Consume(batch);
+  }
+  EXPECT_EQ(distinct_state.Strategy(), AggregationStrategy::kHash);
+  EXPECT_EQ(distinct_state.Finalize()->Rows(), 1000);
+}
+
+}  // namespace ngn
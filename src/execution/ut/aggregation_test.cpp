@@ -1,5 +1,12 @@
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "gtest/gtest.h"
 #include "src/execution/aggregation_executor.h"
+#include "src/execution/aggregation_executor_compact.h"
 
 namespace ngn {
 
@@ -19,4 +26,174 @@ TEST(Aggregation, Simple) {
   EXPECT_EQ(result->ColumnByName("count")[0], Value(static_cast<int64_t>(3)));
 }
 
+TEST(Aggregation, GroupByDictionaryString) {
+  std::shared_ptr<Aggregation> aggregation = MakeAggregation(
+      {AggregationUnit{AggregationType::kCount, MakeConst(Value(static_cast<int64_t>(0))), "count"}},
+      {GroupByUnit{MakeVariable("phrase", Type::kString), "phrase"}});
+
+  Schema schema({Field{"phrase", Type::kString}});
+  auto dictionary = std::make_shared<const StringArray>(StringArray{"", "abc", "xyz"});
+  auto first = std::make_shared<Batch>(
+      std::vector<Column>{Column(ArrayType<Type::kString>(dictionary, std::vector<int32_t>{1, 0, 1, 2}))}, schema);
+  auto second =
+      std::make_shared<Batch>(std::vector<Column>{Column(ArrayType<Type::kString>{"xyz", "abc", "new"})}, schema);
+
+  auto stream = std::make_shared<VectorStream<std::shared_ptr<Batch>>>(std::vector<std::shared_ptr<Batch>>{first, second});
+
+  std::shared_ptr<Batch> result = Evaluate(stream, aggregation);
+  ASSERT_EQ(result->Rows(), 4);
+
+  std::map<std::string, int64_t> counts;
+  for (int64_t i = 0; i < result->Rows(); ++i) {
+    counts[std::get<std::string>(result->ColumnByName("phrase")[i].GetValue())] =
+        std::get<int64_t>(result->ColumnByName("count")[i].GetValue());
+  }
+  EXPECT_EQ(counts, (std::map<std::string, int64_t>{{"", 1}, {"abc", 3}, {"xyz", 2}, {"new", 1}}));
+}
+
+TEST(Aggregation, ManyGroups) {
+  std::shared_ptr<Aggregation> aggregation =
+      MakeAggregation({AggregationUnit{AggregationType::kSum, MakeVariable("value", Type::kInt32), "sum"},
+                       AggregationUnit{AggregationType::kMin, MakeVariable("name", Type::kString), "min"}},
+                      {GroupByUnit{MakeVariable("id", Type::kInt32), "id"},
+                       GroupByUnit{MakeVariable("name", Type::kString), "name"}});
+
+  Schema schema({Field{"id", Type::kInt32}, Field{"name", Type::kString}, Field{"value", Type::kInt32}});
+  std::vector<std::shared_ptr<Batch>> batches;
+  std::map<std::pair<int32_t, std::string>, int64_t> expected;
+  for (int b = 0; b < 4; ++b) {
+    std::vector<int32_t> ids;
+    std::vector<std::string> names;
+    std::vector<int32_t> values;
+    for (int32_t i = 0; i < 5000; ++i) {
+      ids.push_back(i % 3000);
+      names.push_back("n" + std::to_string(i % 7));
+      values.push_back(i + b);
+      expected[{ids.back(), names.back()}] += values.back();
+    }
+    batches.push_back(std::make_shared<Batch>(
+        std::vector<Column>{Column(std::move(ids)), Column(ArrayType<Type::kString>(names)), Column(std::move(values))},
+        schema));
+  }
+
+  std::shared_ptr<Batch> result = Evaluate(std::make_shared<VectorStream<std::shared_ptr<Batch>>>(batches), aggregation);
+  ASSERT_EQ(result->Rows(), static_cast<int64_t>(expected.size()));
+
+  std::map<std::pair<int32_t, std::string>, int64_t> sums;
+  for (int64_t i = 0; i < result->Rows(); ++i) {
+    const auto name = std::get<std::string>(result->ColumnByName("name")[i].GetValue());
+    EXPECT_EQ(result->ColumnByName("min")[i], Value(name));
+    sums[{std::get<int32_t>(result->ColumnByName("id")[i].GetValue()), name}] =
+        std::get<int64_t>(result->ColumnByName("sum")[i].GetValue());
+  }
+  EXPECT_EQ(sums, expected);
+}
+
+TEST(Aggregation, DirectIndexedKeys) {
+  std::shared_ptr<Aggregation> aggregation = MakeAggregation(
+      {AggregationUnit{AggregationType::kCount, MakeConst(Value(static_cast<int64_t>(0))), "count"},
+       AggregationUnit{AggregationType::kMax, MakeVariable("value", Type::kInt64), "max"}},
+      {GroupByUnit{MakeVariable("a", Type::kInt16), "a"}, GroupByUnit{MakeVariable("b", Type::kInt32), "b"}});
+
+  Schema schema({Field{"a", Type::kInt16}, Field{"b", Type::kInt32}, Field{"value", Type::kInt64}});
+  auto in_domain = std::make_shared<Batch>(
+      std::vector<Column>{Column(std::vector<int16_t>{-3, 2, -3, 0}), Column(std::vector<int32_t>{10, 12, 10, 11}),
+                          Column(std::vector<int64_t>{1, 2, 3, 4})},
+      schema);
+  // The last row is outside of the declared domain of `b`.
+  auto out_of_domain = std::make_shared<Batch>(
+      std::vector<Column>{Column(std::vector<int16_t>{2, -3, 1}), Column(std::vector<int32_t>{12, 10, 100}),
+                          Column(std::vector<int64_t>{7, 0, 5})},
+      schema);
+
+  AggregationState state(aggregation, {KeyDomain{-3, 2}, KeyDomain{10, 12}});
+  state.Consume(in_domain);
+  state.Consume(out_of_domain);
+  state.Consume(in_domain);
+  std::shared_ptr<Batch> result = state.Finalize();
+
+  std::map<std::pair<int16_t, int32_t>, std::pair<int64_t, int64_t>> groups;
+  for (int64_t i = 0; i < result->Rows(); ++i) {
+    groups[{std::get<int16_t>(result->ColumnByName("a")[i].GetValue()),
+            std::get<int32_t>(result->ColumnByName("b")[i].GetValue())}] = {
+        std::get<int64_t>(result->ColumnByName("count")[i].GetValue()),
+        std::get<int64_t>(result->ColumnByName("max")[i].GetValue())};
+  }
+  const std::map<std::pair<int16_t, int32_t>, std::pair<int64_t, int64_t>> expected = {
+      {{-3, 10}, {5, 3}}, {{0, 11}, {2, 4}}, {{1, 100}, {1, 5}}, {{2, 12}, {3, 7}}};
+  EXPECT_EQ(groups, expected);
+}
+
+TEST(Aggregation, CompactMatchesGeneric) {
+  std::shared_ptr<Aggregation> aggregation =
+      MakeAggregation({AggregationUnit{AggregationType::kCount, MakeConst(Value(static_cast<int64_t>(0))), "count"},
+                       AggregationUnit{AggregationType::kSum, MakeVariable("value", Type::kInt32), "sum"},
+                       AggregationUnit{AggregationType::kMin, MakeVariable("name", Type::kString), "min_name"},
+                       AggregationUnit{AggregationType::kMax, MakeVariable("time", Type::kTimestamp), "max_time"},
+                       AggregationUnit{AggregationType::kDistinct, MakeVariable("name", Type::kString), "names"},
+                       AggregationUnit{AggregationType::kDistinct, MakeVariable("value", Type::kInt32), "values"}},
+                      {GroupByUnit{MakeVariable("city", Type::kString), "city"},
+                       GroupByUnit{MakeVariable("day", Type::kDate), "day"},
+                       GroupByUnit{MakeVariable("id", Type::kInt128), "id"}});
+
+  Schema schema({Field{"city", Type::kString}, Field{"day", Type::kDate}, Field{"id", Type::kInt128},
+                 Field{"name", Type::kString}, Field{"time", Type::kTimestamp}, Field{"value", Type::kInt32}});
+  auto cities = std::make_shared<const StringArray>(StringArray{"ams", "", "berlin"});
+  std::vector<std::shared_ptr<Batch>> batches;
+  for (int b = 0; b < 4; ++b) {
+    std::vector<int32_t> city_codes;
+    std::vector<std::string> plain_cities;
+    ArrayType<Type::kDate> days;
+    ArrayType<Type::kInt128> ids;
+    std::vector<std::string> names;
+    ArrayType<Type::kTimestamp> times;
+    std::vector<int32_t> values;
+    for (int i = 0; i < 300; ++i) {
+      city_codes.push_back((i + b) % 3);
+      plain_cities.emplace_back((*cities)[city_codes.back()]);
+      days.push_back(Date{i % 4});
+      ids.push_back(Int128{i % 5} << 70);
+      names.push_back("name" + std::to_string((i * 7 + b) % 11));
+      times.push_back(Timestamp{(i * 31 + b) % 1000});
+      values.push_back((i + b) % 13);
+    }
+    // Alternate dictionary encoded and plain string keys.
+    Column city = b % 2 == 0 ? Column(ArrayType<Type::kString>(cities, std::move(city_codes)))
+                             : Column(ArrayType<Type::kString>(plain_cities));
+    batches.push_back(std::make_shared<Batch>(
+        std::vector<Column>{std::move(city), Column(std::move(days)), Column(std::move(ids)),
+                            Column(ArrayType<Type::kString>(names)), Column(std::move(times)),
+                            Column(std::move(values))},
+        schema));
+  }
+
+  auto rows = [](const std::shared_ptr<Batch>& batch) {
+    std::vector<std::vector<Value>> result(batch->Rows());
+    for (const auto& column : batch->Columns()) {
+      for (int64_t i = 0; i < batch->Rows(); ++i) {
+        result[i].emplace_back(column[i]);
+      }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+  };
+
+  AggregationState generic(aggregation);
+  for (const auto& batch : batches) {
+    generic.Consume(batch);
+  }
+  const auto expected = rows(generic.Finalize());
+  ASSERT_FALSE(expected.empty());
+
+  // Two states that see overlapping keys and values, merged afterwards.
+  CompactAggregationState compact(aggregation);
+  std::vector<CompactAggregationState> others;
+  others.emplace_back(aggregation);
+  for (size_t b = 0; b < batches.size(); ++b) {
+    (b % 2 == 0 ? compact : others.back()).Consume(batches[b]);
+  }
+  compact.Merge(std::move(others));
+  EXPECT_EQ(rows(compact.Finalize()), expected);
+}
+
 }  // namespace ngn
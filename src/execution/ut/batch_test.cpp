@@ -20,4 +20,30 @@ TEST(Batch, Simple) {
   EXPECT_EQ(batch.ColumnByName("c"), col2);
 }
 
+TEST(SelectedBatch, Materialize) {
+  auto dictionary = std::make_shared<const StringArray>(StringArray{"x", "y"});
+  Column col1(ArrayType<Type::kInt64>{1, 2, 3, 4});
+  Column col2(ArrayType<Type::kString>(dictionary, {0, 1, 1, 0}));
+
+  Schema schema({Field{.name = "a", .type = Type::kInt64}, Field{.name = "c", .type = Type::kString}});
+  auto batch = std::make_shared<Batch>(std::vector<Column>{col1, col2}, schema);
+
+  SelectedBatch all{.batch = batch, .selection = std::nullopt};
+  EXPECT_EQ(all.Rows(), 4);
+  EXPECT_EQ(all.Materialize(), batch);
+
+  SelectedBatch selected{.batch = batch, .selection = std::vector<int32_t>{1, 3}};
+  EXPECT_EQ(selected.Rows(), 2);
+  auto materialized = selected.Materialize();
+  EXPECT_EQ(std::get<ArrayType<Type::kInt64>>(materialized->Columns()[0].Values()), (ArrayType<Type::kInt64>{2, 4}));
+  const auto& strings = std::get<ArrayType<Type::kString>>(materialized->Columns()[1].Values());
+  EXPECT_TRUE(strings.IsDictionaryEncoded());
+  EXPECT_EQ(strings[0], "y");
+  EXPECT_EQ(strings[1], "x");
+
+  SelectedBatch rows_only{.batch = std::make_shared<Batch>(5, Schema(std::vector<Field>{})),
+                          .selection = std::vector<int32_t>{0, 4}};
+  EXPECT_EQ(rows_only.Materialize()->Rows(), 2);
+}
+
 }  // namespace ngn
@@ -0,0 +1,48 @@
+#include "src/execution/bitmap.h"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace ngn {
+
+TEST(Bitmap, Booleans) {
+  ArrayType<Type::kBool> values;
+  for (int i = 0; i < 130; ++i) {
+    values.push_back(Boolean{i % 3 == 0 || i == 129});
+  }
+  const Bitmap bitmap(values);
+  EXPECT_EQ(bitmap.Size(), 130);
+  EXPECT_EQ(bitmap.CountSet(), 44);
+  EXPECT_TRUE(bitmap.Get(129));
+  EXPECT_FALSE(bitmap.Get(128));
+  EXPECT_EQ(bitmap.ToBooleans(), values);
+
+  const std::vector<int32_t> rows = bitmap.SetRows();
+  ASSERT_EQ(rows.size(), 44);
+  EXPECT_EQ(rows[1], 3);
+  EXPECT_EQ(rows.back(), 129);
+
+  const Bitmap selected(
+      ArrayType<Type::kBool>{Boolean{false}, Boolean{true}, Boolean{true}, Boolean{false}, Boolean{true}});
+  EXPECT_EQ(selected.SetRows({4, 7, 9, 12, 20}), (std::vector<int32_t>{7, 9, 20}));
+}
+
+TEST(Bitmap, Operations) {
+  Bitmap all(70, true);
+  EXPECT_EQ(all.CountSet(), 70);
+  EXPECT_EQ(Bitmap(all).Flip().CountSet(), 0);
+  EXPECT_FALSE(Bitmap(70).Any());
+
+  Bitmap odd(70);
+  Bitmap low(70);
+  for (size_t i = 0; i < 70; ++i) {
+    odd.Words()[i / Bitmap::kWordBits] |= static_cast<uint64_t>(i % 2) << (i % Bitmap::kWordBits);
+    low.Words()[i / Bitmap::kWordBits] |= static_cast<uint64_t>(i < 10) << (i % Bitmap::kWordBits);
+  }
+  EXPECT_EQ((Bitmap(odd) &= low).SetRows(), (std::vector<int32_t>{1, 3, 5, 7, 9}));
+  EXPECT_EQ((Bitmap(odd) |= low).CountSet(), 40);
+  EXPECT_EQ(Bitmap(odd).Flip().SetRows()[34], 68);
+}
+
+}  // namespace ngn
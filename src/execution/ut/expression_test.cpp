@@ -43,4 +43,69 @@ TEST(Expression, CaseWhenWithStrings) {
   EXPECT_EQ(result, expected);
 }
 
+TEST(Expression, VariableSharesColumn) {
+  auto first = std::make_shared<Batch>(
+      std::vector<Column>{Column(ArrayType<Type::kInt64>{1, 2}), Column(ArrayType<Type::kString>{"x", "y"})},
+      Schema({Field{"a", Type::kInt64}, Field{"s", Type::kString}}));
+  // The same variable on a batch with another layout is looked up by name again.
+  auto second = std::make_shared<Batch>(
+      std::vector<Column>{Column(ArrayType<Type::kInt32>{7}), Column(ArrayType<Type::kString>{"z"})},
+      Schema({Field{"b", Type::kInt32}, Field{"s", Type::kString}}));
+  auto third = std::make_shared<Batch>(std::vector<Column>{Column(ArrayType<Type::kString>{"w"})},
+                                       Schema({Field{"s", Type::kString}}));
+
+  auto variable = MakeVariable("s", Type::kString);
+  Column result = Evaluate(first, variable);
+  EXPECT_TRUE(result.SharesValues(first->Columns()[1]));
+  EXPECT_TRUE(Evaluate(second, variable).SharesValues(second->Columns()[1]));
+  EXPECT_TRUE(Evaluate(third, variable).SharesValues(third->Columns()[0]));
+
+  // Changing the result copies the values first.
+  std::get<ArrayType<Type::kString>>(result.Values()).emplace_back("new");
+  EXPECT_FALSE(result.SharesValues(first->Columns()[1]));
+  EXPECT_EQ(result.Size(), 3);
+  EXPECT_EQ(first->Columns()[1], Column(ArrayType<Type::kString>{"x", "y"}));
+}
+
+TEST(Expression, BinaryWithConst) {
+  auto batch = std::make_shared<Batch>(
+      std::vector<Column>{Column(ArrayType<Type::kInt64>{1, 2, 3}), Column(ArrayType<Type::kString>{"", "a", ""})},
+      Schema({Field{"a", Type::kInt64}, Field{"s", Type::kString}}));
+  auto a = MakeVariable("a", Type::kInt64);
+  auto s = MakeVariable("s", Type::kString);
+
+  EXPECT_EQ(Evaluate(batch, MakeBinary(BinaryFunction::kSub, MakeConst(Value(int64_t{10})), a)),
+            Column(ArrayType<Type::kInt64>{9, 8, 7}));
+  EXPECT_EQ(Evaluate(batch, MakeBinary(BinaryFunction::kLess, a, MakeConst(Value(int64_t{2})))),
+            Column(ArrayType<Type::kBool>{Boolean{true}, Boolean{false}, Boolean{false}}));
+  EXPECT_EQ(Evaluate(batch, MakeBinary(BinaryFunction::kNotEqual, MakeConst(Value(std::string())), s)),
+            Column(ArrayType<Type::kBool>{Boolean{false}, Boolean{true}, Boolean{false}}));
+  // Both operands constant: evaluated as columns of the batch size.
+  auto one = MakeConst(Value(int64_t{1}));
+  EXPECT_EQ(Evaluate(batch, MakeBinary(BinaryFunction::kAdd, one, one)), Column(ArrayType<Type::kInt64>(3, 2)));
+}
+
+TEST(Expression, Predicate) {
+  std::vector<int64_t> values;
+  std::vector<int32_t> groups;
+  for (int64_t i = 0; i < 100; ++i) {
+    values.push_back(i);
+    groups.push_back(static_cast<int32_t>(i % 3));
+  }
+  auto batch = std::make_shared<Batch>(std::vector<Column>{Column(std::move(values)), Column(std::move(groups))},
+                                       Schema({Field{"a", Type::kInt64}, Field{"g", Type::kInt32}}));
+  auto a = MakeVariable("a", Type::kInt64);
+  auto g = MakeVariable("g", Type::kInt32);
+
+  // 10 <= a AND NOT (g = 0 OR a > 20)
+  auto predicate = MakeBinary(
+      BinaryFunction::kAnd, MakeBinary(BinaryFunction::kLessOrEqual, MakeConst(Value(int64_t{10})), a),
+      MakeUnary(UnaryFunction::kNot,
+                MakeBinary(BinaryFunction::kOr, MakeBinary(BinaryFunction::kEqual, g, MakeConst(Value(int32_t{0}))),
+                           MakeBinary(BinaryFunction::kGreater, a, MakeConst(Value(int64_t{20}))))));
+  EXPECT_EQ(EvaluatePredicate(batch, predicate).SetRows(), (std::vector<int32_t>{10, 11, 13, 14, 16, 17, 19, 20}));
+  EXPECT_EQ(EvaluatePredicate(batch, predicate).ToBooleans(),
+            std::get<ArrayType<Type::kBool>>(Evaluate(batch, predicate).Values()));
+}
+
 }  // namespace ngn
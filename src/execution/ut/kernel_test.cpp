@@ -1,5 +1,11 @@
 #include "src/execution/kernel.h"
 
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
 #include "gtest/gtest.h"
 #include "src/core/column.h"
 #include "src/core/datetime.h"
@@ -161,4 +167,176 @@ TEST(Kernel, StrRegexReplaceSimple) {
   EXPECT_EQ(result, expected);
 }
 
+namespace {
+
+Column MakeDictionaryColumn(StringArray dictionary, std::vector<int32_t> codes) {
+  return Column(ArrayType<Type::kString>(std::make_shared<const StringArray>(std::move(dictionary)), std::move(codes)));
+}
+
+}  // namespace
+
+TEST(Kernel, DictionaryCompare) {
+  Column col = MakeDictionaryColumn({"", "abc", "xyz"}, {1, 0, 2, 1, 0});
+  Column constant = MakeDictionaryColumn({""}, {0, 0, 0, 0, 0});
+
+  Column expected(
+      ArrayType<Type::kBool>{Boolean{true}, Boolean{false}, Boolean{true}, Boolean{true}, Boolean{false}});
+  EXPECT_EQ(NotEqual(col, constant), expected);
+  EXPECT_EQ(NotEqual(constant, col), expected);
+  EXPECT_EQ(Less(col, MakeDictionaryColumn({"b"}, {0, 0, 0, 0, 0})),
+            Column(ArrayType<Type::kBool>{Boolean{true}, Boolean{true}, Boolean{false}, Boolean{true}, Boolean{true}}));
+
+  Column plain(ArrayType<Type::kString>{"abc", "", "xyz", "abc", ""});
+  EXPECT_EQ(col, plain);
+  EXPECT_EQ(Equal(col, plain), Column(ArrayType<Type::kBool>(5, Boolean{true})));
+}
+
+TEST(Kernel, ScalarOperand) {
+  Column col(ArrayType<Type::kInt64>{1, 5, 9});
+  Column two(ArrayType<Type::kInt64>(3, 2));
+
+  EXPECT_EQ(Add(col, Value(int64_t{2})), Add(col, two));
+  EXPECT_EQ(Sub(col, Value(int64_t{2})), Sub(col, two));
+  EXPECT_EQ(Sub(Value(int64_t{2}), col), Sub(two, col));
+  EXPECT_EQ(Mult(Value(int64_t{2}), col), Mult(two, col));
+  EXPECT_EQ(Div(col, Value(int64_t{2})), Div(col, two));
+  EXPECT_EQ(Div(Value(int64_t{2}), col), Div(two, col));
+  EXPECT_EQ(Div(col, Value(Int128{2})), Column(ArrayType<Type::kInt128>{0, 2, 4}));
+  EXPECT_EQ(Div(Value(Int128{18}), col), Column(ArrayType<Type::kInt128>{18, 3, 2}));
+
+  EXPECT_EQ(Less(col, Value(int64_t{5})), Less(col, Column(ArrayType<Type::kInt64>(3, 5))));
+  EXPECT_EQ(Less(Value(int64_t{5}), col), Less(Column(ArrayType<Type::kInt64>(3, 5)), col));
+  EXPECT_EQ(GreaterOrEqual(Value(int64_t{5}), col),
+            Column(ArrayType<Type::kBool>{Boolean{true}, Boolean{true}, Boolean{false}}));
+  EXPECT_EQ(Equal(col, Value(int64_t{9})),
+            Column(ArrayType<Type::kBool>{Boolean{false}, Boolean{false}, Boolean{true}}));
+
+  Column flags(ArrayType<Type::kBool>{Boolean{true}, Boolean{false}, Boolean{true}});
+  Column result = And(flags, Value(Boolean{true}));
+  EXPECT_TRUE(result.SharesValues(flags));
+  EXPECT_EQ(Or(Value(Boolean{true}), flags), Column(ArrayType<Type::kBool>(3, Boolean{true})));
+  EXPECT_EQ(And(flags, Value(Boolean{false})), Column(ArrayType<Type::kBool>(3, Boolean{false})));
+}
+
+TEST(Kernel, ScalarStringCompare) {
+  Column dictionary = MakeDictionaryColumn({"", "abc", "xyz"}, {1, 0, 2, 1, 0});
+  Column plain(ArrayType<Type::kString>{"abc", "", "xyz", "abc", ""});
+
+  Column not_empty(
+      ArrayType<Type::kBool>{Boolean{true}, Boolean{false}, Boolean{true}, Boolean{true}, Boolean{false}});
+  EXPECT_EQ(NotEqual(dictionary, Value(std::string())), not_empty);
+  EXPECT_EQ(NotEqual(plain, Value(std::string())), not_empty);
+  EXPECT_EQ(NotEqual(Value(std::string()), plain), not_empty);
+
+  Column before_b(
+      ArrayType<Type::kBool>{Boolean{true}, Boolean{true}, Boolean{false}, Boolean{true}, Boolean{true}});
+  EXPECT_EQ(Less(dictionary, Value(std::string("b"))), before_b);
+  EXPECT_EQ(Greater(Value(std::string("b")), plain), before_b);
+}
+
+namespace {
+
+const std::vector<Comparison> kComparisons = {Comparison::kLess,        Comparison::kGreater,
+                                              Comparison::kEqual,       Comparison::kNotEqual,
+                                              Comparison::kLessOrEqual, Comparison::kGreaterOrEqual};
+
+Column CompareColumns(Comparison comparison, const Column& lhs, const Column& rhs) {
+  switch (comparison) {
+    case Comparison::kLess:
+      return Less(lhs, rhs);
+    case Comparison::kGreater:
+      return Greater(lhs, rhs);
+    case Comparison::kEqual:
+      return Equal(lhs, rhs);
+    case Comparison::kNotEqual:
+      return NotEqual(lhs, rhs);
+    case Comparison::kLessOrEqual:
+      return LessOrEqual(lhs, rhs);
+    default:
+      return GreaterOrEqual(lhs, rhs);
+  }
+}
+
+// Bitmap comparisons of columns and of a column with a scalar agree with the Boolean kernels.
+template <Type type>
+void CheckCompareToBitmap(const std::vector<PhysicalType<type>>& lhs, const std::vector<PhysicalType<type>>& rhs) {
+  const Column lhs_column{ArrayType<type>(lhs.begin(), lhs.end())};
+  const Column rhs_column{ArrayType<type>(rhs.begin(), rhs.end())};
+  const Value scalar(rhs[rhs.size() / 2]);
+  const Column scalar_column{ArrayType<type>(rhs.size(), rhs[rhs.size() / 2])};
+  for (Comparison comparison : kComparisons) {
+    const Column expected = CompareColumns(comparison, lhs_column, rhs_column);
+    EXPECT_EQ(CompareToBitmap(comparison, lhs_column, rhs_column).ToBooleans(),
+              std::get<ArrayType<Type::kBool>>(expected.Values()));
+
+    const Column expected_scalar = CompareColumns(comparison, lhs_column, scalar_column);
+    EXPECT_EQ(CompareToBitmap(comparison, lhs_column, scalar).ToBooleans(),
+              std::get<ArrayType<Type::kBool>>(expected_scalar.Values()));
+  }
+}
+
+}  // namespace
+
+TEST(Kernel, CompareToBitmap) {
+  std::mt19937 rnd(5);
+  // Sizes around the word size exercise the tail that is compared without vector instructions.
+  for (size_t size : {1, 63, 64, 65, 200, 1000}) {
+    std::vector<int16_t> a16(size), b16(size);
+    std::vector<int32_t> a32(size), b32(size);
+    std::vector<int64_t> a64(size), b64(size);
+    std::vector<Date> dates(size), other_dates(size);
+    std::vector<char> chars(size), other_chars(size);
+    std::vector<Int128> wide(size), other_wide(size);
+    for (size_t i = 0; i < size; ++i) {
+      a16[i] = static_cast<int16_t>(static_cast<int>(rnd() % 5) - 2);
+      b16[i] = static_cast<int16_t>(static_cast<int>(rnd() % 5) - 2);
+      a32[i] = static_cast<int32_t>(rnd() % 5) - 2;
+      b32[i] = static_cast<int32_t>(rnd() % 5) - 2;
+      a64[i] = static_cast<int64_t>(rnd() % 5) - (i % 7 == 0 ? std::numeric_limits<int64_t>::max() : 2);
+      b64[i] = static_cast<int64_t>(rnd() % 5) - 2;
+      dates[i] = Date{static_cast<int64_t>(rnd() % 3)};
+      other_dates[i] = Date{static_cast<int64_t>(rnd() % 3)};
+      chars[i] = static_cast<char>(rnd());
+      other_chars[i] = static_cast<char>(rnd());
+      wide[i] = static_cast<Int128>(rnd() % 3);
+      other_wide[i] = static_cast<Int128>(rnd() % 3);
+    }
+    CheckCompareToBitmap<Type::kInt16>(a16, b16);
+    CheckCompareToBitmap<Type::kInt32>(a32, b32);
+    CheckCompareToBitmap<Type::kInt64>(a64, b64);
+    CheckCompareToBitmap<Type::kDate>(dates, other_dates);
+    CheckCompareToBitmap<Type::kChar>(chars, other_chars);
+    CheckCompareToBitmap<Type::kInt128>(wide, other_wide);
+  }
+
+  Column strings = MakeDictionaryColumn({"", "abc"}, {1, 0, 1});
+  EXPECT_EQ(CompareToBitmap(Comparison::kNotEqual, strings, Value(std::string())).SetRows(),
+            (std::vector<int32_t>{0, 2}));
+}
+
+TEST(Kernel, DictionaryStrContains) {
+  Column col = MakeDictionaryColumn({"google.com", "yandex.ru"}, {0, 1, 1, 0});
+
+  EXPECT_EQ(StrContains(col, "google", false),
+            Column(ArrayType<Type::kBool>{Boolean{true}, Boolean{false}, Boolean{false}, Boolean{true}}));
+  EXPECT_EQ(StrContains(col, "google", true),
+            Column(ArrayType<Type::kBool>{Boolean{false}, Boolean{true}, Boolean{true}, Boolean{false}}));
+}
+
+TEST(Kernel, DictionaryStrLen) {
+  Column col = MakeDictionaryColumn({"google.com", ""}, {0, 1, 1, 0});
+
+  EXPECT_EQ(StrLen(col), Column(ArrayType<Type::kInt64>{10, 0, 0, 10}));
+}
+
+TEST(Kernel, IsIn) {
+  Column ints(ArrayType<Type::kInt32>{1, 2, 3, 4});
+  EXPECT_EQ(IsIn(ints, {Value(int32_t{2}), Value(int32_t{4})}),
+            Column(ArrayType<Type::kBool>{Boolean{false}, Boolean{true}, Boolean{false}, Boolean{true}}));
+
+  Column strings = MakeDictionaryColumn({"a", "b", "c"}, {2, 0, 1});
+  EXPECT_EQ(IsIn(strings, {Value(std::string("c")), Value(std::string("b"))}),
+            Column(ArrayType<Type::kBool>{Boolean{true}, Boolean{false}, Boolean{true}}));
+}
+
 }  // namespace ngn
@@ -0,0 +1,477 @@
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/core/columnar.h"
+#include "src/execution/aggregation_executor.h"
+#include "src/execution/aggregation_executor_compact.h"
+#include "src/execution/operator.h"
+#include "src/execution/spill.h"
+#include "src/execution/thread_pool.h"
+
+namespace ngn {
+
+namespace {
+
+std::vector<std::vector<Value>> Rows(const std::shared_ptr<Batch>& batch) {
+  std::vector<std::vector<Value>> rows(batch->Rows());
+  for (const auto& column : batch->Columns()) {
+    for (int64_t i = 0; i < batch->Rows(); ++i) {
+      rows[i].emplace_back(column[i]);
+    }
+  }
+  return rows;
+}
+
+std::vector<std::vector<Value>> Collect(std::shared_ptr<Operator> plan, int threads, bool sort_rows) {
+  SetExecutionThreads(threads);
+  std::vector<std::vector<Value>> rows;
+  auto stream = Execute(std::move(plan));
+  while (auto batch = stream->Next()) {
+    for (auto& row : Rows(batch.value())) {
+      rows.emplace_back(std::move(row));
+    }
+  }
+  if (sort_rows) {
+    std::sort(rows.begin(), rows.end());
+  }
+  return rows;
+}
+
+}  // namespace
+
+TEST(ThreadPool, ParallelFor) {
+  ThreadPool pool(3);
+
+  std::vector<int> calls(100, 0);
+  pool.ParallelFor(100, [&calls](int i) { ++calls[i]; });
+  EXPECT_EQ(calls, std::vector<int>(100, 1));
+
+  std::atomic<int> nested = 0;
+  pool.ParallelFor(4, [&](int) { pool.ParallelFor(4, [&](int) { ++nested; }); });
+  EXPECT_EQ(nested.load(), 16);
+
+  EXPECT_THROW(pool.ParallelFor(8,
+                                [](int i) {
+                                  if (i == 5) {
+                                    throw std::runtime_error("failed");
+                                  }
+                                }),
+               std::runtime_error);
+}
+
+TEST(ThreadPool, NoWorkers) {
+  ThreadPool pool(0);
+
+  int sum = 0;
+  pool.ParallelFor(10, [&sum](int i) { sum += i; });
+  EXPECT_EQ(sum, 45);
+}
+
+TEST(AggregationState, Merge) {
+  std::shared_ptr<Aggregation> aggregation =
+      MakeAggregation({AggregationUnit{AggregationType::kCount, MakeConst(Value(static_cast<int64_t>(0))), "count"},
+                       AggregationUnit{AggregationType::kSum, MakeVariable("value", Type::kInt64), "sum"},
+                       AggregationUnit{AggregationType::kMax, MakeVariable("value", Type::kInt64), "max"},
+                       AggregationUnit{AggregationType::kDistinct, MakeVariable("value", Type::kInt64), "distinct"}},
+                      {GroupByUnit{MakeVariable("key", Type::kString), "key"}});
+
+  Schema schema({Field{"key", Type::kString}, Field{"value", Type::kInt64}});
+  auto dictionary = std::make_shared<const StringArray>(StringArray{"a", "b"});
+  auto first = std::make_shared<Batch>(
+      std::vector<Column>{Column(ArrayType<Type::kString>(dictionary, std::vector<int32_t>{0, 1, 0})),
+                          Column(std::vector<int64_t>{1, 2, 3})},
+      schema);
+  auto second = std::make_shared<Batch>(
+      std::vector<Column>{Column(ArrayType<Type::kString>{"b", "c", "a"}), Column(std::vector<int64_t>{5, 6, 1})},
+      schema);
+
+  AggregationState state(aggregation);
+  state.Consume(first);
+  std::vector<AggregationState> others;
+  others.emplace_back(aggregation);
+  others.back().Consume(second);
+  state.Merge(std::move(others));
+
+  std::vector<std::vector<Value>> rows = Rows(state.Finalize());
+  std::sort(rows.begin(), rows.end());
+
+  const std::vector<std::vector<Value>> expected = {
+      {Value(std::string("a")), Value(int64_t{3}), Value(Int128{5}), Value(int64_t{3}), Value(int64_t{2})},
+      {Value(std::string("b")), Value(int64_t{2}), Value(Int128{7}), Value(int64_t{5}), Value(int64_t{2})},
+      {Value(std::string("c")), Value(int64_t{1}), Value(Int128{6}), Value(int64_t{6}), Value(int64_t{1})},
+  };
+  EXPECT_EQ(rows, expected);
+}
+
+TEST(CompactAggregationState, Merge) {
+  std::shared_ptr<Aggregation> aggregation =
+      MakeAggregation({AggregationUnit{AggregationType::kCount, MakeConst(Value(static_cast<int64_t>(0))), "count"},
+                       AggregationUnit{AggregationType::kMin, MakeVariable("value", Type::kInt32), "min"}},
+                      {GroupByUnit{MakeVariable("key", Type::kInt64), "key"}});
+
+  Schema schema({Field{"key", Type::kInt64}, Field{"value", Type::kInt32}});
+  auto first = std::make_shared<Batch>(
+      std::vector<Column>{Column(std::vector<int64_t>{1, 2, 1}), Column(std::vector<int32_t>{7, 3, 5})}, schema);
+  auto second = std::make_shared<Batch>(
+      std::vector<Column>{Column(std::vector<int64_t>{2, 3}), Column(std::vector<int32_t>{1, 9})}, schema);
+
+  CompactAggregationState state(aggregation);
+  state.Consume(first);
+  std::vector<CompactAggregationState> others;
+  others.emplace_back(aggregation);
+  others.back().Consume(second);
+  state.Merge(std::move(others));
+
+  std::vector<std::vector<Value>> rows = Rows(state.Finalize());
+  std::sort(rows.begin(), rows.end());
+
+  const std::vector<std::vector<Value>> expected = {
+      {Value(int64_t{1}), Value(int64_t{2}), Value(int32_t{5})},
+      {Value(int64_t{2}), Value(int64_t{2}), Value(int32_t{1})},
+      {Value(int64_t{3}), Value(int64_t{1}), Value(int32_t{9})},
+  };
+  EXPECT_EQ(rows, expected);
+}
+
+TEST(ParallelExecution, MatchesSingleThreaded) {
+  std::mt19937 rnd(2106);
+  std::filesystem::path path =
+      std::filesystem::temp_directory_path() / ("ngn_parallel_" + std::to_string(rnd() % 10000) + ".clmnr");
+
+  Schema schema({Field{"key", Type::kInt64}, Field{"value", Type::kInt64}});
+  {
+    FileWriter writer(path.string(), schema);
+    int64_t next_value = 0;
+    for (int row_group = 0; row_group < 17; ++row_group) {
+      std::vector<int64_t> keys;
+      std::vector<int64_t> values;
+      for (int i = 0; i < 100; ++i) {
+        keys.push_back(static_cast<int64_t>(rnd() % 23));
+        values.push_back(next_value++ * 7919 % 1700);
+      }
+      writer.AppendRowGroup({Column(std::move(keys)), Column(std::move(values))});
+    }
+    std::move(writer).Finalize();
+  }
+
+  auto key = MakeVariable("key", Type::kInt64);
+  auto value = MakeVariable("value", Type::kInt64);
+  auto filtered = MakeFilter(MakeScan(path.string(), schema),
+                             MakeBinary(BinaryFunction::kGreater, value, MakeConst(Value(int64_t{50}))));
+
+  auto aggregation = MakeAggregation({AggregationUnit{AggregationType::kCount, MakeConst(Value(int64_t{0})), "count"},
+                                      AggregationUnit{AggregationType::kSum, value, "sum"},
+                                      AggregationUnit{AggregationType::kMin, value, "min"}},
+                                     {GroupByUnit{key, "key"}});
+
+  const std::vector<std::pair<std::shared_ptr<Operator>, bool>> plans = {
+      {MakeAggregate(filtered, aggregation), true},
+      {MakeAggregateCompact(filtered, aggregation), true},
+      {MakeGlobalAggregation(filtered, {AggregationUnit{AggregationType::kSum, value, "sum"},
+                                        AggregationUnit{AggregationType::kMax, value, "max"},
+                                        AggregationUnit{AggregationType::kDistinct, key, "distinct"}}),
+       false},
+      {MakeSort(filtered, {SortUnit{value, false}}), false},
+      {MakeTopK(filtered, {SortUnit{value, true}}, 10), false},
+  };
+
+  const int threads = ExecutionThreads();
+  for (const auto& [plan, sort_rows] : plans) {
+    const auto expected = Collect(plan, 1, sort_rows);
+    EXPECT_FALSE(expected.empty());
+    EXPECT_EQ(Collect(plan, 4, sort_rows), expected);
+  }
+  SetExecutionThreads(threads);
+
+  std::filesystem::remove(path);
+}
+
+TEST(ParallelExecution, SpillingMatchesInMemory) {
+  std::mt19937 rnd(4271);
+  const std::filesystem::path directory =
+      std::filesystem::temp_directory_path() / ("ngn_spill_" + std::to_string(rnd() % 10000));
+  std::filesystem::create_directories(directory);
+  const std::filesystem::path path = directory / "input.clmnr";
+
+  Schema schema({Field{"key", Type::kString}, Field{"value", Type::kInt64}});
+  {
+    FileWriter writer(path.string(), schema);
+    int64_t next_value = 0;
+    for (int row_group = 0; row_group < 40; ++row_group) {
+      std::vector<std::string> keys;
+      std::vector<int64_t> values;
+      for (int i = 0; i < 1000; ++i) {
+        keys.push_back("key" + std::to_string(next_value * 31 % 20000));
+        values.push_back(next_value++ * 7919 % 40009);
+      }
+      writer.AppendRowGroup({Column(ArrayType<Type::kString>(keys)), Column(std::move(values))});
+    }
+    std::move(writer).Finalize();
+  }
+
+  auto key = MakeVariable("key", Type::kString);
+  auto value = MakeVariable("value", Type::kInt64);
+  auto scan = MakeScan(path.string(), schema);
+  auto aggregation = MakeAggregation({AggregationUnit{AggregationType::kCount, MakeConst(Value(int64_t{0})), "count"},
+                                      AggregationUnit{AggregationType::kSum, value, "sum"},
+                                      AggregationUnit{AggregationType::kMax, value, "max"}},
+                                     {GroupByUnit{key, "key"}});
+
+  // Values are unique, so the sorted order has no ties.
+  const std::vector<std::pair<std::shared_ptr<Operator>, bool>> plans = {
+      {MakeAggregate(scan, aggregation), true},
+      {MakeAggregateCompact(scan, aggregation), true},
+      {MakeSort(scan, {SortUnit{key, true}, SortUnit{value, false}}), false},
+  };
+
+  const int threads = ExecutionThreads();
+  for (const auto& [plan, sort_rows] : plans) {
+    const auto expected = Collect(plan, 1, sort_rows);
+    EXPECT_EQ(expected.size(), sort_rows ? 20000 : 40000);
+
+    SetSpillDirectory(directory / "spill");
+    std::filesystem::create_directories(directory / "spill");
+    SetAggregationMemoryBudget(512 << 10);
+    SetSortMemoryBudget(512 << 10);
+    EXPECT_EQ(Collect(plan, 1, sort_rows), expected);
+    EXPECT_EQ(Collect(plan, 4, sort_rows), expected);
+    SetAggregationMemoryBudget(0);
+    SetSortMemoryBudget(0);
+    SetSpillDirectory({});
+    EXPECT_TRUE(std::filesystem::is_empty(directory / "spill"));
+  }
+  SetExecutionThreads(threads);
+
+  std::filesystem::remove_all(directory);
+}
+
+TEST(ParallelExecution, TopKMatchesSort) {
+  std::mt19937 rnd(901);
+  std::filesystem::path path =
+      std::filesystem::temp_directory_path() / ("ngn_topk_" + std::to_string(rnd() % 10000) + ".clmnr");
+
+  // Times grow with the row group, so once the heap is full most row groups are skipped by their zone maps.
+  Schema schema({Field{"time", Type::kTimestamp}, Field{"phrase", Type::kString}, Field{"id", Type::kInt64}});
+  {
+    FileWriter writer(path.string(), schema);
+    int64_t next_id = 0;
+    for (int row_group = 0; row_group < 30; ++row_group) {
+      ArrayType<Type::kTimestamp> times;
+      std::vector<std::string> phrases;
+      std::vector<int64_t> ids;
+      for (int i = 0; i < 200; ++i) {
+        times.push_back(Timestamp{row_group * 10 + static_cast<int64_t>(rnd() % 15)});
+        phrases.push_back("phrase with a long prefix " + std::to_string(rnd() % 5));
+        ids.push_back(next_id++);
+      }
+      writer.AppendRowGroup(
+          {Column(std::move(times)), Column(ArrayType<Type::kString>(phrases)), Column(std::move(ids))});
+    }
+    std::move(writer).Finalize();
+  }
+
+  auto time = MakeVariable("time", Type::kTimestamp);
+  auto phrase = MakeVariable("phrase", Type::kString);
+  auto id = MakeVariable("id", Type::kInt64);
+  auto scan = MakeScan(path.string(), schema);
+  auto renamed = MakeProject(scan, {ProjectionUnit{time, "t"}, ProjectionUnit{phrase, "p"}, ProjectionUnit{id, "i"}});
+
+  // The ids make the order total, so the top rows are the first rows of the sorted output.
+  const std::vector<std::pair<std::shared_ptr<Operator>, std::vector<SortUnit>>> plans = {
+      {scan, {SortUnit{time, true}, SortUnit{phrase, true}, SortUnit{id, true}}},
+      {scan, {SortUnit{time, false}, SortUnit{phrase, true}, SortUnit{id, false}}},
+      {renamed,
+       {SortUnit{MakeVariable("t", Type::kTimestamp), true}, SortUnit{MakeVariable("p", Type::kString), false},
+        SortUnit{MakeVariable("i", Type::kInt64), true}}},
+  };
+
+  const int threads = ExecutionThreads();
+  for (const auto& [child, sort_keys] : plans) {
+    for (uint32_t limit : {1, 10, 500}) {
+      auto expected = Collect(MakeSort(child, sort_keys), 1, false);
+      expected.resize(limit);
+      EXPECT_EQ(Collect(MakeTopK(child, sort_keys, limit), 1, false), expected);
+      EXPECT_EQ(Collect(MakeTopK(child, sort_keys, limit), 4, false), expected);
+    }
+  }
+  SetExecutionThreads(threads);
+
+  std::filesystem::remove(path);
+}
+
+TEST(ParallelExecution, StackedFilters) {
+  std::mt19937 rnd(77);
+  std::filesystem::path path =
+      std::filesystem::temp_directory_path() / ("ngn_filters_" + std::to_string(rnd() % 10000) + ".clmnr");
+
+  Schema schema({Field{"key", Type::kString}, Field{"value", Type::kInt64}});
+  std::vector<std::vector<Value>> expected;
+  {
+    FileWriter writer(path.string(), schema);
+    for (int row_group = 0; row_group < 8; ++row_group) {
+      std::vector<std::string> keys;
+      std::vector<int64_t> values;
+      for (int i = 0; i < 500; ++i) {
+        keys.push_back("key" + std::to_string(rnd() % 10));
+        values.push_back(static_cast<int64_t>(rnd() % 1000));
+        if (values.back() >= 100 && keys.back() != "key3" && values.back() % 2 == 0) {
+          expected.push_back({Value(values.back() - 1), Value(keys.back())});
+        }
+      }
+      writer.AppendRowGroup({Column(ArrayType<Type::kString>(keys)), Column(std::move(values))});
+    }
+    std::move(writer).Finalize();
+  }
+  std::sort(expected.begin(), expected.end());
+
+  // The first two filters keep most rows, so their selections are passed on; the last one keeps few enough for the
+  // batch to be compacted.
+  auto key = MakeVariable("key", Type::kString);
+  auto value = MakeVariable("value", Type::kInt64);
+  auto filtered = MakeFilter(
+      MakeFilter(MakeScan(path.string(), schema),
+                 MakeBinary(BinaryFunction::kGreaterOrEqual, value, MakeConst(Value(int64_t{100})))),
+      MakeBinary(BinaryFunction::kNotEqual, key, MakeConst(Value(std::string("key3")))));
+  auto projected = MakeProject(
+      filtered, {ProjectionUnit{MakeBinary(BinaryFunction::kSub, value, MakeConst(Value(int64_t{1}))), "previous"},
+                 ProjectionUnit{key, "key"}});
+  auto plan = MakeFilter(projected, MakeBinary(BinaryFunction::kEqual,
+                                               MakeBinary(BinaryFunction::kSub, MakeVariable("previous", Type::kInt64),
+                                                          MakeBinary(BinaryFunction::kMult,
+                                                                     MakeBinary(BinaryFunction::kDiv,
+                                                                                MakeVariable("previous", Type::kInt64),
+                                                                                MakeConst(Value(int64_t{2}))),
+                                                                     MakeConst(Value(int64_t{2})))),
+                                               MakeConst(Value(int64_t{1}))));
+
+  const int threads = ExecutionThreads();
+  EXPECT_EQ(Collect(plan, 1, true), expected);
+  // Ties in `previous` may come in any order, so only it is compared.
+  const auto top = Collect(MakeTopK(plan, {SortUnit{MakeVariable("previous", Type::kInt64), false}}, 5), 4, false);
+  ASSERT_EQ(top.size(), 5);
+  for (size_t i = 0; i < top.size(); ++i) {
+    EXPECT_EQ(top[i][0], expected[expected.size() - 1 - i][0]);
+  }
+  SetExecutionThreads(threads);
+
+  std::filesystem::remove(path);
+}
+
+TEST(ParallelExecution, AggregationOverSelection) {
+  std::mt19937 rnd(79);
+  std::filesystem::path path =
+      std::filesystem::temp_directory_path() / ("ngn_selected_" + std::to_string(rnd() % 10000) + ".clmnr");
+
+  Schema schema({Field{"key", Type::kInt64}, Field{"value", Type::kInt64}, Field{"payload", Type::kString}});
+  std::map<int64_t, std::pair<int64_t, Int128>> groups;
+  Int128 total = 0;
+  {
+    FileWriter writer(path.string(), schema);
+    for (int row_group = 0; row_group < 4; ++row_group) {
+      std::vector<int64_t> keys;
+      std::vector<int64_t> values;
+      std::vector<std::string> payloads;
+      for (int i = 0; i < 500; ++i) {
+        keys.push_back(static_cast<int64_t>(rnd() % 7));
+        values.push_back(static_cast<int64_t>(rnd() % 1000));
+        payloads.push_back(std::string(1 + rnd() % 50, 'p'));
+        if (values.back() >= 100) {
+          auto& [count, sum] = groups[keys.back()];
+          ++count;
+          sum += values.back();
+          total += values.back();
+        }
+      }
+      writer.AppendRowGroup(
+          {Column(std::move(keys)), Column(std::move(values)), Column(ArrayType<Type::kString>(payloads))});
+    }
+    std::move(writer).Finalize();
+  }
+  std::vector<std::vector<Value>> expected;
+  for (const auto& [key, group] : groups) {
+    expected.push_back({Value(key), Value(group.first), Value(group.second)});
+  }
+
+  // Nine tenths of the rows pass the filter, so the aggregations get a selection. They read neither the dropped rows
+  // nor the payload column.
+  auto key = MakeVariable("key", Type::kInt64);
+  auto value = MakeVariable("value", Type::kInt64);
+  auto filtered = MakeFilter(MakeScan(path.string(), schema),
+                             MakeBinary(BinaryFunction::kGreaterOrEqual, value, MakeConst(Value(int64_t{100}))));
+  auto aggregation = MakeAggregation({AggregationUnit{AggregationType::kCount, MakeConst(Value(int64_t{0})), "count"},
+                                      AggregationUnit{AggregationType::kSum, value, "sum"}},
+                                     {GroupByUnit{key, "key"}});
+
+  const int threads = ExecutionThreads();
+  for (int workers : {1, 4}) {
+    EXPECT_EQ(Collect(MakeAggregate(filtered, aggregation), workers, true), expected);
+    EXPECT_EQ(Collect(MakeAggregateCompact(filtered, aggregation), workers, true), expected);
+    EXPECT_EQ(Collect(MakeGlobalAggregation(filtered, {AggregationUnit{AggregationType::kSum, value, "sum"}}), workers,
+                      false),
+              (std::vector<std::vector<Value>>{{Value(total)}}));
+  }
+  SetExecutionThreads(threads);
+
+  std::filesystem::remove(path);
+}
+
+TEST(ParallelExecution, GuardedDivision) {
+  std::mt19937 rnd(78);
+  std::filesystem::path path =
+      std::filesystem::temp_directory_path() / ("ngn_division_" + std::to_string(rnd() % 10000) + ".clmnr");
+
+  Schema schema({Field{"x", Type::kInt64}, Field{"y", Type::kInt64}});
+  std::vector<std::vector<Value>> expected_ratios;
+  std::vector<std::vector<Value>> expected_large;
+  {
+    FileWriter writer(path.string(), schema);
+    for (int row_group = 0; row_group < 4; ++row_group) {
+      std::vector<int64_t> xs;
+      std::vector<int64_t> ys;
+      for (int i = 0; i < 500; ++i) {
+        xs.push_back(static_cast<int64_t>(rnd() % 4));
+        ys.push_back(static_cast<int64_t>(rnd() % 1000));
+        if (xs.back() != 0) {
+          expected_ratios.push_back({Value(ys.back() / xs.back())});
+          if (ys.back() / xs.back() >= 300) {
+            expected_large.push_back({Value(ys.back())});
+          }
+        }
+      }
+      writer.AppendRowGroup({Column(std::move(xs)), Column(std::move(ys))});
+    }
+    std::move(writer).Finalize();
+  }
+  std::sort(expected_ratios.begin(), expected_ratios.end());
+  std::sort(expected_large.begin(), expected_large.end());
+
+  // Three quarters of the rows pass the guard, so it passes a selection on rather than compacting the batch. The
+  // divisions must not see the rows with x = 0 it dropped.
+  auto x = MakeVariable("x", Type::kInt64);
+  auto y = MakeVariable("y", Type::kInt64);
+  auto guarded = MakeFilter(MakeScan(path.string(), schema),
+                            MakeBinary(BinaryFunction::kNotEqual, x, MakeConst(Value(int64_t{0}))));
+  auto ratios = MakeProject(guarded, {ProjectionUnit{MakeBinary(BinaryFunction::kDiv, y, x), "ratio"}});
+  auto large = MakeProject(
+      MakeFilter(guarded, MakeBinary(BinaryFunction::kGreaterOrEqual, MakeBinary(BinaryFunction::kDiv, y, x),
+                                     MakeConst(Value(int64_t{300})))),
+      {ProjectionUnit{y, "y"}});
+
+  const int threads = ExecutionThreads();
+  EXPECT_EQ(Collect(ratios, 1, true), expected_ratios);
+  EXPECT_EQ(Collect(large, 1, true), expected_large);
+  EXPECT_EQ(Collect(large, 4, true), expected_large);
+  SetExecutionThreads(threads);
+
+  std::filesystem::remove(path);
+}
+
+}  // namespace ngn
@@ -0,0 +1,123 @@
+#include "src/execution/sort_key.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace ngn {
+
+namespace {
+
+// Reference order: std::stable_sort comparing Values, ties broken by row index.
+std::vector<int64_t> ExpectedOrder(const std::vector<Column>& keys, const std::vector<bool>& ascending) {
+  std::vector<int64_t> indices(keys[0].Size());
+  std::iota(indices.begin(), indices.end(), 0);
+  std::stable_sort(indices.begin(), indices.end(), [&](int64_t a, int64_t b) {
+    for (size_t k = 0; k < keys.size(); ++k) {
+      const std::strong_ordering cmp = keys[k][a] <=> keys[k][b];
+      if (cmp != 0) {
+        return ascending[k] ? cmp < 0 : cmp > 0;
+      }
+    }
+    return false;
+  });
+  return indices;
+}
+
+// Rows with equal keys may come in any order, so the keys of the rows are compared rather than the indices.
+std::vector<std::vector<Value>> KeysInOrder(const std::vector<Column>& keys, const std::vector<int64_t>& order) {
+  std::vector<std::vector<Value>> result;
+  for (int64_t row : order) {
+    std::vector<Value> values;
+    for (const auto& key : keys) {
+      values.emplace_back(key[row]);
+    }
+    result.push_back(std::move(values));
+  }
+  return result;
+}
+
+void CheckOrder(const std::vector<Column>& keys, const std::vector<bool>& ascending) {
+  const std::vector<int64_t> order = SortRows(keys, ascending);
+  std::vector<int64_t> sorted = order;
+  std::sort(sorted.begin(), sorted.end());
+  std::vector<int64_t> all(keys[0].Size());
+  std::iota(all.begin(), all.end(), 0);
+  ASSERT_EQ(sorted, all);
+  EXPECT_EQ(KeysInOrder(keys, order), KeysInOrder(keys, ExpectedOrder(keys, ascending)));
+}
+
+}  // namespace
+
+TEST(SortKey, Integers) {
+  std::mt19937 rnd(42);
+  for (int rows : {0, 1, 10, 1000, 20000}) {
+    std::vector<int64_t> a(rows);
+    std::vector<int32_t> b(rows);
+    std::vector<int16_t> c(rows);
+    std::vector<Int128> d(rows);
+    std::vector<char> e(rows);
+    for (int i = 0; i < rows; ++i) {
+      a[i] = static_cast<int64_t>(rnd() % 7) - 3 + (i % 5 == 0 ? std::numeric_limits<int64_t>::min() : 0);
+      b[i] = static_cast<int32_t>(rnd());
+      c[i] = static_cast<int16_t>(rnd() % 11) - 5;
+      d[i] = (static_cast<Int128>(static_cast<int64_t>(rnd() % 5) - 2) << 64) + rnd();
+      e[i] = static_cast<char>(rnd());
+    }
+    if (rows == 0) {
+      EXPECT_TRUE(SortRows({Column(a)}, {true}).empty());
+      continue;
+    }
+    CheckOrder({Column(a), Column(b)}, {true, true});
+    CheckOrder({Column(a), Column(b)}, {false, true});
+    CheckOrder({Column(c), Column(d), Column(b)}, {true, false, true});
+    CheckOrder({Column(e), Column(c)}, {false, false});
+  }
+}
+
+TEST(SortKey, TemporalAndBool) {
+  std::mt19937 rnd(7);
+  ArrayType<Type::kTimestamp> timestamps;
+  ArrayType<Type::kDate> dates;
+  ArrayType<Type::kBool> flags;
+  for (int i = 0; i < 5000; ++i) {
+    timestamps.push_back(Timestamp{static_cast<int64_t>(rnd() % 100) - 50});
+    dates.push_back(Date{static_cast<int64_t>(rnd() % 10) - 5});
+    flags.push_back(Boolean{rnd() % 2 == 0});
+  }
+  CheckOrder({Column(timestamps), Column(flags)}, {true, false});
+  CheckOrder({Column(flags), Column(dates), Column(timestamps)}, {true, true, false});
+}
+
+TEST(SortKey, Strings) {
+  std::mt19937 rnd(1);
+  // Strings sharing prefixes longer than the normalized prefix, empty strings, and bytes above 0x7f.
+  const std::vector<std::string> prefixes = {"", "a", "abcdefgh", "abcdefghij", "\xff\xfe", "zzzzzzzzzzzzzzzz"};
+  std::vector<std::string> strings;
+  std::vector<int64_t> times;
+  std::vector<int32_t> ids;
+  for (int i = 0; i < 20000; ++i) {
+    std::string value = prefixes[rnd() % prefixes.size()];
+    const int suffix = static_cast<int>(rnd() % 4);
+    for (int j = 0; j < suffix; ++j) {
+      value.push_back(static_cast<char>('a' + rnd() % 3));
+    }
+    strings.push_back(std::move(value));
+    times.push_back(static_cast<int64_t>(rnd() % 20));
+    ids.push_back(static_cast<int32_t>(rnd() % 3));
+  }
+  const Column string_column{ArrayType<Type::kString>(strings)};
+
+  CheckOrder({string_column}, {true});
+  CheckOrder({string_column}, {false});
+  CheckOrder({Column(times), string_column}, {true, true});
+  CheckOrder({Column(times), string_column, Column(ids)}, {false, true, false});
+  CheckOrder({string_column, Column(ids), string_column}, {false, true, true});
+}
+
+}  // namespace ngn
@@ -0,0 +1,47 @@
+#include "src/execution/string_key_table.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace ngn {
+
+TEST(StringKeyTable, Lookup) {
+  StringKeyTable table;
+  EXPECT_EQ(table.Lookup("abc"), 0);
+  EXPECT_EQ(table.Lookup(""), 1);
+  EXPECT_EQ(table.Lookup("abcd"), 2);
+  EXPECT_EQ(table.Lookup(std::string("abc")), 0);
+  EXPECT_EQ(table.Lookup(""), 1);
+  EXPECT_EQ(table.Size(), 3);
+
+  EXPECT_EQ(table.Decode(0), "abc");
+  EXPECT_EQ(table.Decode(1), "");
+  EXPECT_EQ(table.Decode(2), "abcd");
+  EXPECT_EQ(table.Hash(2), HashString("abcd"));
+}
+
+TEST(StringKeyTable, Growth) {
+  StringKeyTable table;
+  std::vector<std::string> values;
+  for (int i = 0; i < 100000; ++i) {
+    // Long shared prefixes so the cached prefix does not tell keys apart.
+    values.push_back("common-prefix-" + std::to_string(i));
+  }
+  values.push_back(std::string(100000, 'x'));
+
+  std::vector<std::string_view> decoded;
+  for (size_t i = 0; i < values.size(); ++i) {
+    ASSERT_EQ(table.Lookup(values[i]), static_cast<int32_t>(i));
+    decoded.push_back(table.Decode(static_cast<int32_t>(i)));
+  }
+  for (size_t i = 0; i < values.size(); ++i) {
+    EXPECT_EQ(table.Lookup(values[i]), static_cast<int32_t>(i));
+    // Views stay valid while the table grows.
+    EXPECT_EQ(decoded[i], values[i]);
+  }
+  EXPECT_EQ(table.Size(), values.size());
+}
+
+}  // namespace ngn
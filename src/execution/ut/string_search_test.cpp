@@ -0,0 +1,78 @@
+#include "src/execution/string_search.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace ngn {
+
+namespace {
+
+std::string RandomString(std::mt19937& rnd, size_t size) {
+  std::string result;
+  for (size_t i = 0; i < size; ++i) {
+    result.push_back(static_cast<char>('a' + rnd() % 3));
+  }
+  return result;
+}
+
+std::vector<internal::FindFunction> FindFunctions() {
+  std::vector<internal::FindFunction> functions = {internal::FindScalar, internal::SelectFind()};
+#if defined(__x86_64__) || defined(__i386__)
+  functions.push_back(internal::FindSse2);
+  if (internal::CpuSupportsAvx2()) {
+    functions.push_back(internal::FindAvx2);
+  }
+#endif
+  return functions;
+}
+
+}  // namespace
+
+TEST(StringSearch, Find) {
+  std::mt19937 rnd(3);
+  for (int iteration = 0; iteration < 2000; ++iteration) {
+    const std::string haystack = RandomString(rnd, rnd() % 200);
+    const std::string needle = RandomString(rnd, rnd() % 6);
+    for (auto find : FindFunctions()) {
+      ASSERT_EQ(find(haystack, needle), std::string_view(haystack).find(needle)) << haystack << " " << needle;
+    }
+  }
+
+  const std::string text = std::string(100, 'x') + "google" + std::string(50, 'x');
+  for (auto find : FindFunctions()) {
+    EXPECT_EQ(find(text, "google"), 100);
+    EXPECT_EQ(find(text, "googlex"), 100);
+    EXPECT_EQ(find(text, "Google"), std::string_view::npos);
+    EXPECT_EQ(find(text, std::string(40, 'x')), 0);
+    EXPECT_EQ(find(text, "e" + std::string(50, 'x')), 105);
+  }
+}
+
+TEST(StringSearch, Rows) {
+  std::mt19937 rnd(11);
+  std::vector<std::string> rows;
+  for (int i = 0; i < 3000; ++i) {
+    rows.push_back(RandomString(rnd, rnd() % 12));
+  }
+  const StringArray values(rows);
+  for (const std::string needle : {"", "a", "ab", "abc", "cabba", "aaaaaaaaaa"}) {
+    const Bitmap found = FindRowsContaining(values, needle);
+    ASSERT_EQ(found.Size(), rows.size());
+    for (size_t i = 0; i < rows.size(); ++i) {
+      ASSERT_EQ(found.Get(i), rows[i].find(needle) != std::string::npos) << i << " " << needle;
+    }
+  }
+
+  // Occurrences across the boundary of two rows do not count.
+  EXPECT_EQ(FindRowsContaining(StringArray{"goo", "gle", "", "google", "xgoogle"}, "google").SetRows(),
+            (std::vector<int32_t>{3, 4}));
+
+  const StringArray dictionary(std::make_shared<const StringArray>(StringArray{"yandex.ru", "google.com"}),
+                               std::vector<int32_t>{0, 1, 1, 0});
+  EXPECT_EQ(FindRowsContaining(dictionary, "google").SetRows(), (std::vector<int32_t>{1, 2}));
+}
+
+}  // namespace ngn
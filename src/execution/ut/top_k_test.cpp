@@ -0,0 +1,114 @@
+#include "src/execution/top_k.h"
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace ngn {
+
+namespace {
+
+std::vector<std::vector<Value>> Rows(const std::shared_ptr<Batch>& batch) {
+  std::vector<std::vector<Value>> rows(batch->Rows());
+  for (const auto& column : batch->Columns()) {
+    for (int64_t i = 0; i < batch->Rows(); ++i) {
+      rows[i].emplace_back(column[i]);
+    }
+  }
+  return rows;
+}
+
+// Batches of (time, phrase, id) rows; ids are unique, so (time, phrase, id) orders all rows.
+std::vector<std::shared_ptr<Batch>> MakeBatches(int batches, int rows) {
+  std::mt19937 rnd(17);
+  Schema schema({Field{"time", Type::kInt64}, Field{"phrase", Type::kString}, Field{"id", Type::kInt32}});
+  std::vector<std::shared_ptr<Batch>> result;
+  int32_t next_id = 0;
+  for (int b = 0; b < batches; ++b) {
+    std::vector<int64_t> times;
+    std::vector<std::string> phrases;
+    std::vector<int32_t> ids;
+    for (int i = 0; i < rows; ++i) {
+      times.push_back(static_cast<int64_t>(rnd() % 50) - 25);
+      phrases.push_back("long common prefix " + std::to_string(rnd() % 7));
+      ids.push_back(next_id++);
+    }
+    std::vector<Column> columns;
+    columns.emplace_back(std::move(times));
+    columns.emplace_back(ArrayType<Type::kString>(phrases));
+    columns.emplace_back(std::move(ids));
+    result.push_back(std::make_shared<Batch>(std::move(columns), schema));
+  }
+  return result;
+}
+
+std::vector<Column> Keys(const std::shared_ptr<Batch>& batch) { return batch->Columns(); }
+
+// The first `k` rows of all batches sorted with SortRows.
+std::vector<std::vector<Value>> Expected(const std::vector<std::shared_ptr<Batch>>& batches,
+                                         const std::vector<bool>& ascending, size_t k) {
+  std::vector<std::vector<Value>> rows;
+  std::vector<Column> keys = Keys(batches[0]);
+  for (size_t b = 1; b < batches.size(); ++b) {
+    for (size_t j = 0; j < keys.size(); ++j) {
+      std::visit(
+          [&]<Type type>(ArrayType<type>& output) {
+            const auto& values = std::get<ArrayType<type>>(batches[b]->Columns()[j].Values());
+            if constexpr (type == Type::kString) {
+              output.AppendRange(values, 0, values.size());
+            } else {
+              output.insert(output.end(), values.begin(), values.end());
+            }
+          },
+          keys[j].Values());
+    }
+  }
+  for (int64_t row : SortRows(keys, ascending)) {
+    if (rows.size() == k) {
+      break;
+    }
+    std::vector<Value> values;
+    for (const auto& key : keys) {
+      values.emplace_back(key[row]);
+    }
+    rows.push_back(std::move(values));
+  }
+  return rows;
+}
+
+}  // namespace
+
+TEST(TopKRows, MatchesSort) {
+  const auto batches = MakeBatches(40, 300);
+  for (const std::vector<bool>& ascending :
+       {std::vector<bool>{true, true, true}, {false, true, false}, {true, false, true}}) {
+    for (size_t k : {1, 10, 1000, 20000}) {
+      TopKRows top(k, ascending);
+      for (const auto& batch : batches) {
+        top.Consume(batch, Keys(batch));
+      }
+      ASSERT_EQ(top.Full(), k <= 12000);
+      const auto expected = Expected(batches, ascending, k);
+      if (top.Full()) {
+        EXPECT_EQ(top.LastFirstKey(), expected.back()[0]);
+      }
+      EXPECT_EQ(Rows(top.Finalize()), expected);
+    }
+  }
+}
+
+TEST(TopKRows, Empty) {
+  TopKRows top(5, {true});
+  EXPECT_EQ(top.Finalize(), nullptr);
+
+  const auto batches = MakeBatches(1, 10);
+  TopKRows none(0, {true, true, true});
+  none.Consume(batches[0], Keys(batches[0]));
+  EXPECT_FALSE(none.Full());
+  EXPECT_EQ(none.Finalize()->Rows(), 0);
+}
+
+}  // namespace ngn